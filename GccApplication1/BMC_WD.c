@@ -0,0 +1,384 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+   BMC Watchdog 
+ ************************************
+ 
+ WD_CHANNELS independent channels with msec resolution time-out (see registers in BMC_WD.h).
+ 
+ * Channel is configured and started via 'write enable' sequence (emulated EEPROM).
+ * Channel is kicked by a single byte write of its key to the kick register; the key is rolled on each valid kick,
+   so a stuck BMC daemon repeating the same write does not keep the channel alive.
+ * Pre-timeout: INT# is asserted (alert of the I2C device of WD registers) when remaining time reach the pre-timeout value; released on kick or stop.
+ * Time-out: CORST# or PORST# pulse (according to control) and the channel is stopped; the event is logged and printed 
+   by WD_BackgroundTask (main loop), since the tick is preemptible (see ISR_Priority.h and Stack.h).
+ * Channel state is updated with interrupts disabled (tick and TWI ISRs, ATOMIC_BLOCK); registers are read via sequence lock (see Seqlock.h).
+ 
+ Legacy register (0x3000, channel 0): 
+ * byte 0: config: bit 0: CORST#; bit 1: PORST#; bit 7..4: time-out of 2^n sec. Write config starts channel 0 (if stopped) and kick it.
+ * byte 1..4: remaining time in msec.
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "SystemTick.h"
+#include "I2C_Slave.h"
+#include "EventLog.h"
+#include "TimeStamp.h"
+#include "Trace.h"
+#include "BMC_WD.h"
+#include "Seqlock.h"
+
+#define F_CPU 8000000UL  // 8 MHz
+#include <util/delay.h>
+
+typedef struct
+{
+	uint8_t  Control;
+	uint32_t TimeOut;    // msec
+	uint16_t PreTimeOut; // msec
+	uint8_t  Key;
+	uint8_t  Status;
+	uint32_t Deadline;   // time base msec of time-out 
+} WD_CHANNEL;
+
+static WD_CHANNEL g_WD [WD_CHANNELS];
+static uint8_t g_WD_Cfg; // legacy config
+static uint8_t g_WD_DeviceIndex; // I2C device of WD registers (alert source)
+static SEQLOCK g_WD_Seq; // channel state update
+static uint8_t g_WD_Event_Pending; // bit per channel; time-out to be logged by WD_BackgroundTask
+static uint8_t g_WD_Event [WD_CHANNELS]; // event payload: channel [7:4], control [3:0]
+
+//---------------------------------------------------------------------------------------------
+static uint8_t WD_Next_Key (uint8_t Key)
+{
+	// Galois LFSR x^8+x^6+x^5+x^4+1; never 0 for non-zero key.
+	return ((Key >> 1) ^ ((Key & 0x01) ? 0xB8 : 0x00));
+}
+//---------------------------------------------------------------------------------------------
+static void WD_Alert (void)
+{
+	uint8_t Channel;
+	bool Assert = false;
+	
+	for (Channel = 0; Channel < WD_CHANNELS; Channel++)
+		if (g_WD[Channel].Status & WD_STATUS_PRETIMEOUT)
+			Assert = true;
+	
+	I2C_Slave_Alert (g_WD_DeviceIndex, Assert); // INT# is shared with other devices 
+}
+//---------------------------------------------------------------------------------------------
+static uint32_t WD_Remain (WD_CHANNEL *pWD, uint32_t Now)
+{
+	if ((pWD->Status & WD_STATUS_RUNNING) == 0)
+		return (0);
+	if ((int32_t)(pWD->Deadline - Now) <= 0)
+		return (0);
+	return (pWD->Deadline - Now);
+}
+//---------------------------------------------------------------------------------------------
+static void WD_Channel_Kick (WD_CHANNEL *pWD)
+{
+	pWD->Deadline = SystemTick_Get_msec () + pWD->TimeOut;
+	if (pWD->Status & WD_STATUS_PRETIMEOUT)
+	{
+		pWD->Status &= ~WD_STATUS_PRETIMEOUT;
+		WD_Alert ();
+	}
+}
+//---------------------------------------------------------------------------------------------
+static void WD_Channel_Start (uint8_t Channel)
+{
+	WD_CHANNEL *pWD = &g_WD[Channel];
+	
+	pWD->Key = (uint8_t)SystemTick_Get_usec () | 0x01; // non-zero seed
+	pWD->Status = WD_STATUS_RUNNING;
+	WD_Channel_Kick (pWD);
+	Trace_Add (TRACE_WD_START, (Channel<<4) | (pWD->Control & 0x0F));
+}
+//---------------------------------------------------------------------------------------------
+static void WD_Channel_Stop (uint8_t Channel)
+{
+	WD_CHANNEL *pWD = &g_WD[Channel];
+	
+	if (pWD->Status & WD_STATUS_RUNNING)
+		Trace_Add (TRACE_WD_STOP, Channel);
+	pWD->Status &= ~(WD_STATUS_RUNNING | WD_STATUS_PRETIMEOUT);
+	WD_Alert ();
+	pWD->Control &= ~WD_CONTROL_START;
+}
+//---------------------------------------------------------------------------------------------
+extern void WD_Init (uint8_t DeviceIndex)
+{
+	memset ((void*)g_WD, 0, sizeof(g_WD));
+	g_WD_Cfg = 0;
+	g_WD_DeviceIndex = DeviceIndex;
+	g_WD_Event_Pending = 0;
+}
+//---------------------------------------------------------------------------------------------
+// legacy kick (channel 0)
+extern void WD_Touch (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (g_WD[0].Status & WD_STATUS_RUNNING)
+			WD_Channel_Kick (&g_WD[0]);
+		SEQLOCK_WRITE (g_WD_Seq);
+	}
+}
+//---------------------------------------------------------------------------------------------
+// stop all channels
+extern void WD_Stop (void)
+{
+	uint8_t Channel;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (Channel = 0; Channel < WD_CHANNELS; Channel++)
+			WD_Channel_Stop (Channel);
+		g_WD_Cfg = 0;
+		SEQLOCK_WRITE (g_WD_Seq);
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern bool WD_Kick (uint8_t Channel, uint8_t Key)
+{
+	bool Result = false;
+	
+	if (Channel >= WD_CHANNELS)
+		return (false);
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		WD_CHANNEL *pWD = &g_WD[Channel];
+		
+		if ( (pWD->Status & WD_STATUS_RUNNING) && (Key == pWD->Key) )
+		{
+			pWD->Key = WD_Next_Key (pWD->Key);
+			WD_Channel_Kick (pWD);
+			Result = true;
+		}
+		SEQLOCK_WRITE (g_WD_Seq);
+	}
+	
+	return (Result);
+}
+//---------------------------------------------------------------------------------------------
+// Called every 1 msec (low priority tick; see ISR_Priority.h). Channel state is updated in ATOMIC_BLOCK, since TWI may
+// kick or write the channel in the middle; the reset pulse is done with interrupts enabled. No printing here.
+extern void WD_PeriodicTask (uint32_t ElapsedTime /*msec*/)
+{
+	uint8_t Channel;
+	uint32_t Now = SystemTick_Get_msec ();
+	
+	for (Channel = 0; Channel < WD_CHANNELS; Channel++)
+	{
+		WD_CHANNEL *pWD = &g_WD[Channel];
+		uint8_t Control;
+		bool TimeOut = false;
+		
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			uint32_t Remain = WD_Remain (pWD, Now); // 0 if not running; a kick after Now only extend the remaining time
+			
+			Control = pWD->Control;
+			
+			if ( (Remain != 0) && (Remain <= pWD->PreTimeOut) && (Control & WD_CONTROL_INT) && ((pWD->Status & WD_STATUS_PRETIMEOUT) == 0) )
+			{
+				pWD->Status |= WD_STATUS_PRETIMEOUT;
+				I2C_Slave_Alert (g_WD_DeviceIndex, false); // new alert source; report it again by ARA.
+				WD_Alert ();
+				Trace_Add (TRACE_WD_PRETIMEOUT, Channel);
+				SEQLOCK_WRITE (g_WD_Seq);
+			}
+			
+			if ( (Remain == 0) && (pWD->Status & WD_STATUS_RUNNING) )
+			{
+				Trace_Add (TRACE_WD_TIMEOUT, (Channel<<4) | (Control & 0x0F));
+				WD_Channel_Stop (Channel);
+				pWD->Status |= WD_STATUS_TIMEOUT;
+				if (Channel == 0)
+					g_WD_Cfg = 0;
+				SEQLOCK_WRITE (g_WD_Seq);
+				g_WD_Event [Channel] = (Channel<<4) | (Control & 0x0F);
+				g_WD_Event_Pending |= 1<<Channel;
+				TimeOut = true;
+			}
+		}
+		
+		if (TimeOut)
+		{
+			if (Control & WD_CONTROL_CORST) 
+			{
+				// CORST_N (PA2)
+				CLEAR_BIT_REG (PORTA, PA2); // set low
+				SET_BIT_REG (DDRA, PA2); // set output
+				_delay_us (10);
+				CLEAR_BIT_REG (DDRA, PA2); // set input (external PU)
+			}
+			else if (Control & WD_CONTROL_PORST)
+			{
+				// PORST_N (PA1)
+				CLEAR_BIT_REG (PORTA, PA1); // set low
+				SET_BIT_REG (DDRA, PA1); // set output
+				_delay_us (10);
+				CLEAR_BIT_REG (DDRA, PA1); // set input (external PU)
+			}
+		}
+	}
+}
+//---------------------------------------------------------------------------------------------
+// Call from main loop; log and print the time-outs detected by WD_PeriodicTask.
+extern void WD_BackgroundTask (void)
+{
+	uint8_t Channel;
+	uint8_t Event = 0;
+	bool Pending = false;
+	
+	for (Channel = 0; Channel < WD_CHANNELS; Channel++)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Pending = IS_BIT_SET (g_WD_Event_Pending, Channel);
+			Event = g_WD_Event [Channel];
+			g_WD_Event_Pending &= ~(1<<Channel);
+		}
+		
+		if (Pending)
+		{
+			printf_P (PSTR("> WD %u Timeout.\r\n"), Channel);
+			if (Event & WD_CONTROL_CORST)
+				printf_P (PSTR("> Asserted BMC CORST#.\r\n"));
+			else if (Event & WD_CONTROL_PORST)
+				printf_P (PSTR("> Asserted BMC PORST#.\r\n"));
+			TimeStamp_Event (EVENT_BMC_WD, Event);
+		}
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern void WD_Read_Regs (uint16_t Addr, uint8_t *pBuffer, uint8_t Size)
+{
+	uint32_t Now;
+	uint8_t i, Seq;
+	
+	do
+	{
+		Seq = SEQLOCK_READ_BEGIN (g_WD_Seq);
+		Now = SystemTick_Get_msec ();
+		
+		for (i = 0; i < Size; i++)
+		{
+			uint16_t Reg = Addr + i;
+			uint8_t Value = 0xEE; // reserved
+		
+			if ( (Reg >= WD_LEGACY_ADDR) && (Reg <= WD_LEGACY_ADDR+4) )
+			{
+				uint32_t Remain = WD_Remain (&g_WD[0], Now);
+				Value = (Reg == WD_LEGACY_ADDR) ? g_WD_Cfg : (uint8_t)(Remain >> (8*(Reg - WD_LEGACY_ADDR - 1)));
+			}
+			else if ( (Reg >= WD_CHANNEL_ADDR) && (Reg < WD_CHANNEL_ADDR + WD_CHANNELS*WD_REG_SIZE) )
+			{
+				WD_CHANNEL *pWD = &g_WD[(Reg - WD_CHANNEL_ADDR) / WD_REG_SIZE];
+				uint8_t Offset = (Reg - WD_CHANNEL_ADDR) % WD_REG_SIZE;
+			
+				if (Offset == WD_REG_CONTROL)
+					Value = (pWD->Control & ~WD_CONTROL_START) | ((pWD->Status & WD_STATUS_RUNNING) ? WD_CONTROL_START : 0);
+				else if ( (Offset >= WD_REG_TIMEOUT) && (Offset < WD_REG_TIMEOUT+4) )
+					Value = (uint8_t)(pWD->TimeOut >> (8*(Offset - WD_REG_TIMEOUT)));
+				else if ( (Offset >= WD_REG_PRETIMEOUT) && (Offset < WD_REG_PRETIMEOUT+2) )
+					Value = (uint8_t)(pWD->PreTimeOut >> (8*(Offset - WD_REG_PRETIMEOUT)));
+				else if (Offset == WD_REG_KEY)
+					Value = pWD->Key;
+				else if ( (Offset >= WD_REG_REMAIN) && (Offset < WD_REG_REMAIN+4) )
+					Value = (uint8_t)(WD_Remain (pWD, Now) >> (8*(Offset - WD_REG_REMAIN)));
+				else if (Offset == WD_REG_STATUS)
+					Value = pWD->Status;
+			}
+		
+			pBuffer[i] = Value;
+		}
+	} while (SEQLOCK_READ_RETRY (g_WD_Seq, Seq));
+}
+//---------------------------------------------------------------------------------------------
+// write after 'write enable' sequence; return false for read-only or reserved address.
+extern bool WD_Is_Writable (uint16_t Addr)
+{
+	uint8_t Offset = (Addr - WD_CHANNEL_ADDR) % WD_REG_SIZE;
+	
+	if (Addr == WD_LEGACY_ADDR)
+		return (true);
+	if ( (Addr < WD_CHANNEL_ADDR) || (Addr >= WD_CHANNEL_ADDR + WD_CHANNELS*WD_REG_SIZE) )
+		return (false);
+	
+	return ( (Offset == WD_REG_CONTROL) || 
+			 ((Offset >= WD_REG_TIMEOUT) && (Offset < WD_REG_TIMEOUT+4)) || 
+			 ((Offset >= WD_REG_PRETIMEOUT) && (Offset < WD_REG_PRETIMEOUT+2)) );
+}
+//---------------------------------------------------------------------------------------------
+extern bool WD_Write_Reg (uint16_t Addr, uint8_t Data)
+{
+	if (WD_Is_Writable (Addr) == false)
+		return (false); // read-only 
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (Addr == WD_LEGACY_ADDR)
+		{
+			if (g_WD_Cfg == 0)
+			{
+				g_WD_Cfg = Data;
+				g_WD[0].Control = (Data & (WD_CONTROL_CORST | WD_CONTROL_PORST)) | WD_CONTROL_START;
+				g_WD[0].TimeOut = ((uint32_t)1<<(g_WD_Cfg>>4)) * 1000;
+				g_WD[0].PreTimeOut = 0;
+				WD_Channel_Start (0);
+			}
+			WD_Touch ();
+		}
+		else
+		{
+			uint8_t Channel = (Addr - WD_CHANNEL_ADDR) / WD_REG_SIZE;
+			uint8_t Offset = (Addr - WD_CHANNEL_ADDR) % WD_REG_SIZE;
+			uint8_t Shift;
+			WD_CHANNEL *pWD = &g_WD[Channel];
+			
+			if (Offset == WD_REG_CONTROL)
+			{
+				pWD->Control = Data;
+				if (Data & WD_CONTROL_START)
+					WD_Channel_Start (Channel);
+				else
+					WD_Channel_Stop (Channel);
+			}
+			else if ( (Offset >= WD_REG_TIMEOUT) && (Offset < WD_REG_TIMEOUT+4) )
+			{
+				Shift = 8*(Offset - WD_REG_TIMEOUT);
+				pWD->TimeOut = (pWD->TimeOut & ~((uint32_t)0xFF << Shift)) | ((uint32_t)Data << Shift);
+			}
+			else // WD_REG_PRETIMEOUT (see WD_Is_Writable)
+			{
+				Shift = 8*(Offset - WD_REG_PRETIMEOUT);
+				pWD->PreTimeOut = (pWD->PreTimeOut & ~((uint16_t)0xFF << Shift)) | ((uint16_t)Data << Shift);
+			}
+		}
+		SEQLOCK_WRITE (g_WD_Seq);
+	}
+	
+	return (true);
+}
+//---------------------------------------------------------------------------------------------
@@ -0,0 +1,50 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _BMC_WD_H_
+#define _BMC_WD_H_
+
+#define WD_CHANNELS 4 // number of independent BMC watchdog channels
+
+// Emulated EEPROM addresses (see I2C_Device_EEPROM.c)
+#define WD_LEGACY_ADDR		0x3000	// 0x3000..0x3004: legacy register (channel 0); write via 'write enable' sequence.
+#define WD_CHANNEL_ADDR		0x3100	// 0x3100..0x313F: channel registers, 16 bytes per channel; write via 'write enable' sequence.
+#define WD_KICK_ADDR		0x3F00	// 0x3F00..0x3F03: kick register per channel; single byte write with the channel key (no 'write enable' sequence).
+
+// Channel registers (offset from WD_CHANNEL_ADDR + 0x10 * channel):
+#define WD_REG_CONTROL		0x00 // RW: bit 0: assert CORST# on time-out; bit 1: assert PORST# on time-out; bit 2: assert INT# on pre-timeout; 
+								 //     bit 7: write 1 to start (or restart) the channel, 0 to stop; read 1 while running.
+#define WD_REG_TIMEOUT		0x01 // RW: 0x01..0x04: time-out in msec (32-bit, LSB first).
+#define WD_REG_PRETIMEOUT	0x05 // RW: 0x05..0x06: pre-timeout warning in msec before time-out (16-bit, LSB first).
+#define WD_REG_KEY			0x07 // RO: key expected by the next kick; key is rolled on each valid kick (8-bit LFSR, x^8+x^6+x^5+x^4+1).
+#define WD_REG_REMAIN		0x08 // RO: 0x08..0x0B: remaining time in msec (32-bit, LSB first).
+#define WD_REG_STATUS		0x0C // RO: bit 0: running; bit 1: pre-timeout INT# asserted; bit 2: time-out occurred (cleared on start).
+#define WD_REG_SIZE			0x10
+
+#define WD_CONTROL_CORST	0x01
+#define WD_CONTROL_PORST	0x02
+#define WD_CONTROL_INT		0x04
+#define WD_CONTROL_START	0x80
+
+#define WD_STATUS_RUNNING	0x01
+#define WD_STATUS_PRETIMEOUT 0x02
+#define WD_STATUS_TIMEOUT	0x04
+
+extern void WD_Init (uint8_t DeviceIndex); // I2C device index of WD registers (emulated EEPROM); used as alert source.
+extern void WD_PeriodicTask (uint32_t ElapsedTime /*msec*/);
+extern void WD_BackgroundTask (void); // log and print time-outs; call from main loop.
+extern void WD_Touch (void);
+extern void WD_Stop (void);
+
+extern bool WD_Kick (uint8_t Channel, uint8_t Key); // return false on wrong key or stopped channel.
+extern void WD_Read_Regs (uint16_t Addr, uint8_t *pBuffer, uint8_t Size);
+extern bool WD_Write_Reg (uint16_t Addr, uint8_t Data); // return false if the register is read-only (nothing is written).
+extern bool WD_Is_Writable (uint16_t Addr); // same address check as WD_Write_Reg, without writing.
+
+#endif
+
+
@@ -0,0 +1,344 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+ I2C Bootloader (firmware self-update)
+ ************************************
+
+ ATtiny1634 has no boot section (no BOOTRST fuse and no read-while-write); SPM can be executed from any address and halts
+ the CPU while programming. The bootloader is placed at BOOT_START (.bootvector and .bootloader sections) and takes the 
+ reset vector over:
+ * The application enter the bootloader (Boot_Request) through the fixed vector BOOT_ENTER_VECTOR, since the resident 
+   bootloader may be from another build than the application (the bootloader area is never programmed over I2C).
+ * On entry from the application, page 0 is reprogrammed with 'rjmp' to the reset vector at BOOT_START and the original
+   reset vector is kept in the boot record (last flash page). Only word 0 is replaced: the crt vector table of the
+   ATtiny1634 (16K flash) has 4 bytes 'jmp k' entries, so word 1 (k; the start-up code word address) is kept in page 0.
+   Forward 'rjmp' (2 bytes entries; e.g., built with -mshort-calls) is accepted as well (see Boot_App_Entry).
+ * On reset, Boot_Reset jump to the application reset vector if the boot record is valid; otherwise it stays in the
+   bootloader (e.g., power loss in the middle of update), so a failed update can always be retried over I2C.
+ * Pages are received over the TWI slave (polled; interrupts are disabled) and programmed on stop. Page 0 is
+   programmed with the bootloader reset vector; the image reset vector is kept for the boot record.
+ * The image is verified by CRC-16 before the boot record is marked valid. The bootloader area is never programmed.
+
+ Note: bootloader code must not call any function out of the .bootvector and .bootloader sections (including libgcc helpers),
+ and must not use global variables (the C start-up code is not executed on Boot_Reset).
+ See protocol in Boot.h.
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/boot.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "SystemTick.h"
+#include "EEPROM_Queue.h"
+#include "Boot.h"
+
+#define BOOT_SECTION __attribute__ ((section (".bootloader"), noinline, used))
+
+#define BOOT_VALID			0xA55A
+#define BOOT_RECORD_RESET	(BOOT_RECORD + 0) // application reset vector (image word 0; 'jmp' opcode or 'rjmp' instruction)
+#define BOOT_RECORD_PAGES	(BOOT_RECORD + 2)
+#define BOOT_RECORD_CRC		(BOOT_RECORD + 4)
+#define BOOT_RECORD_VALID	(BOOT_RECORD + 6)
+
+#define BOOT_JMP			0x940C // 'jmp k' first word, k[21:16] = 0; the second word is k[15:0]
+
+#define BOOT_BUFFER_SIZE	(3 + SPM_PAGESIZE) // command, page number and page data
+
+// boot record page at BOOT_RECORD; erased in the image (not valid). 
+static const uint8_t Boot_Record [SPM_PAGESIZE] __attribute__ ((section (".bootrecord"), used)) = { [0 ... SPM_PAGESIZE-1] = 0xFF };
+
+static bool g_Boot_Request;
+static uint32_t g_Boot_Request_Time;
+
+extern void Boot_Vectors (void) __attribute__ ((section (".bootvector"), naked, used));
+extern void Boot_Reset (void) __attribute__ ((section (".bootloader"), naked, used));
+extern void Boot_Enter (void) __attribute__ ((section (".bootloader"), naked, used));
+static void Boot_Start (void) BOOT_SECTION __attribute__ ((noreturn));
+static void Boot_Main (bool FromApp) BOOT_SECTION __attribute__ ((noreturn));
+
+//--------------------------------------------------------------------------------------
+// 'rjmp' instruction at word address From to word address To; PC wraps around the 8K words flash.
+static uint16_t BOOT_SECTION Boot_Rjmp (uint16_t From, uint16_t To)
+{
+	return (0xC000 | ((To - From - 1) & 0x0FFF));
+}
+//--------------------------------------------------------------------------------------
+// Word address of the application start-up code from its reset vector (AppReset: image word 0; word 1 is read from page 0,
+// which keep it); 0 if the vector is not 'jmp' or forward 'rjmp' into the application area.
+static uint16_t BOOT_SECTION Boot_App_Entry (uint16_t AppReset)
+{
+	uint16_t Entry = 0;
+
+	if (AppReset == BOOT_JMP)
+		Entry = pgm_read_word (2);
+	else if ((AppReset & 0xF800) == 0xC000)
+		Entry = (AppReset & 0x07FF) + 1;
+
+	if ( (Entry < 2) || (Entry >= (BOOT_START / 2)) )
+		return (0);
+
+	return (Entry);
+}
+//--------------------------------------------------------------------------------------
+static void BOOT_SECTION Boot_Program_Page (uint16_t Addr, const uint8_t *pData)
+{
+	uint8_t i;
+
+	while (IS_BIT_SET (EECR, EEPE)); // SPM is ignored while EEPROM is programmed
+	boot_page_erase (Addr);
+	boot_spm_busy_wait ();
+	for (i = 0; i < SPM_PAGESIZE; i += 2)
+		boot_page_fill (Addr + i, (uint16_t)pData[i] | ((uint16_t)pData[i+1] << 8));
+	boot_page_write (Addr);
+	boot_spm_busy_wait ();
+}
+//--------------------------------------------------------------------------------------
+static void BOOT_SECTION Boot_Write_Record (uint16_t AppReset, uint16_t Pages, uint16_t CRC, uint16_t Valid)
+{
+	uint8_t Record [SPM_PAGESIZE];
+	uint8_t i;
+
+	for (i = 0; i < SPM_PAGESIZE; i++)
+		Record[i] = 0xFF;
+	Record[0] = (uint8_t)AppReset;
+	Record[1] = (uint8_t)(AppReset >> 8);
+	Record[2] = (uint8_t)Pages;
+	Record[3] = (uint8_t)(Pages >> 8);
+	Record[4] = (uint8_t)CRC;
+	Record[5] = (uint8_t)(CRC >> 8);
+	Record[6] = (uint8_t)Valid;
+	Record[7] = (uint8_t)(Valid >> 8);
+	Boot_Program_Page (BOOT_RECORD, Record);
+}
+//--------------------------------------------------------------------------------------
+// CRC-16 of image pages 0..Pages-1; word 0 is the image reset vector (AppReset) and not the programmed one.
+static uint16_t BOOT_SECTION Boot_Image_CRC (uint16_t Pages, uint16_t AppReset)
+{
+	uint16_t CRC = 0xFFFF;
+	uint16_t Size = Pages << 5; // Pages * SPM_PAGESIZE
+	uint16_t Addr;
+
+	CRC = _crc16_update (CRC, (uint8_t)AppReset);
+	CRC = _crc16_update (CRC, (uint8_t)(AppReset >> 8));
+	for (Addr = 2; Addr < Size; Addr++)
+		CRC = _crc16_update (CRC, pgm_read_byte (Addr));
+
+	return (CRC);
+}
+//--------------------------------------------------------------------------------------
+// execute command on stop; return new status.
+static uint8_t BOOT_SECTION Boot_Command (uint8_t *pBuffer, uint8_t Length, uint16_t *pAppReset, uint16_t *pPage)
+{
+	uint16_t Value = (uint16_t)pBuffer[1] | ((uint16_t)pBuffer[2] << 8);
+
+	if ( (pBuffer[0] == BOOT_CMD_PAGE) && (Length == BOOT_BUFFER_SIZE) && (Value < BOOT_APP_PAGES) )
+	{
+		if (pgm_read_word (BOOT_RECORD_VALID) == BOOT_VALID)
+			Boot_Write_Record (*pAppReset, 0xFFFF, 0xFFFF, 0xFFFF); // application is modified; invalidate.
+
+		if (Value == 0)
+		{
+			*pAppReset = (uint16_t)pBuffer[3] | ((uint16_t)pBuffer[4] << 8);
+			Value = Boot_Rjmp (0, (uint16_t)Boot_Vectors);
+			pBuffer[3] = (uint8_t)Value;
+			pBuffer[4] = (uint8_t)(Value >> 8);
+			Value = 0;
+		}
+		Boot_Program_Page (Value << 5, pBuffer + 3);
+		*pPage = Value;
+		return (BOOT_STATUS_READY);
+	}
+
+	if ( (pBuffer[0] == BOOT_CMD_FINISH) && (Length == 5) && (Value != 0) && (Value <= BOOT_APP_PAGES) )
+	{
+		uint16_t CRC = (uint16_t)pBuffer[3] | ((uint16_t)pBuffer[4] << 8);
+
+		if ( (Boot_App_Entry (*pAppReset) == 0) || (Boot_Image_CRC (Value, *pAppReset) != CRC) )
+			return (BOOT_STATUS_READY | BOOT_STATUS_ERROR);
+
+		Boot_Write_Record (*pAppReset, Value, CRC, BOOT_VALID);
+		return (BOOT_STATUS_VALID);
+	}
+
+	if ( (pBuffer[0] == BOOT_CMD_RUN) && (Length == 1) && (pgm_read_word (BOOT_RECORD_VALID) == BOOT_VALID) )
+	{
+		CCP = 0xD8; // Configuration Change Protection Register (Timed Sequences)
+		WDTCSR = (1<<WDE); // 16 msec; reset
+		while (1);
+	}
+
+	return (BOOT_STATUS_READY | BOOT_STATUS_ERROR);
+}
+//--------------------------------------------------------------------------------------
+// Take the reset vector over on entry from the application; return the application reset vector (image word 0).
+// pBuffer: SPM_PAGESIZE bytes. Only word 0 of page 0 is replaced, word 1 ('jmp' target) is kept.
+static uint16_t BOOT_SECTION Boot_Take_Over (uint8_t *pBuffer)
+{
+	uint16_t Vector = Boot_Rjmp (0, (uint16_t)Boot_Vectors);
+	uint16_t AppReset = pgm_read_word (0);
+	uint8_t i;
+
+	if (AppReset == Vector)
+		return (pgm_read_word (BOOT_RECORD_RESET)); // already taken over
+
+	Boot_Write_Record (AppReset, 0, 0xFFFF, BOOT_VALID); // application is not modified yet; record first (power loss safe)
+	for (i = 0; i < SPM_PAGESIZE; i++)
+		pBuffer[i] = pgm_read_byte (i);
+	pBuffer[0] = (uint8_t)Vector;
+	pBuffer[1] = (uint8_t)(Vector >> 8);
+	Boot_Program_Page (0, pBuffer);
+
+	return (AppReset);
+}
+//--------------------------------------------------------------------------------------
+// Polled TWI slave at BOOT_I2C_ADDR; interrupts are disabled.
+// The page buffer exceed STACK_FRAME_BUDGET; no ISR nest over the bootloader, so the whole RAM is its stack (see Stack.h).
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstack-usage="
+static void BOOT_SECTION Boot_Main (bool FromApp)
+{
+	uint8_t Buffer [BOOT_BUFFER_SIZE];
+	uint8_t Status [3];
+	uint16_t AppReset = pgm_read_word (BOOT_RECORD_RESET);
+	uint16_t Page = 0xFFFF;
+	uint8_t Count = 0;
+	bool Read = false;
+
+	if (FromApp)
+		AppReset = Boot_Take_Over (Buffer);
+
+	Status[0] = BOOT_STATUS_READY;
+	if (pgm_read_word (BOOT_RECORD_VALID) == BOOT_VALID)
+		Status[0] |= BOOT_STATUS_VALID;
+
+	TWSCRA = 0; // Disable TWI
+	TWSA = BOOT_I2C_ADDR << 1;
+	TWSAM = 0;
+	TWSCRA = (1<<TWEN) | (1<<TWSIE); // Enable TWI and stop condition detector; flags are polled.
+
+	while (1)
+	{
+		uint8_t reg_TWSSRA = TWSSRA;
+
+		__asm__ __volatile__ ("wdr"); // reset (touch) ATtiny1634 Watchdog
+
+		if (IS_BIT_SET (reg_TWSSRA, TWASIF))
+		{
+			if ( (IS_BIT_SET (reg_TWSSRA, TWC)) || (IS_BIT_SET (reg_TWSSRA, TWBE)) )
+			{// bus error
+				Count = 0;
+				Read = true; // ignore the received bytes
+			}
+			else if (IS_BIT_SET (reg_TWSSRA, TWAS))
+			{// start or re-start
+				Count = 0;
+				Read = IS_BIT_SET (reg_TWSSRA, TWDIR);
+				Status[1] = (uint8_t)Page;
+				Status[2] = (uint8_t)(Page >> 8);
+				CLEAR_BIT_REG (TWSCRB, TWAA); // ACK
+			}
+			else if ( (Read == false) && (Count != 0) )
+			{// stop after write; the CPU is halted while programming and the TWI hold the next address match.
+				TWSSRA = 1<<TWASIF;
+				Status[0] = Boot_Command (Buffer, Count, &AppReset, &Page);
+				Count = 0;
+				continue;
+			}
+			TWSSRA = 1<<TWASIF; // clear flag; also send response according to TWAA bit value.
+		}
+
+		if (IS_BIT_SET (reg_TWSSRA, TWDIF))
+		{
+			if (Read)
+			{
+				TWSD = (Count < sizeof (Status)) ? Status[Count] : 0xFF;
+				Count++;
+			}
+			else if (Count < sizeof (Buffer))
+			{
+				Buffer[Count++] = TWSD;
+				CLEAR_BIT_REG (TWSCRB, TWAA); // ACK
+			}
+			else
+			{
+				SET_BIT_REG (TWSCRB, TWAA); // NACK
+			}
+			TWSSRA = 1<<TWDIF; // clear flag
+		}
+	}
+}
+#pragma GCC diagnostic pop
+//--------------------------------------------------------------------------------------
+static void BOOT_SECTION Boot_Start (void)
+{
+	uint16_t Entry = Boot_App_Entry (pgm_read_word (BOOT_RECORD_RESET));
+
+	if ( (pgm_read_word (BOOT_RECORD_VALID) == BOOT_VALID) && (Entry != 0) )
+	{ // run the application start-up code
+		void (*pApp)(void) = (void (*)(void)) Entry;
+
+		pApp ();
+	}
+
+	Boot_Main (false);
+}
+//--------------------------------------------------------------------------------------
+// Entry vectors at BOOT_START (see Boot.h); their order is fixed.
+extern void Boot_Vectors (void)
+{
+	__asm__ __volatile__ ("rjmp Boot_Reset \n\t" "rjmp Boot_Enter \n\t");
+}
+//--------------------------------------------------------------------------------------
+// Reset vector (once the bootloader was entered); the C start-up code was not executed and SP is RAMEND.
+extern void Boot_Reset (void)
+{
+	__asm__ __volatile__ ("clr __zero_reg__");
+	Boot_Start ();
+}
+//--------------------------------------------------------------------------------------
+// Enter from the application (BOOT_ENTER_VECTOR); interrupts and TWI are disabled.
+extern void Boot_Enter (void)
+{
+	__asm__ __volatile__ ("clr __zero_reg__");
+	Boot_Main (true);
+}
+//--------------------------------------------------------------------------------------
+extern void Boot_Request (void)
+{
+	g_Boot_Request = true;
+	g_Boot_Request_Time = SystemTick_Get_msec ();
+}
+//--------------------------------------------------------------------------------------
+// Call from main loop; enter the bootloader BOOT_ENTER_DELAY msec after the request (let the host complete the transaction).
+extern void Boot_BackgroundTask (void)
+{
+	if ( (g_Boot_Request == false) || (SystemTick_Get_msec () - g_Boot_Request_Time < BOOT_ENTER_DELAY) )
+		return;
+	
+	if (EEPROM_Queue_Pending () != 0)
+		return; // complete EEPROM writes first
+
+	printf_P (PSTR("> Enter bootloader; I2C address 0x%x. \r\n"), BOOT_I2C_ADDR);
+	cli ();
+	TWSCRA = 0; // Disable TWI
+	((void (*)(void)) BOOT_ENTER_VECTOR) (); // resident bootloader; not the Boot_Enter of this image
+}
+//--------------------------------------------------------------------------------------
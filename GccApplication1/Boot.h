@@ -0,0 +1,55 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+// Flash layout (byte addresses):
+// * 0x0000..BOOT_START-1: application; the reset vector is redirected to the bootloader once the bootloader was entered.
+// * BOOT_START..BOOT_START+3: bootloader entry vectors (.bootvector section; linker flash setting .bootvector=0x1E00 words):
+//   word 0: reset ('rjmp' target of page 0); word 1: enter from the application (BOOT_ENTER_VECTOR). The application
+//   enter the resident bootloader by this fixed address, so an image built separately from it enter it correctly.
+// * BOOT_START+4..BOOT_RECORD-1: bootloader code (.bootloader section; linker flash setting .bootloader=0x1E02 words).
+// * BOOT_RECORD..0x3FFF: boot record (last flash page): application reset vector, number of pages, CRC-16 and valid mark.
+//   Reserved by the .bootrecord section (linker flash setting .bootrecord=0x1FF0 words); the link fail on section overlap
+//   if the bootloader code grow into it.
+#define BOOT_START			0x3C00
+#define BOOT_RECORD			(0x4000 - SPM_PAGESIZE)
+#define BOOT_APP_PAGES		(BOOT_START / SPM_PAGESIZE)
+#define BOOT_ENTER_VECTOR	((BOOT_START / 2) + 1) // word address
+
+// Bootloader I2C address; fixed, since the device layout in EEPROM may not be valid while updating.
+#define BOOT_I2C_ADDR		((uint8_t)(I2C_Slave_Addr + I2C_DEVICES - 1))
+
+// Enter the bootloader: write BOOT_ENTER_KEY to emulated EEPROM address BOOT_ENTER_ADDR (via 'write enable' sequence).
+// The bootloader is entered BOOT_ENTER_DELAY msec later, from main loop.
+#define BOOT_ENTER_ADDR		0x8020
+#define BOOT_ENTER_KEY		0xB0
+#define BOOT_ENTER_DELAY	10 // msec
+
+// Bootloader commands (write transaction to BOOT_I2C_ADDR; executed on stop):
+// * BOOT_CMD_PAGE:   [0x01][page[7:0]][page[15:8]][SPM_PAGESIZE data bytes]; page 0..BOOT_APP_PAGES-1.
+//                    The first page invalidates the boot record. The page is programmed on stop (the CPU is halted ~9 msec;
+//                    the TWI holds SCL low on the next address match until the CPU resume).
+// * BOOT_CMD_FINISH: [0x02][pages[7:0]][pages[15:8]][crc[7:0]][crc[15:8]]; CRC-16 (x^16+x^15+x^2+1, reflected, initial 0xFFFF)
+//                    of the image pages 0..pages-1 as sent by the host. On match, the boot record is marked valid.
+// * BOOT_CMD_RUN:    [0x03]; reset (via watchdog) and run the application if the boot record is valid.
+// Read transaction: [status][page[7:0]][page[15:8]] (last programmed page).
+#define BOOT_CMD_PAGE		0x01
+#define BOOT_CMD_FINISH		0x02
+#define BOOT_CMD_RUN		0x03
+
+#define BOOT_STATUS_READY	0x01 // waiting for pages
+#define BOOT_STATUS_VALID	0x02 // boot record is valid (image verified)
+#define BOOT_STATUS_ERROR	0x80 // last command failed (bad length, page out of range, CRC mismatch or no valid image)
+
+extern void Boot_Request (void); // enter the bootloader from main loop (see Boot_BackgroundTask)
+extern void Boot_BackgroundTask (void);
+
+#endif
+
+
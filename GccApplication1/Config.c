@@ -0,0 +1,120 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+   Module Configuration 
+ ************************************
+ 
+ Configuration record in ATtiny1634 EEPROM (see MODULE_CONFIG in Config.h) select the I2C base address, 
+ which emulated devices are enabled and their device index (I2C address offset), SMBus PEC and I2C time-out.
+ 
+ * The record is read once on reset; the I2C slave dispatch table (pI2C_Device_Func) is built from it, so the TWI interrupt is not affected.
+ * Invalid record (CRC, address alignment, duplicate device or EEPROM device not mapped) is ignored and the defaults (flash and build settings) are used.
+ * The host update the record by the emulated EEPROM (0x0038..0x003F) and reset the module.
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "EEPROM_Queue.h"
+#include "Config.h"
+
+//---------------------------------------------------------------------------------------------
+static uint8_t Config_Get_Device (MODULE_CONFIG *pConfig, uint8_t DeviceIndex)
+{
+	return ((pConfig->Layout[DeviceIndex>>1] >> ((DeviceIndex & 0x01) * 4)) & 0x0F);
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t Config_Get_Devices (MODULE_CONFIG *pConfig)
+{
+	uint8_t Devices = 1;
+	uint8_t i;
+	
+	for (i = 0; i < I2C_DEVICES; i++)
+	{
+		if (Config_Get_Device (pConfig, i) == CONFIG_DEV_NONE)
+			continue;
+		while (Devices <= i)
+			Devices <<= 1;
+	}
+	
+	return (Devices);
+}
+//---------------------------------------------------------------------------------------------
+static bool Config_Is_Valid (MODULE_CONFIG *pConfig)
+{
+	uint8_t *pData = (uint8_t *) pConfig;
+	uint8_t Crc = 0;
+	uint16_t Used = 0; // bit per device id
+	uint8_t i, DeviceId, Devices;
+	
+	for (i = 0; i < sizeof(MODULE_CONFIG) - 1; i++)
+		Crc = _crc8_ccitt_update (Crc, pData[i]);
+	if (Crc != pConfig->CRC)
+		return (false);
+	
+	Devices = Config_Get_Devices (pConfig);
+	if ( (pConfig->BaseAddr & (Devices-1)) || (pConfig->BaseAddr < 0x08) || (pConfig->BaseAddr + Devices - 1 > 0x77) )
+		return (false); // not aligned or reserved I2C address 
+	
+	for (i = 0; i < I2C_DEVICES; i++)
+	{
+		DeviceId = Config_Get_Device (pConfig, i);
+		if (DeviceId == CONFIG_DEV_NONE)
+			continue;
+		if ( (DeviceId > CONFIG_DEV_MAX) || (Used & (1U<<DeviceId)) )
+			return (false); // unknown or duplicate device 
+		Used |= 1U<<DeviceId;
+	}
+	
+	if ( (Used & (1U<<CONFIG_DEV_EEPROM)) == 0 )
+		return (false); // the emulated EEPROM is the only way to update the record; layout without it lock the module out. 
+	
+	return (true);
+}
+//---------------------------------------------------------------------------------------------
+extern bool Config_Load (MODULE_CONFIG *pConfig /*in: defaults; out: active configuration*/)
+{
+	MODULE_CONFIG Config;
+	uint8_t i;
+	
+	for (i = 0; i < sizeof(Config); i++)
+		((uint8_t*)&Config)[i] = EEPROM_Queue_Read (CONFIG_EE_ADDR + i);
+	
+	if (Config_Is_Valid (&Config) == false)
+	{
+		printf_P (PSTR("> Config: EEPROM record is not valid; use defaults. \r\n"));
+		return (false);
+	}
+	
+	memcpy ((void*)pConfig, (const void*)&Config, sizeof(Config));
+	printf_P (PSTR("> Config: EEPROM record; base address: 0x%x; \r\n"), pConfig->BaseAddr);
+	return (true);
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t Config_Get_Index (MODULE_CONFIG *pConfig, uint8_t DeviceId)
+{
+	uint8_t i;
+	
+	for (i = 0; i < I2C_DEVICES; i++)
+		if (Config_Get_Device (pConfig, i) == DeviceId)
+			return (i);
+	
+	return (I2C_DEVICE_NONE);
+}
+//---------------------------------------------------------------------------------------------
@@ -0,0 +1,43 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#define CONFIG_EE_ADDR		0x38 // ATtiny1634 EEPROM address of the configuration record (0x38..0x3F); writable via emulated EEPROM ('write enable' sequence).
+
+// emulated device id 
+#define CONFIG_DEV_NONE		0x0
+#define CONFIG_DEV_EEPROM	0x1
+#define CONFIG_DEV_ADC		0x2
+#define CONFIG_DEV_GPI		0x3
+#define CONFIG_DEV_SRAM		0x4
+#define CONFIG_DEV_STATUS	0x5
+#define CONFIG_DEV_TEMP		0x6
+#define CONFIG_DEV_GPIO		0x7
+#define CONFIG_DEV_FAN		0x8 // FAN_DEVICE builds only (see I2C_Device_Fan.h)
+#define CONFIG_DEV_MAX		CONFIG_DEV_FAN
+
+#define I2C_DEVICE_NONE		0xFF // device index of a device which is not enabled (initialized but not registered to the I2C slave module)
+
+// Configuration record (8 bytes); applied on reset.
+typedef struct
+{
+	uint8_t BaseAddr;  // 0x38: I2C 7-bit base address; must aline to the number of addresses claimed (see Config_Get_Devices).
+	uint8_t Layout[4]; // 0x39..0x3C: device id per I2C device index (4-bit each); index 0 is Layout[0] bits 3..0, index 1 is Layout[0] bits 7..4 and so on.
+	uint8_t PEC;       // 0x3D: SMBus PEC enable; bit per device index. 
+	uint8_t TimeOut;   // 0x3E: I2C time-out in msec; 0 to disable.
+	uint8_t CRC;       // 0x3F: CRC-8 (x^8+x^2+x+1, initial value 0) of 0x38..0x3E.
+} MODULE_CONFIG;
+
+extern bool Config_Load (MODULE_CONFIG *pConfig /*in: defaults; out: active configuration*/); // return true if EEPROM record is valid and used.
+extern uint8_t Config_Get_Index (MODULE_CONFIG *pConfig, uint8_t DeviceId); // return device index or I2C_DEVICE_NONE.
+extern uint8_t Config_Get_Devices (MODULE_CONFIG *pConfig); // number of I2C addresses claimed: highest used device index + 1, rounded up to a power of 2.
+
+#endif
+
+
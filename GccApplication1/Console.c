@@ -0,0 +1,385 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+ Console on hardware USART0
+ ************************************
+
+ * TX and RX are interrupt driven and buffered; printf does not block unless the TX buffer is full.
+ * Command shell (one command per line; numbers are decimal or 0x hex):
+   ?                          help
+   c                          counters
+   l                          event log (decoded; newest event first)
+   L                          clear event log
+   e                          EEPROM consistency check (see EEPROM_Queue.h)
+   a                          ADC scan (RunBMC channels 0..7)
+   w                          BMC watchdog channels
+   w <ch> <control> <msec>    set BMC watchdog channel time-out and control (see BMC_WD.h)
+   d [<mask>]                 show or set LOG_DEBUG run-time mask (bit per module; see Log.h)
+   t                          I2C conformance self-test (I2C_SELF_TEST; see I2C_Test.h)
+   f [<events> [<seed>]]      I2C fuzzing (I2C_SELF_TEST; see I2C_Test.h); default 1000 events, continue previous sequence; writes to SRAM and status only
+   p                          ISR profile (ISR_PROFILE; see Profile.h)
+   P                          clear ISR profile
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "Console.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_ADC.h"
+#include "EEPROM_Queue.h"
+#include "EventLog.h"
+#include "SystemTick.h"
+#include "BMC_WD.h"
+#include "Trace.h"
+#include "Stack.h"
+#include "Config.h"
+#include "I2C_Test.h"
+#include "Profile.h"
+#define LOG_MODULE MAIN
+#include "Log.h"
+
+#if (CONSOLE_USART == 1)
+
+#define F_CPU 8000000UL  // 8 MHz
+#define CONSOLE_UBRR ((uint16_t)(F_CPU / 8 / CONSOLE_BAUD - 1))
+
+static volatile uint8_t g_Console_Tx [CONSOLE_TX_BUFFER];
+static volatile uint8_t g_Console_Tx_Head; // next byte to write
+static volatile uint8_t g_Console_Tx_Tail; // next byte to send
+static volatile uint8_t g_Console_Rx [CONSOLE_RX_BUFFER];
+static volatile uint8_t g_Console_Rx_Head; // next byte to receive
+static volatile uint8_t g_Console_Rx_Tail; // next byte to read
+static char g_Console_Line [CONSOLE_LINE + 1];
+static uint8_t g_Console_Line_Length;
+
+static int Console_PutChar_Stream (char var, FILE *stream);
+static int Console_GetChar_Stream (FILE *stream);
+
+static FILE Console_Stream = FDEV_SETUP_STREAM(Console_PutChar_Stream, Console_GetChar_Stream, _FDEV_SETUP_RW);
+
+//--------------------------------------------------------------------------------------
+static int Console_PutChar_Stream (char var, FILE *stream)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint8_t Next = (g_Console_Tx_Head + 1) & (CONSOLE_TX_BUFFER-1);
+
+		while (Next == g_Console_Tx_Tail)
+		{ // buffer is full; send the oldest byte directly (interrupts may be disabled, e.g., printf from ISR).
+			while (IS_BIT_CLEARED (UCSR0A, UDRE0));
+			UDR0 = g_Console_Tx [g_Console_Tx_Tail];
+			g_Console_Tx_Tail = (g_Console_Tx_Tail + 1) & (CONSOLE_TX_BUFFER-1);
+		}
+
+		g_Console_Tx [g_Console_Tx_Head] = var;
+		g_Console_Tx_Head = Next;
+		SET_BIT_REG (UCSR0B, UDRIE0); // Enable Data Register Empty Interrupt
+	}
+
+	return (0);
+}
+//--------------------------------------------------------------------------------------
+static int Console_GetChar_Stream (FILE *stream)
+{
+	int Data = _FDEV_EOF;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (g_Console_Rx_Tail != g_Console_Rx_Head)
+		{
+			Data = g_Console_Rx [g_Console_Rx_Tail];
+			g_Console_Rx_Tail = (g_Console_Rx_Tail + 1) & (CONSOLE_RX_BUFFER-1);
+		}
+	}
+
+	return (Data);
+}
+//--------------------------------------------------------------------------------------
+extern void Console_Init (void)
+{
+	stdout = &Console_Stream;
+	stdin = &Console_Stream;
+
+	g_Console_Tx_Head = 0;
+	g_Console_Tx_Tail = 0;
+	g_Console_Rx_Head = 0;
+	g_Console_Rx_Tail = 0;
+	g_Console_Line_Length = 0;
+
+	CLEAR_BIT_REG (PRR, PRUSART0); // disable Power Reduction USART0, if any.
+	WRITE_REG (UBRR0, CONSOLE_UBRR);
+	WRITE_REG (UCSR0A, 1<<U2X0); // double speed
+	WRITE_REG (UCSR0C, 1<<UCSZ01 | 1<<UCSZ00); // asynchronous; 8 bit; no parity; 1 stop bit.
+	WRITE_REG (UCSR0B, 1<<RXCIE0 | 1<<RXEN0 | 1<<TXEN0); // RX complete interrupt; RX and TX enable (override PA7 and PB0).
+
+	printf_P (PSTR(" \r\n"));
+	printf_P (PSTR(" *********************  \r\n"));
+	printf_P (PSTR(" Hello from ATtiny1634  \r\n"));
+	printf_P (PSTR(" *********************  \r\n"));
+	printf_P (PSTR(" \r\n"));
+	printf_P (PSTR("> Console: USART0 %lu bps; '?' for help. \r\n"), CONSOLE_BAUD);
+}
+//--------------------------------------------------------------------------------------
+// parse the next number of the command line (decimal or 0x hex); return false if not found.
+static bool Console_Parse_Number (char **ppLine, uint32_t *pValue)
+{
+	char *p = *ppLine;
+	uint8_t Base = 10;
+	bool Found = false;
+
+	while (*p == ' ')
+		p++;
+
+	if ( (p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X')) )
+	{
+		Base = 16;
+		p += 2;
+	}
+
+	*pValue = 0;
+	while (1)
+	{
+		uint8_t Digit;
+
+		if ( (*p >= '0') && (*p <= '9') )
+			Digit = *p - '0';
+		else if ( (Base == 16) && ((*p | 0x20) >= 'a') && ((*p | 0x20) <= 'f') )
+			Digit = (*p | 0x20) - 'a' + 10;
+		else
+			break;
+
+		*pValue = *pValue * Base + Digit;
+		Found = true;
+		p++;
+	}
+
+	*ppLine = p;
+	return (Found);
+}
+//--------------------------------------------------------------------------------------
+static void Console_Cmd_Counters (void)
+{
+	uint16_t Recovery = I2C_Slave_Get_Recovery_Count ();
+	uint16_t Stuck = I2C_Slave_Get_Stuck_Count ();
+	uint16_t PEC_Error = I2C_Slave_Get_PEC_Error_Count ();
+
+	printf_P (PSTR("> Up-time: %lu msec \r\n"), SystemTick_Get_msec ());
+	printf_P (PSTR("> I2C: recovery %u; stuck %u; PEC error %u; alert 0x%02X \r\n"), Recovery, Stuck, PEC_Error, I2C_Slave_Get_Alert ());
+	printf_P (PSTR("> Event log: lost %u; EEPROM queue pending %u \r\n"), EventLog_Get_Lost (), EEPROM_Queue_Pending ());
+	printf_P (PSTR("> Stack: %u bytes; unused %u bytes \r\n"), Stack_Get_Size (), Stack_Get_Unused ());
+}
+//--------------------------------------------------------------------------------------
+static void Console_Cmd_EventLog (void)
+{
+	uint8_t Entry [EVENTLOG_DECODED_ENTRY_SIZE];
+	uint8_t i;
+
+	for (i = 0; i < EVENTLOG_DECODED_ENTRIES; i++)
+	{
+		EventLog_Read_Decoded (i * EVENTLOG_DECODED_ENTRY_SIZE, Entry, sizeof (Entry));
+		if (Entry[0] == 0xFF)
+			break; // no more entries
+
+		printf_P (PSTR("> %2u: event 0x%02X; +%lu msec"), i, Entry[0], (uint32_t)Entry[4] | (uint32_t)Entry[5]<<8 | (uint32_t)Entry[6]<<16 | (uint32_t)Entry[7]<<24);
+		if (Entry[1] & EVENTLOG_DECODED_FLAG_PAYLOAD)
+			printf_P (PSTR("; payload 0x%02X"), Entry[2]);
+		printf_P (PSTR(" \r\n"));
+	}
+
+	if (i == 0)
+		printf_P (PSTR("> Event log is empty \r\n"));
+}
+//--------------------------------------------------------------------------------------
+static void Console_Cmd_ADC (void)
+{
+	uint8_t Channel;
+
+	for (Channel = 0; Channel < 8; Channel++)
+		printf_P (PSTR("> ADC%u: 0x%02X \r\n"), Channel, I2C_Device_ADC_Sample (Channel));
+}
+//--------------------------------------------------------------------------------------
+static void Console_Cmd_WD (char *pLine)
+{
+	uint8_t Regs [WD_REG_SIZE];
+	uint32_t Channel, Control, TimeOut;
+	uint8_t i;
+
+	if (Console_Parse_Number (&pLine, &Channel))
+	{
+		uint16_t Addr = WD_CHANNEL_ADDR + (uint16_t)Channel * WD_REG_SIZE;
+		bool Result = true;
+
+		if ( (Channel >= WD_CHANNELS) || (! Console_Parse_Number (&pLine, &Control)) || (! Console_Parse_Number (&pLine, &TimeOut)) )
+		{
+			printf_P (PSTR("> Usage: w <ch> <control> <msec> \r\n"));
+			return;
+		}
+
+		for (i = 0; i < 4; i++)
+			Result &= WD_Write_Reg (Addr + WD_REG_TIMEOUT + i, (uint8_t)(TimeOut >> (8*i)));
+		Result &= WD_Write_Reg (Addr + WD_REG_CONTROL, (uint8_t)Control);
+		if (! Result)
+			printf_P (PSTR("> WD write failed \r\n"));
+	}
+
+	for (i = 0; i < WD_CHANNELS; i++)
+	{
+		WD_Read_Regs (WD_CHANNEL_ADDR + (uint16_t)i * WD_REG_SIZE, Regs, sizeof (Regs));
+		printf_P (PSTR("> WD%u: control 0x%02X; time-out %lu; remain %lu; status 0x%02X \r\n"), i, Regs[WD_REG_CONTROL],
+			(uint32_t)Regs[WD_REG_TIMEOUT] | (uint32_t)Regs[WD_REG_TIMEOUT+1]<<8 | (uint32_t)Regs[WD_REG_TIMEOUT+2]<<16 | (uint32_t)Regs[WD_REG_TIMEOUT+3]<<24,
+			(uint32_t)Regs[WD_REG_REMAIN] | (uint32_t)Regs[WD_REG_REMAIN+1]<<8 | (uint32_t)Regs[WD_REG_REMAIN+2]<<16 | (uint32_t)Regs[WD_REG_REMAIN+3]<<24,
+			Regs[WD_REG_STATUS]);
+	}
+}
+//--------------------------------------------------------------------------------------
+static void Console_Execute (char *pLine)
+{
+	uint32_t Value;
+#if (I2C_SELF_TEST == 1)
+	uint32_t Seed;
+#endif
+
+	switch (pLine[0])
+	{
+		case 'c':
+			Console_Cmd_Counters ();
+			break;
+
+		case 'l':
+			Console_Cmd_EventLog ();
+			break;
+
+		case 'L':
+			if (EventLog_Clear ())
+				printf_P (PSTR("> Event log cleared \r\n"));
+			else
+				printf_P (PSTR("> Event log clear failed (EEPROM queue full) \r\n"));
+			break;
+
+		case 'e':
+			printf_P (PSTR("> EEPROM check: %u (0: OK; 1: busy; 2: mismatch) \r\n"), EEPROM_Queue_Check ());
+			break;
+
+		case 'a':
+			Console_Cmd_ADC ();
+			break;
+
+		case 'w':
+			Console_Cmd_WD (&pLine[1]);
+			break;
+
+		case 'd':
+			pLine++;
+			if (Console_Parse_Number (&pLine, &Value))
+				g_Log_Mask = (uint8_t)Value;
+			printf_P (PSTR("> Log trace mask: 0x%02X \r\n"), g_Log_Mask);
+			break;
+
+#if (I2C_SELF_TEST == 1)
+		case 't':
+			I2C_Test_Run ();
+			break;
+
+		case 'f':
+			pLine++;
+			if (! Console_Parse_Number (&pLine, &Value))
+				Value = 1000;
+			Console_Parse_Number (&pLine, &Seed); // 0 if not found
+			I2C_Test_Fuzz ((uint16_t)Seed, (uint16_t)Value);
+			break;
+#endif
+
+#if (ISR_PROFILE == 1)
+		case 'p':
+			Profile_Print ();
+			break;
+
+		case 'P':
+			Profile_Clear ();
+			printf_P (PSTR("> ISR profile cleared \r\n"));
+			break;
+#endif
+
+		default:
+			printf_P (PSTR("> Commands: c: counters; l: event log; L: clear event log; e: EEPROM check; a: ADC scan; w [<ch> <control> <msec>]: BMC watchdog; d [<mask>]: log trace mask; t: I2C self-test; f [<events> [<seed>]]: I2C fuzzing; p: ISR profile; P: clear ISR profile \r\n"));
+			break;
+	}
+}
+//--------------------------------------------------------------------------------------
+// Call from main loop.
+extern void Console_BackgroundTask (void)
+{
+	int Data;
+
+	while ( (Data = Console_GetChar_Stream (NULL)) != _FDEV_EOF )
+	{
+		if ( (Data == '\r') || (Data == '\n') )
+		{
+			if (g_Console_Line_Length == 0)
+				continue;
+
+			printf_P (PSTR("\r\n"));
+			g_Console_Line [g_Console_Line_Length] = 0;
+			g_Console_Line_Length = 0;
+			Console_Execute (g_Console_Line);
+		}
+		else if ( (Data == '\b') || (Data == 0x7F) )
+		{
+			if (g_Console_Line_Length != 0)
+			{
+				g_Console_Line_Length--;
+				printf_P (PSTR("\b \b"));
+			}
+		}
+		else if ( (Data >= ' ') && (g_Console_Line_Length < CONSOLE_LINE) )
+		{
+			g_Console_Line [g_Console_Line_Length++] = (char)Data;
+			putchar (Data); // echo
+		}
+	}
+}
+//--------------------------------------------------------------------------------------
+
+ISR(USART0_UDRE_vect, ISR_BLOCK)
+{
+	if (g_Console_Tx_Tail == g_Console_Tx_Head)
+	{
+		CLEAR_BIT_REG (UCSR0B, UDRIE0); // buffer is empty
+	}
+	else
+	{
+		UDR0 = g_Console_Tx [g_Console_Tx_Tail];
+		g_Console_Tx_Tail = (g_Console_Tx_Tail + 1) & (CONSOLE_TX_BUFFER-1);
+	}
+}
+
+ISR(USART0_RX_vect, ISR_BLOCK)
+{
+	uint8_t Data = UDR0;
+	uint8_t Next = (g_Console_Rx_Head + 1) & (CONSOLE_RX_BUFFER-1);
+
+	if (Next != g_Console_Rx_Tail)
+	{
+		g_Console_Rx [g_Console_Rx_Head] = Data;
+		g_Console_Rx_Head = Next;
+	}
+}
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+// Console on hardware USART0 (RXD0: PA7, TXD0: PB0) with command shell; these pins are RunBMC GPI4 and GPI5,
+// so GPI4 and GPI5 read as 0 when the console is enabled.
+// 0: software UART, TX only (see SoftUART.h).
+// The console buffers take ~80 bytes of RAM; the link fail if static data leave less than STACK_BUDGET (see Stack.h).
+#ifndef CONSOLE_USART
+#define CONSOLE_USART 0
+#endif
+
+#define CONSOLE_BAUD		250000UL // bps; 8N1; U2X0 is set (UBRR0 = 3 at 8 MHz, 0% error)
+#define CONSOLE_TX_BUFFER	32 // bytes; must be power of 2. When full, printf wait for the USART (also from ISR).
+#define CONSOLE_RX_BUFFER	8  // bytes; must be power of 2. Received bytes are dropped when full.
+#define CONSOLE_LINE		20 // max command line length
+
+extern void Console_Init (void);
+extern void Console_BackgroundTask (void); // command shell; call from main loop.
+
+#endif
+
+
@@ -0,0 +1,275 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+ EEPROM Asynchronous Write Queue  
+ ************************************
+ 
+ Byte writes are queued in RAM and programmed one by one from EE_READY interrupt, so callers (including ISRs)
+ are not blocked for ~3.4 msec per byte by the EEPROM programming time. 
+ 
+ * Byte which already hold the required value is not programmed (save EEPROM endurance).
+ * Queue is served in FIFO order.
+ * EEPROM_MIRROR == 1: the whole EEPROM is mirrored in RAM (loaded by EEPROM_Queue_Init); writes update the mirror and are
+   queued (write-through), so EEPROM_Queue_Peek / EEPROM_Queue_Peek_Block (TWI and event log decode, in ISR) are RAM reads
+   and never wait for a byte being programmed. EEPROM_Queue_Check compare the device with the mirror once the queue is
+   empty. The mirror cost 256 bytes of RAM, so it is a build option; the SRAM device is reduced to fit (see Stack.h).
+ * EEPROM_MIRROR == 0: reads wait for the byte being programmed (up to ~3.4 msec; with interrupts disabled when called from
+   an ISR) and pending bytes are overlaid from the queue. Consistency check: a weighted checksum of the EEPROM content 
+   (sum of (Addr+1)*Data, 16-bit) is kept in RAM; it is updated with the value each programmed byte replace, and compared
+   against the device on request (EEPROM_Queue_Check). Any single byte difference change the checksum ((Addr+1)*Delta
+   is never a multiple of 0x10000).
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "EEPROM_Queue.h"
+
+static uint8_t Queue_Addr [EEPROM_QUEUE_SIZE];
+static uint8_t Queue_Data [EEPROM_QUEUE_SIZE];
+static volatile uint8_t g_Queue_Head; // next entry to program 
+static volatile uint8_t g_Queue_Count; // number of pending entries
+#if (EEPROM_MIRROR == 1)
+static uint8_t g_Mirror [0x100]; // newest value of each byte (programmed or pending)
+#else
+static volatile uint16_t g_Queue_Sum; // weighted checksum of the programmed EEPROM content
+
+static uint16_t EEPROM_Queue_Sum (void);
+#endif
+
+//--------------------------------------------------------------------------
+extern void EEPROM_Queue_Init (void)
+{
+	CLEAR_BIT_REG (EECR, EERIE); // EEPROM Ready Interrupt is enabled only when the queue is not empty.
+	g_Queue_Head = 0;
+	g_Queue_Count = 0;
+#if (EEPROM_MIRROR == 1)
+	eeprom_read_block ((void*)g_Mirror, (const void*)0, sizeof(g_Mirror));
+#else
+	g_Queue_Sum = EEPROM_Queue_Sum ();
+#endif
+}
+//--------------------------------------------------------------------------
+extern bool EEPROM_Queue_Write (uint8_t Addr, uint8_t Data)
+{
+	bool Result = false;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (g_Queue_Count < EEPROM_QUEUE_SIZE)
+		{
+			uint8_t Tail = (g_Queue_Head + g_Queue_Count) & (EEPROM_QUEUE_SIZE-1);
+			Queue_Addr [Tail] = Addr;
+			Queue_Data [Tail] = Data;
+			g_Queue_Count++;
+#if (EEPROM_MIRROR == 1)
+			g_Mirror [Addr] = Data;
+#endif
+			SET_BIT_REG (EECR, EERIE); // EEPROM Ready Interrupt Enable
+			Result = true;
+		}
+	}
+	
+	return (Result);
+}
+//--------------------------------------------------------------------------
+extern uint8_t EEPROM_Queue_Free (void)
+{
+	return (EEPROM_QUEUE_SIZE - g_Queue_Count);
+}
+//--------------------------------------------------------------------------
+extern uint8_t EEPROM_Queue_Pending (void)
+{
+	uint8_t Pending;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Pending = g_Queue_Count;
+		if (IS_BIT_SET (EECR, EEPE))
+			Pending++; // last byte is still programming
+	}
+	
+	return (Pending);
+}
+//--------------------------------------------------------------------------
+extern void EEPROM_Queue_Patch (uint8_t Addr, uint8_t *pBuffer, uint8_t Size)
+{
+	uint8_t i, Index;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		// oldest to newest; the newest pending value of an address wins.
+		for (i = 0, Index = g_Queue_Head; i < g_Queue_Count; i++, Index = (Index + 1) & (EEPROM_QUEUE_SIZE-1))
+		{
+			if ((uint8_t)(Queue_Addr[Index] - Addr) < Size)
+				pBuffer [(uint8_t)(Queue_Addr[Index] - Addr)] = Queue_Data[Index];
+		}
+	}
+}
+//--------------------------------------------------------------------------
+// EEAR and EEDR are shared with EE_READY ISR; a read interrupted between the address write and EERE read the wrong byte 
+// (or change the address of a byte being programmed). The programming time (~3.4 msec) is waited with interrupts enabled.
+// With Pending, the newest queued value of the address is returned; it is taken in the same atomic block as the EEPROM 
+// byte, so a byte programmed (and dequeued) in the middle is not missed.
+static uint8_t EEPROM_Queue_Read_Byte (uint8_t Addr, bool Pending)
+{
+	uint8_t Data = 0;
+	bool Done = false;
+	
+	while (! Done)
+	{
+		while (IS_BIT_SET (EECR, EEPE)); // byte is programming
+		
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if (! IS_BIT_SET (EECR, EEPE)) // EE_READY ISR may start the next byte before the block
+			{
+				Data = eeprom_read_byte ((const uint8_t *)(uint16_t)Addr);
+				if (Pending)
+					EEPROM_Queue_Patch (Addr, &Data, 1);
+				Done = true;
+			}
+		}
+	}
+	
+	return (Data);
+}
+//--------------------------------------------------------------------------
+extern uint8_t EEPROM_Queue_Read (uint8_t Addr)
+{
+	return (EEPROM_Queue_Read_Byte (Addr, false));
+}
+//--------------------------------------------------------------------------
+extern uint8_t EEPROM_Queue_Peek (uint8_t Addr)
+{
+#if (EEPROM_MIRROR == 1)
+	return (g_Mirror [Addr]);
+#else
+	return (EEPROM_Queue_Read_Byte (Addr, true));
+#endif
+}
+//--------------------------------------------------------------------------
+extern void EEPROM_Queue_Peek_Block (uint8_t Addr, uint8_t *pBuffer, uint8_t Size)
+{
+#if (EEPROM_MIRROR == 1)
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy ((void*)pBuffer, (const void*)&g_Mirror[Addr], Size);
+	}
+#else
+	uint8_t i;
+	
+	for (i = 0; i < Size; i++)
+		pBuffer [i] = EEPROM_Queue_Read_Byte (Addr + i, true); // wait for the byte being programmed
+#endif
+}
+//--------------------------------------------------------------------------
+#if (EEPROM_MIRROR == 1)
+// device content against the mirror; each byte is compared with the queue empty, so a byte written during the check is not 
+// reported as a mismatch.
+extern uint8_t EEPROM_Queue_Check (void)
+{
+	uint8_t Result = EEPROM_CHECK_OK;
+	uint16_t Addr;
+	
+	for (Addr = 0; (Addr <= 0xFF) && (Result == EEPROM_CHECK_OK); Addr++)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if (EEPROM_Queue_Pending () != 0)
+				Result = EEPROM_CHECK_BUSY;
+			else if (eeprom_read_byte ((const uint8_t *)Addr) != g_Mirror [Addr])
+				Result = EEPROM_CHECK_MISMATCH;
+		}
+	}
+	
+	return (Result);
+}
+#else
+// weighted checksum of the programmed content; each byte is read atomically against the EE_READY interrupt (see EEPROM_Queue_Read).
+static uint16_t EEPROM_Queue_Sum (void)
+{
+	uint16_t Sum = 0;
+	uint16_t Addr;
+	
+	for (Addr = 0; Addr <= 0xFF; Addr++)
+		Sum += (Addr+1) * EEPROM_Queue_Read ((uint8_t)Addr);
+	
+	return (Sum);
+}
+//--------------------------------------------------------------------------
+extern uint8_t EEPROM_Queue_Check (void)
+{
+	uint16_t Expected, Sum;
+	bool Busy;
+	
+	if (EEPROM_Queue_Pending () != 0)
+		return (EEPROM_CHECK_BUSY);
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Expected = g_Queue_Sum;
+	}
+	Sum = EEPROM_Queue_Sum ();
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Busy = (EEPROM_Queue_Pending () != 0) || (Expected != g_Queue_Sum); // byte written during the check
+	}
+	
+	if (Busy)
+		return (EEPROM_CHECK_BUSY);
+	
+	return ((Sum == Expected) ? EEPROM_CHECK_OK : EEPROM_CHECK_MISMATCH);
+}
+#endif
+//--------------------------------------------------------------------------
+
+// EEPROM ready (EEPE is cleared); constant interrupt while EERIE is set.
+ISR(EE_READY_vect, ISR_BLOCK)
+{
+	uint8_t Addr, Data;
+	
+	if (g_Queue_Count == 0)
+	{
+		CLEAR_BIT_REG (EECR, EERIE); // nothing to program
+		return;
+	}
+	
+	Addr = Queue_Addr [g_Queue_Head];
+	Data = Queue_Data [g_Queue_Head];
+	g_Queue_Head = (g_Queue_Head + 1) & (EEPROM_QUEUE_SIZE-1);
+	g_Queue_Count--;
+	
+	EEAR = Addr;
+	SET_BIT_REG (EECR, EERE); // read current value
+	if (EEDR == Data)
+		return; // no need to program; interrupt will occur again for the next entry.
+	
+#if (EEPROM_MIRROR == 0)
+	g_Queue_Sum += (uint16_t)(Addr+1) * ((uint16_t)Data - EEDR);
+#endif
+	
+	EECR = 0; // EEPM[1:0]=0: Erase and Write in one operation (Atomic Operation); EERIE is set again below.
+	EEDR = Data;
+	SET_BIT_REG (EECR, EEMPE); // EEPROM Master Program Enable
+	SET_BIT_REG (EECR, EEPE);  // EEPROM Program Enable; must be set within four clock cycles after EEMPE.
+	SET_BIT_REG (EECR, EERIE); // interrupt on completion
+}
@@ -0,0 +1,34 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _EEPROM_QUEUE_H_
+#define _EEPROM_QUEUE_H_
+
+#define EEPROM_QUEUE_SIZE 16 // max number of pending byte writes; must be power of 2.
+
+#ifndef EEPROM_MIRROR
+#define EEPROM_MIRROR 0 // 1: write-through RAM mirror of the EEPROM (256 bytes; build with I2C_DEVICE_SRAM_SIZE=64, see the RAM budget in Stack.h)
+#endif
+
+// EEPROM_Queue_Check result
+#define EEPROM_CHECK_OK			0 // EEPROM content match the checksum of the programmed bytes
+#define EEPROM_CHECK_BUSY		1 // bytes are pending (or written during the check); try again later
+#define EEPROM_CHECK_MISMATCH	2 // EEPROM changed outside the queue or a byte failed to program
+
+extern void EEPROM_Queue_Init (void); // call after any direct (blocking) EEPROM programming at boot; read the whole EEPROM to set the checksum.
+extern bool EEPROM_Queue_Write (uint8_t Addr, uint8_t Data); // return false when queue is full (byte is not written).
+extern uint8_t EEPROM_Queue_Free (void); // number of free entries in the queue.
+extern uint8_t EEPROM_Queue_Pending (void); // number of bytes not yet written to EEPROM. 
+extern void EEPROM_Queue_Patch (uint8_t Addr, uint8_t *pBuffer, uint8_t Size); // overlay pending bytes on a buffer read from EEPROM at Addr.
+extern uint8_t EEPROM_Queue_Read (uint8_t Addr); // read a programmed byte (pending bytes are not included); use instead of eeprom_read_* outside ISRs.
+extern uint8_t EEPROM_Queue_Peek (uint8_t Addr); // read the newest value of a byte, including a pending write.
+extern void EEPROM_Queue_Peek_Block (uint8_t Addr, uint8_t *pBuffer, uint8_t Size); // newest values of Size bytes from Addr (Addr + Size <= 0x100).
+extern uint8_t EEPROM_Queue_Check (void); // compare EEPROM content with the checksum, or the mirror (~256 byte reads; not from ISR).
+
+#endif
+
+
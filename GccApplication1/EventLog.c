@@ -0,0 +1,537 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+   Event Log 
+ ************************************
+ 
+ EEPROM Memory Map (logging area):
+ * 0x80..0x81: log header: 'L' and format version. 
+ * 0x82..0xFF: 126 bytes cyclic byte stream of variable size records (append-only).
+ 
+ Record format (version 3):
+ * Header byte:  bit 7: 1 (start of record). 
+                 bit 6..5: payload: 00 no payload; 01 payload bit 7 is 0; 10 payload bit 7 is 1; 11 invalid.
+                 bit 4..0: event code. 
+ * Time bytes:   time in msec from previous event (32-bit); bit 7 of each byte is 0.
+                 0 bytes: 0 msec; 1 byte: 1..127 msec (exact); 2 bytes: 14-bit floating point value, LSB first 
+                 (bit 13..9: exponent E, bit 8..0: mantissa M; E = 0: M msec, otherwise (512 + M) << (E-1) msec), 
+                 rounded down: exact up to 1023 msec, then less than 0.2% (e.g., less than 3 minutes in a day).
+ * Payload byte: 0 or 1 byte; payload bit 6..0; bit 7 is 0. 
+ A record ends at the next byte with bit 7 set, so record size is 1 to 4 bytes. 
+ 
+ Capacity (126 bytes): events minutes to days apart take 4 bytes with payload (~31 events) and 3 bytes without (~42); 
+ bursts (less than 128 msec apart) take 2-3 bytes (~42-63). The version 1 format held 64 events in 2-byte records, with 
+ a log-scale time stamp (5% steps) and event bits shared by events close in time; a 32-bit time within 0.2% and a 
+ payload do not fit in 2 bytes. Use the flash spill to keep more.
+ 
+ * 0xFF (invalid header) marks the end of the log. On each event, the record is written over the end marker
+   and a new end marker is written after it; each EEPROM byte is programmed twice per log cycle. 
+   Bytes after the end marker up to the next header are remaining of an overwritten record and are ignored.
+ * A reset in the middle of a record write leaves orphan bytes and a second 0xFF after them (the header is written last);
+   on init, the end marker is the 0xFF that follows a record header, not orphan bytes or another 0xFF. 
+ * Event code 0x1F (EVENTLOG_CLEAR_CODE) is a clear record: older records are not decoded, and are overwritten 
+   as the log advances (clear does not erase the area, so it does not wear the EEPROM).
+ * The end marker position and the header offsets of the newest EVENTLOG_DECODED_ENTRIES records (g_EventLog_Index) 
+   are kept in RAM; the stream is walked only once on init, and EventLog_Add update the index for the bytes it overwrite.
+ * Records are programmed via EEPROM_Queue (EE_READY interrupt), so logging an event does not block. 
+   When the queue is full, the record is lost and g_EventLog_Lost is increased. 
+ * Decoded records are readable via EventLog_Read_Decoded (fixed size entries, see EventLog.h); only the records that 
+   cover the requested bytes are read (a record is 4 bytes at most), pending bytes in EEPROM_Queue included.
+ 
+ Flash spill (EVENTLOG_FLASH_PAGES > 0):
+ * The byte stream is archived from EEPROM to a cyclic flash area, 30 bytes per page, before it is overwritten in EEPROM. 
+   Flash page format: byte 0: page sequence number (0x00..0xFE); byte 1: stream offset following this page; byte 2..31: stream.
+ * Flash area is readable via the emulated EEPROM flash window (0x4000 + flash address); its address is printed on init.
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/eeprom.h>
+#include <avr/boot.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "EEPROM_Queue.h"
+#include "EventLog.h"
+#include "SystemTick.h"
+#include "Profile.h"
+#include "Seqlock.h"
+
+#define EVENTLOG_EE_HEADER		0x80
+#define EVENTLOG_EE_START		0x82
+#define EVENTLOG_EE_SIZE		126
+#define EVENTLOG_VERSION		3
+
+#define EVENTLOG_END_MARKER		0xFF
+#define EVENTLOG_HEADER			0x80
+#define EVENTLOG_PAYLOAD_MASK	0x60
+#define EVENTLOG_PAYLOAD_NONE	0x00
+#define EVENTLOG_PAYLOAD_LOW	0x20
+#define EVENTLOG_PAYLOAD_HIGH	0x40
+#define EVENTLOG_MAX_RECORD		4
+#define EVENTLOG_TIME_EXACT		0x80 // time below is stored in one byte (exact)
+#define EVENTLOG_TIME_MANTISSA	0x200 // 9-bit mantissa of the 2-byte time
+#define EVENTLOG_CLEAR_CODE		0x1F // clear record; the 0xFF end marker has the same code with invalid payload mode
+#define EVENTLOG_INDEX_NONE		0xFF
+
+static uint8_t g_EventLog_End;   // end marker offset in EEPROM stream
+static uint8_t g_EventLog_Lost;  // number of records lost (queue full or not archived before overwritten)
+static uint8_t g_EventLog_Index [EVENTLOG_DECODED_ENTRIES]; // header offsets of the newest records, newest first
+static SEQLOCK g_EventLog_Seq;   // g_EventLog_Index update (see Seqlock.h)
+
+//---------------------------------------------------------------------------
+static uint8_t EventLog_EE_Read (uint8_t Offset)
+{
+	return (EEPROM_Queue_Read (EVENTLOG_EE_START + Offset));
+}
+//---------------------------------------------------------------------------
+// newest value of a stream byte, including a queued write
+static uint8_t EventLog_EE_Peek (uint8_t Offset)
+{
+	return (EEPROM_Queue_Peek (EVENTLOG_EE_START + Offset));
+}
+//---------------------------------------------------------------------------
+static uint8_t EventLog_Next (uint8_t Offset)
+{
+	return ((Offset == EVENTLOG_EE_SIZE-1) ? 0 : Offset+1);
+}
+//---------------------------------------------------------------------------
+static uint8_t EventLog_Prev (uint8_t Offset)
+{
+	return ((Offset == 0) ? EVENTLOG_EE_SIZE-1 : Offset-1);
+}
+//---------------------------------------------------------------------------
+// 14-bit floating point time (see record format); rounded down.
+static uint16_t EventLog_Time_Encode (uint32_t TimeStamp)
+{
+	uint8_t Shift = 0;
+	
+	while (TimeStamp >= 2*EVENTLOG_TIME_MANTISSA)
+	{
+		TimeStamp >>= 1;
+		Shift++;
+	}
+	
+	if ( (Shift == 0) && (TimeStamp < EVENTLOG_TIME_MANTISSA) )
+		return ((uint16_t)TimeStamp); // E = 0
+	return ((uint16_t)(Shift+1) << 9 | ((uint16_t)TimeStamp - EVENTLOG_TIME_MANTISSA));
+}
+//---------------------------------------------------------------------------
+static uint32_t EventLog_Time_Decode (uint16_t Time)
+{
+	uint8_t Exponent = Time >> 9;
+	uint16_t Mantissa = Time & (EVENTLOG_TIME_MANTISSA-1);
+	
+	if (Exponent == 0)
+		return (Mantissa);
+	return ((uint32_t)(EVENTLOG_TIME_MANTISSA + Mantissa) << (Exponent-1));
+}
+//---------------------------------------------------------------------------
+static uint8_t EventLog_Encode (uint8_t *pRecord, uint8_t EventCode, uint32_t TimeStamp, uint16_t Payload)
+{
+	uint8_t Size = 1;
+	
+	pRecord[0] = EVENTLOG_HEADER | (EventCode & EVENTLOG_MAX_CODE);
+	
+	if (TimeStamp >= EVENTLOG_TIME_EXACT)
+	{
+		uint16_t Time = EventLog_Time_Encode (TimeStamp);
+		
+		pRecord[Size++] = Time & 0x7F;
+		pRecord[Size++] = Time >> 7;
+	}
+	else if (TimeStamp != 0)
+		pRecord[Size++] = TimeStamp;
+	
+	if (Payload != EVENTLOG_NO_PAYLOAD)
+	{
+		pRecord[0] |= (Payload & 0x80) ? EVENTLOG_PAYLOAD_HIGH : EVENTLOG_PAYLOAD_LOW;
+		pRecord[Size++] = Payload & 0x7F;
+	}
+	
+	return (Size);
+}
+//---------------------------------------------------------------------------
+// decode the record starting at Offset (header byte) into an 8-byte decoded entry; the record ends at the next byte 
+// with bit 7 set. The last byte is the payload when the header has one; the bytes before it are the time.
+static void EventLog_Decode (uint8_t Offset, uint8_t *pEntry)
+{
+	uint8_t Header = EventLog_EE_Peek (Offset);
+	uint8_t Data [EVENTLOG_MAX_RECORD-1]; // time and payload bytes
+	uint8_t Count = 0;
+	uint32_t TimeStamp = 0;
+	
+	memset ((void*)pEntry, 0, EVENTLOG_DECODED_ENTRY_SIZE);
+	pEntry[0] = Header & EVENTLOG_MAX_CODE;
+	
+	while (Count < sizeof(Data))
+	{
+		Offset = EventLog_Next (Offset);
+		Data[Count] = EventLog_EE_Peek (Offset);
+		if (Data[Count] & EVENTLOG_HEADER)
+			break; // next record or end marker
+		Count++;
+	}
+	
+	if ( ((Header & EVENTLOG_PAYLOAD_MASK) != EVENTLOG_PAYLOAD_NONE) && (Count != 0) )
+	{
+		Count--;
+		pEntry[1] = EVENTLOG_DECODED_FLAG_PAYLOAD;
+		pEntry[2] = Data[Count];
+		if ((Header & EVENTLOG_PAYLOAD_MASK) == EVENTLOG_PAYLOAD_HIGH)
+			pEntry[2] |= 0x80;
+	}
+	
+	if (Count == 1)
+		TimeStamp = Data[0];
+	else if (Count == 2)
+		TimeStamp = EventLog_Time_Decode ((uint16_t)Data[0] | (uint16_t)Data[1] << 7);
+	
+	memcpy ((void*)&pEntry[4], (const void*)&TimeStamp, sizeof(TimeStamp));
+}
+//---------------------------------------------------------------------------
+// a new record header at Offset with Size bytes (end marker follows); drop the indexed records it overwrites. 
+// Call with interrupts disabled.
+static void EventLog_Index_Insert (uint8_t Offset, uint8_t Size)
+{
+	uint8_t i;
+	
+	for (i = EVENTLOG_DECODED_ENTRIES-1; i > 0; i--)
+	{
+		uint8_t Header = g_EventLog_Index [i-1];
+		uint8_t Distance = (Header >= Offset) ? Header - Offset : Header + EVENTLOG_EE_SIZE - Offset;
+		
+		g_EventLog_Index [i] = (Distance <= Size) ? EVENTLOG_INDEX_NONE : Header;
+	}
+	g_EventLog_Index [0] = Offset;
+}
+//---------------------------------------------------------------------------
+// walk the stream backward from the end marker; each valid header byte found ends a record. 
+// The walk stops at the beginning of the log (0xFF) or at a clear record.
+static void EventLog_Index_Build (void)
+{
+	uint8_t Position = g_EventLog_End;
+	uint8_t RecordSize = 0;
+	uint8_t Count = 0;
+	uint8_t Steps;
+	
+	memset ((void*)g_EventLog_Index, EVENTLOG_INDEX_NONE, sizeof(g_EventLog_Index));
+	
+	for (Steps = 0; (Steps < EVENTLOG_EE_SIZE-1) && (Count < EVENTLOG_DECODED_ENTRIES); Steps++)
+	{
+		uint8_t Data;
+		
+		Position = EventLog_Prev (Position);
+		Data = EventLog_EE_Read (Position);
+		RecordSize++;
+		
+		if (Data == EVENTLOG_END_MARKER)
+			break; // beginning of the log
+			
+		if ( (Data & EVENTLOG_HEADER) == 0 )
+			continue; // time or payload byte
+			
+		if ( ((Data & EVENTLOG_PAYLOAD_MASK) != EVENTLOG_PAYLOAD_MASK) && (RecordSize <= EVENTLOG_MAX_RECORD) )
+		{
+			if ((Data & EVENTLOG_MAX_CODE) == EVENTLOG_CLEAR_CODE)
+				break; // log was cleared
+			g_EventLog_Index [Count++] = Position;
+		}
+		RecordSize = 0;
+	}
+}
+//---------------------------------------------------------------------------
+// 0xFF at Offset is the end marker if it follows a record: a header byte (not 0xFF) within the record size before it.
+// Orphan bytes of a record interrupted by reset are followed by a stale 0xFF, and preceded by the real end marker.
+static bool EventLog_Is_End (uint8_t Offset)
+{
+	uint8_t i;
+	
+	if (EventLog_EE_Read (Offset) != EVENTLOG_END_MARKER)
+		return (false);
+		
+	for (i = 0; i < EVENTLOG_MAX_RECORD; i++)
+	{
+		uint8_t Data;
+		
+		Offset = EventLog_Prev (Offset);
+		Data = EventLog_EE_Read (Offset);
+		if (Data & EVENTLOG_HEADER)
+			return (Data != EVENTLOG_END_MARKER);
+	}
+	
+	return (false);
+}
+//---------------------------------------------------------------------------
+
+#if (EVENTLOG_FLASH_PAGES > 0)
+
+#define EVENTLOG_SEQ_ERASED		0xFF
+#define EVENTLOG_SEQ_MODULO		0xFF // page sequence number range 0x00..0xFE
+#define EVENTLOG_FLASH_STREAM	(SPM_PAGESIZE - 2) // stream bytes per page
+
+static const uint8_t EventLog_Flash [EVENTLOG_FLASH_PAGES * SPM_PAGESIZE] PROGMEM __attribute__((used)) __attribute__((aligned(SPM_PAGESIZE))) = 
+	{ [0 ... (EVENTLOG_FLASH_PAGES * SPM_PAGESIZE)-1] = 0xFF };
+
+static uint8_t g_EventLog_FlashPage;  // next flash page to program
+static uint8_t g_EventLog_FlashSeq;   // next flash page sequence number 
+static uint8_t g_EventLog_Archived;   // stream offset of the next byte to archive
+
+//---------------------------------------------------------------------------
+static uint8_t EventLog_NextSeq (uint8_t Seq)
+{
+	return ((Seq == (EVENTLOG_SEQ_MODULO-1)) ? 0 : Seq+1);
+}
+//---------------------------------------------------------------------------
+static uint8_t EventLog_Flash_Read (uint8_t Page, uint8_t Offset)
+{
+	return (pgm_read_byte (&EventLog_Flash [(uint16_t)Page*SPM_PAGESIZE + Offset]));
+}
+//---------------------------------------------------------------------------
+// number of stream bytes written to EEPROM and not archived yet
+static uint8_t EventLog_Flash_Pending (void)
+{
+	return ((g_EventLog_End + EVENTLOG_EE_SIZE - g_EventLog_Archived) % EVENTLOG_EE_SIZE);
+}
+//---------------------------------------------------------------------------
+static void EventLog_Flash_Init (void)
+{
+	uint8_t Page;
+	uint8_t Seq;
+	
+	// look for the last programmed page; its next page does not hold the next sequence number. 
+	g_EventLog_FlashPage = 0;
+	g_EventLog_FlashSeq = 0;
+	g_EventLog_Archived = EventLog_Next (g_EventLog_End); // flash is empty; start from the oldest byte in EEPROM.
+	
+	for (Page = 0; Page < EVENTLOG_FLASH_PAGES; Page++)
+	{
+		Seq = EventLog_Flash_Read (Page, 0);
+		if (Seq == EVENTLOG_SEQ_ERASED)
+			continue;
+			
+		if (EventLog_Flash_Read ((Page+1) % EVENTLOG_FLASH_PAGES, 0) != EventLog_NextSeq (Seq))
+		{
+			g_EventLog_FlashPage = (Page+1) % EVENTLOG_FLASH_PAGES;
+			g_EventLog_FlashSeq = EventLog_NextSeq (Seq);
+			g_EventLog_Archived = EventLog_Flash_Read (Page, 1);
+			break;
+		}
+	}
+	
+	printf_P (PSTR("> Event log flash spill: %u pages at 0x%04X; next page %u; \r\n"), EVENTLOG_FLASH_PAGES, (uint16_t)EventLog_Flash, g_EventLog_FlashPage);
+}
+//---------------------------------------------------------------------------
+// make room in EEPROM stream for Size bytes (called before the bytes are overwritten)
+static void EventLog_Flash_Evict (uint8_t Size)
+{
+	while ( (EVENTLOG_EE_SIZE - EventLog_Flash_Pending()) <= Size )
+	{ // bytes are overwritten in EEPROM before archived.
+		g_EventLog_Archived = EventLog_Next (g_EventLog_Archived);
+		g_EventLog_Lost++;
+	}
+}
+//---------------------------------------------------------------------------
+static void EventLog_Flash_Archive (void)
+{
+	uint8_t Page_Buffer [SPM_PAGESIZE];
+	uint8_t Offset, i;
+	uint16_t Address;
+	
+	// archive only full pages, and only after the bytes are programmed into EEPROM. 
+	if ( (EventLog_Flash_Pending () < EVENTLOG_FLASH_STREAM) || (EEPROM_Queue_Pending () != 0) )
+		return;
+	
+	Offset = g_EventLog_Archived;
+	for (i = 2; i < SPM_PAGESIZE; i++)
+	{
+		Page_Buffer[i] = EventLog_EE_Read (Offset);
+		Offset = EventLog_Next (Offset);
+	}
+	Page_Buffer[0] = g_EventLog_FlashSeq;
+	Page_Buffer[1] = Offset;
+	
+	// flash programming halts the CPU (~4.5 msec erase + ~4.5 msec write); pending interrupts are served after.  
+	Address = (uint16_t)&EventLog_Flash [(uint16_t)g_EventLog_FlashPage*SPM_PAGESIZE];
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		boot_page_erase (Address);
+		boot_spm_busy_wait ();
+		for (i = 0; i < SPM_PAGESIZE; i += 2)
+			boot_page_fill (Address + i, (uint16_t)Page_Buffer[i] | ((uint16_t)Page_Buffer[i+1] << 8));
+		boot_page_write (Address);
+		boot_spm_busy_wait ();
+		
+		g_EventLog_Archived = Offset;
+		g_EventLog_FlashSeq = EventLog_NextSeq (g_EventLog_FlashSeq);
+		g_EventLog_FlashPage = (g_EventLog_FlashPage + 1) % EVENTLOG_FLASH_PAGES;
+	}
+}
+//---------------------------------------------------------------------------
+#endif
+
+//---------------------------------------------------------------------------
+extern void EventLog_Init (void)
+{
+	uint8_t Offset;
+	
+	g_EventLog_End = EVENTLOG_INDEX_NONE;
+	g_EventLog_Lost = 0;
+	
+	if ( (EEPROM_Queue_Read (EVENTLOG_EE_HEADER) != 'L') || (EEPROM_Queue_Read (EVENTLOG_EE_HEADER+1) != EVENTLOG_VERSION) )
+	{
+		// unknown log format (e.g., first boot or previous firmware); erase logging area once. 
+		printf_P (PSTR("> Event log: format update, erase logging area. \r\n"));
+		for (Offset = 0; Offset < EVENTLOG_EE_SIZE; Offset++)
+			eeprom_update_byte ((uint8_t *)(EVENTLOG_EE_START + (uint16_t)Offset), EVENTLOG_END_MARKER);
+		eeprom_update_byte ((uint8_t *)EVENTLOG_EE_HEADER, 'L');
+		eeprom_update_byte ((uint8_t *)EVENTLOG_EE_HEADER+1, EVENTLOG_VERSION);
+	}
+	
+	// look for the end marker that follows a record; if there is none (empty log), use the first 0xFF; 
+	// if there is no 0xFF at all, restart from offset 0.
+	for (Offset = 0; Offset < EVENTLOG_EE_SIZE; Offset++)
+	{
+		if (EventLog_Is_End (Offset))
+		{
+			g_EventLog_End = Offset;
+			break;
+		}
+		if ( (g_EventLog_End == EVENTLOG_INDEX_NONE) && (EventLog_EE_Read (Offset) == EVENTLOG_END_MARKER) )
+			g_EventLog_End = Offset;
+	}
+	if (g_EventLog_End == EVENTLOG_INDEX_NONE)
+	{
+		g_EventLog_End = 0;
+		eeprom_update_byte ((uint8_t *)EVENTLOG_EE_START, EVENTLOG_END_MARKER);
+	}
+	
+	EventLog_Index_Build ();
+	
+	printf_P (PSTR("> Event log: end marker offset %u; \r\n"), g_EventLog_End);
+	
+#if (EVENTLOG_FLASH_PAGES > 0)
+	EventLog_Flash_Init ();
+#endif
+}
+//---------------------------------------------------------------------------
+extern bool EventLog_Add (uint8_t EventCode, uint32_t TimeStamp /*msec*/, uint16_t Payload)
+{
+	uint8_t Record [EVENTLOG_MAX_RECORD];
+	uint8_t Size = EventLog_Encode (Record, EventCode, TimeStamp, Payload);
+	bool Result = false;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		PROFILE_BEGIN (PROFILE_ATOMIC_EVENTLOG);
+		if (EEPROM_Queue_Free () <= Size) // record and new end marker
+		{
+			g_EventLog_Lost++;
+		}
+		else
+		{
+			uint8_t Offset = g_EventLog_End;
+			uint8_t i;
+			
+#if (EVENTLOG_FLASH_PAGES > 0)
+			EventLog_Flash_Evict (Size);
+#endif
+			// write order: time/payload bytes, new end marker, and the header over the old end marker last;
+			// so a reset in the middle leaves at most orphan bytes without header. 
+			for (i = 1; i < Size; i++)
+			{
+				Offset = EventLog_Next (Offset);
+				EEPROM_Queue_Write (EVENTLOG_EE_START + Offset, Record[i]);
+			}
+			Offset = EventLog_Next (Offset);
+			EEPROM_Queue_Write (EVENTLOG_EE_START + Offset, EVENTLOG_END_MARKER);
+			EEPROM_Queue_Write (EVENTLOG_EE_START + g_EventLog_End, Record[0]);
+			
+			if ((EventCode & EVENTLOG_MAX_CODE) == EVENTLOG_CLEAR_CODE)
+				memset ((void*)g_EventLog_Index, EVENTLOG_INDEX_NONE, sizeof(g_EventLog_Index));
+			else
+				EventLog_Index_Insert (g_EventLog_End, Size);
+			SEQLOCK_WRITE (g_EventLog_Seq);
+			
+			g_EventLog_End = Offset;
+			Result = true;
+		}
+		PROFILE_END (PROFILE_ATOMIC_EVENTLOG);
+	}
+	
+	return (Result);
+}
+//---------------------------------------------------------------------------
+// decoded entry Index (0: newest); a reader in main loop repeats the decode if a record was added in the middle.
+static void EventLog_Get_Entry (uint8_t Index, uint8_t *pEntry)
+{
+	uint8_t Seq;
+	
+	do
+	{
+		uint8_t Header;
+		
+		Seq = SEQLOCK_READ_BEGIN (g_EventLog_Seq);
+		Header = g_EventLog_Index [Index];
+		if (Header == EVENTLOG_INDEX_NONE)
+			memset ((void*)pEntry, 0xFF, EVENTLOG_DECODED_ENTRY_SIZE); // no entry
+		else
+			EventLog_Decode (Header, pEntry);
+	} while (SEQLOCK_READ_RETRY (g_EventLog_Seq, Seq));
+}
+//---------------------------------------------------------------------------
+// Read decoded event log; Offset and Size are in bytes of the decoded entries (newest event first).
+extern void EventLog_Read_Decoded (uint8_t Offset, uint8_t *pBuffer, uint8_t Size)
+{
+	uint8_t Entry [EVENTLOG_DECODED_ENTRY_SIZE];
+	uint16_t Position = Offset;
+	uint16_t End = (uint16_t)Offset + Size;
+	
+	while (Position < End)
+	{
+		uint8_t Index = Position / EVENTLOG_DECODED_ENTRY_SIZE;
+		uint8_t i = Position % EVENTLOG_DECODED_ENTRY_SIZE;
+		
+		if (Index < EVENTLOG_DECODED_ENTRIES)
+			EventLog_Get_Entry (Index, Entry);
+		else
+			memset ((void*)Entry, 0xFF, sizeof(Entry));
+			
+		for ( ; (i < EVENTLOG_DECODED_ENTRY_SIZE) && (Position < End); i++, Position++)
+			pBuffer [Position - Offset] = Entry [i];
+	}
+}
+//---------------------------------------------------------------------------
+extern uint8_t EventLog_Get_Lost (void)
+{
+	return (g_EventLog_Lost);
+}
+//---------------------------------------------------------------------------
+// Append a clear record; return false when it is lost (queue full). 
+// Note: archived flash pages are not erased.
+extern bool EventLog_Clear (void)
+{
+	return (EventLog_Add (EVENTLOG_CLEAR_CODE, 0, EVENTLOG_NO_PAYLOAD));
+}
+//---------------------------------------------------------------------------
+// Call from main loop. 
+extern void EventLog_BackgroundTask (void)
+{
+#if (EVENTLOG_FLASH_PAGES > 0)
+	EventLog_Flash_Archive ();
+#endif
+}
+//---------------------------------------------------------------------------
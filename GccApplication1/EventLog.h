@@ -0,0 +1,39 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _EVENT_LOG_H_
+#define _EVENT_LOG_H_
+
+// Number of flash pages used to archive events evicted from the EEPROM log; set to 0 to disable the flash spill. 
+// Note: flash page erase/write halt the CPU for ~9 msec; it is done only from main loop (EventLog_BackgroundTask).
+#ifndef EVENTLOG_FLASH_PAGES
+#define EVENTLOG_FLASH_PAGES 0
+#endif
+
+#define EVENTLOG_NO_PAYLOAD		0xFFFF	// Payload value for events without payload. 
+#define EVENTLOG_MAX_CODE		0x1F	// event codes are 0x00..0x1E; 0x1F is the clear record
+
+// Decoded event log (see EventLog_Read_Decoded): 32 entries of 8 bytes, newest event first.
+// * byte 0: event code; 0xFF for no entry. 
+// * byte 1: flags; bit 0: payload is valid. 
+// * byte 2: payload. 
+// * byte 3: reserved (0). 
+// * byte 4..7: time in msec from previous event (32-bit, LSB first); exact up to 1023 msec, then rounded down by less than 0.2%.
+#define EVENTLOG_DECODED_ENTRY_SIZE	8
+#define EVENTLOG_DECODED_ENTRIES	32
+#define EVENTLOG_DECODED_FLAG_PAYLOAD 0x01
+
+extern void EventLog_Init (void);
+extern bool EventLog_Add (uint8_t EventCode, uint32_t TimeStamp /*msec*/, uint16_t Payload); // return false when record is lost.
+extern void EventLog_Read_Decoded (uint8_t Offset, uint8_t *pBuffer, uint8_t Size); 
+extern void EventLog_BackgroundTask (void);
+extern uint8_t EventLog_Get_Lost (void); // number of records lost
+extern bool EventLog_Clear (void); // return false when the clear record is lost.
+
+#endif
+
+
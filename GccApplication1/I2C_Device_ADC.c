@@ -15,22 +15,32 @@
  Support VREF:
  * 3.3V (bit 3 in the command byte is clear). 
  * 2.5V (bit 3 in the command byte is set). 
+ 
+ Internal temperature sensor (see I2C_Device_ADC_Temp_Sample): converted from main loop without blocking; the internal
+ reference settling is done between main loop calls, while the ADC stay available to the I2C device.
 */
 
 /*
 TBD:
 1. Upgrade to 12-bit device emulation (Note that ATtiny1634 support 10-bit)
 2. Add negative values (16-bit two's complement) for diff conversion.
-3. Add thresholds and interrupt support.  (Issue: interrupt is shared with virtual GPI module)
+3. Add thresholds and interrupt support (INT# is shared; use I2C_Slave_Alert).
 */
 
 #include <avr/io.h>
+#include <util/atomic.h>
 #include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include "CoreRegisters.h"
 
 #include "I2C_Slave.h"
+#include "I2C_Device_ADC.h"
+#include "SystemTick.h"
+#include "Trace.h"
+#define LOG_MODULE ADC
+#include "Log.h"
 
 static void ADC_Init (void);
 static void ADC_Settings (uint8_t MuxSelect, uint8_t RefSelect);
@@ -53,6 +63,16 @@ static uint8_t g_Mux;
 static uint8_t g_Vref;
 static uint8_t g_IsSingleEnded;
 
+#define ADC_MUX_TEMP	0x0E // temperature sensor
+#define ADMUX_TEMP		((VREF_INTERNAL << REFS0) | (ADC_MUX_TEMP << MUX0))
+
+#define TEMP_STATE_IDLE		0
+#define TEMP_STATE_SETTLE	1 // internal reference settling
+#define TEMP_STATE_CONVERT	2
+
+static uint8_t g_Temp_State;
+static uint16_t g_Temp_Settle_msec; // time base msec (low 16-bit) of the multiplexer switch 
+
 static uint8_t I2C_Device_ADC_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed);
 
 /*
@@ -62,21 +82,94 @@ ATtiny1634:		ADC0	ADC1	ADC2	ADC3	ADC4	ADC5	ADC8	ADC9
 g_Mux:          0		4		1		5		2		6		3		7 
 */
 //static uint8_t ADC_Channel_Assignment [8] = {0, 1, 2, 3, 4, 5, 8, 9}; // Input: RunBMC ADC Ch offset to 8; Output: ATtiny1634 ADC Ch
-static uint8_t ADC_Channel_Assignment [8] = {0, 2, 4, 8, 1, 3, 5, 9}; // Input: RunBMC ADC Ch offset to 8; Output: ATtiny1634 ADC Ch
+static const uint8_t ADC_Channel_Assignment [8] PROGMEM = {0, 2, 4, 8, 1, 3, 5, 9}; // Input: RunBMC ADC Ch offset to 8; Output: ATtiny1634 ADC Ch
 
 //--------------------------------------------------------------------------
 extern void I2C_Device_ADC_Init (uint8_t DeviceIndex)
 {
-	g_Mux = ADC_Channel_Assignment[0]; 
+	g_Mux = pgm_read_byte (&ADC_Channel_Assignment[0]); 
 	g_IsSingleEnded = 0;
 	g_Vref = VREF_EXTERNAL;
+	g_Temp_State = TEMP_STATE_IDLE;
 	
 	ADC_Init ();
 	
-	pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_ADC_Func;  
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_ADC_Func;  
 	printf_P (PSTR("> I2C_Device_ADC_Init; register to I2C device index %u; \r\n"), DeviceIndex);
 }
 
+//--------------------------------------------------------------------------
+// The conversion (~100 usec; long conversion after the multiplexer switch) is waited with interrupts enabled. 
+// A conversion of the I2C device in the middle switch the multiplexer (or abort this conversion); it is repeated.
+extern uint8_t I2C_Device_ADC_Sample (uint8_t Channel)
+{
+	uint8_t results = 0;
+	uint8_t Mux;
+	bool Done = false;
+	
+	while (! Done)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // ADC is shared with the I2C device (convert on read in TWI interrupt)
+		{
+			ADC_Settings (pgm_read_byte (&ADC_Channel_Assignment[Channel & 0x07]), g_Vref);
+			SET_BIT_REG (ADCSRA, ADSC);
+			Mux = ADMUX;
+		}
+		
+		while ( IS_BIT_SET(ADCSRA, ADSC) );
+		
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if ( IS_BIT_CLEARED (ADCSRA, ADSC) && (ADMUX == Mux) )
+			{
+				results = ADCH;
+				Done = true;
+			}
+		}
+	}
+	
+	return results;
+}
+//--------------------------------------------------------------------------
+extern bool I2C_Device_ADC_Temp_Sample (uint16_t *pValue)
+{
+	bool Ready = false;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // ADC is shared with the I2C device (convert on read in TWI interrupt)
+	{
+		if ( (g_Temp_State != TEMP_STATE_IDLE) && (ADMUX != ADMUX_TEMP) )
+			g_Temp_State = TEMP_STATE_IDLE; // multiplexer was switched by another conversion; restart the settling
+		
+		switch (g_Temp_State)
+		{
+			case TEMP_STATE_IDLE:
+				ADC_Settings (ADC_MUX_TEMP, VREF_INTERNAL); // the ADC stay enabled during the settling
+				g_Temp_Settle_msec = (uint16_t)SystemTick_Get_msec ();
+				g_Temp_State = TEMP_STATE_SETTLE;
+				break;
+				
+			case TEMP_STATE_SETTLE:
+				if ( ((uint16_t)((uint16_t)SystemTick_Get_msec () - g_Temp_Settle_msec) >= TEMP_SETTLE_TIME) && IS_BIT_CLEARED (ADCSRA, ADSC) )
+				{
+					SET_BIT_REG (ADCSRA, ADSC); // start; result is read on the next calls
+					g_Temp_State = TEMP_STATE_CONVERT;
+				}
+				break;
+				
+			case TEMP_STATE_CONVERT:
+				if (IS_BIT_CLEARED (ADCSRA, ADSC))
+				{
+					*pValue = ADC >> 6; // 10-bit; left adjusted
+					g_Temp_State = TEMP_STATE_IDLE;
+					Ready = true;
+				}
+				break;
+		}
+	}
+	
+	return (Ready);
+}
 //--------------------------------------------------------------------------
 static uint8_t I2C_Device_ADC_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
 {
@@ -89,7 +182,7 @@ static uint8_t I2C_Device_ADC_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 			I2C_Device_ADC_Value = ADC_Convert ();
 			*pBuffer = &I2C_Device_ADC_Value;
 			*MaxNumOfByte = sizeof (I2C_Device_ADC_Value);
-			//printf_P (PSTR("> I2C_Device_ADC_Func; send value:%u \r\n"), I2C_Device_ADC_Value);
+			LOG_DEBUG (LOG_ADC_VALUE, I2C_Device_ADC_Value);
 			break;
 		
 		case I2C_RD_STOP:  //  nothing to do.
@@ -101,39 +194,39 @@ static uint8_t I2C_Device_ADC_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 			*MaxNumOfByte = sizeof (I2C_Device_ADC_Cmd);
 			break;
 			
+		case I2C_WR_ERROR: // PEC mismatch, bus error or time-out: drop the command byte
+			break;
+			
 		case I2C_WR_BUFF_FULL: 
 			*MaxNumOfByte = 0; // no more bytes are allow 
 			// continue parse the fist byte. 
 			// Option: move 'I2C_WR_BUFF_FULL' to 'I2C_WR_START'. In this case only the last byte will be parsed. 
+			// fall through
 		
 		case I2C_WR_STOP:
-		case I2C_WR_ERROR: // we don't care about the error.
 			if (NumOfByteUsed == 1 /*command byte was written*/)
 			{
-				//printf_P (PSTR("> I2C_Device_ADC_Func; "));
+				LOG_DEBUG (LOG_ADC_CMD, I2C_Device_ADC_Cmd);
 				
 				if ( IS_BIT_SET (I2C_Device_ADC_Cmd, 3) ) 
 				{
-					//printf_P (PSTR("VREF_AREF_PIN; "));
 					g_Vref = VREF_EXTERNAL; // 2.5V on RunBMC. 
 				}
 				else 
 				{
-					//printf_P (PSTR("VREF_VCC_PIN; "));
 					g_Vref = VREF_VCC; // 3.3V on RunBMC. 
 				}
 	
 				g_Mux = (I2C_Device_ADC_Cmd >> 4) & 0x7;
 				
 				g_IsSingleEnded = (I2C_Device_ADC_Cmd >> 7) & 0x1;
-				//printf_P (PSTR("Mux:%u; IsSingleEnded:%u; \r\n"), g_Mux, g_IsSingleEnded);
 				
 				// Note: write does not start conversion, only read does. 
 			}
 			break;
 		
 		default:
-			printf_P (PSTR("> I2C_Device_ADC_Func: *** ERROR *** Unknown status. \r\n"));
+			LOG_ERROR (LOG_BAD_STATUS, Status);
 			break;
 	}
 	
@@ -146,10 +239,10 @@ static uint8_t ADC_SE_Convert (void)
 {
 	uint8_t results;
 
-	ADC_Settings (ADC_Channel_Assignment[g_Mux], g_Vref);
+	ADC_Settings (pgm_read_byte (&ADC_Channel_Assignment[g_Mux]), g_Vref);
 	ADC_Start_Convert ();
 	results = ADC_Read_Data();
-	//printf_P (PSTR("> ADC_SE_Convert: RunBMC_Ch:%u; uC_Ch:%u; Value:%u; \r\n"), g_Mux, ADC_Channel_Assignment[g_Mux], results);
+	LOG_DEBUG (LOG_ADC_SE, results);
 	return results;
 }
 //---------------------------------------------
@@ -158,32 +251,28 @@ static uint8_t ADC_DIFF_Convert (void)
 	uint8_t Mux_p, Mux_n;
 	uint8_t results_p, results_n, results_diff;
 	
-	//printf_P (PSTR("> ADC_DIFF_Convert: "));
-	
 	Mux_p = g_Mux;
 	Mux_n = g_Mux ^ 0x8;
 	
 
-	ADC_Settings (ADC_Channel_Assignment[Mux_p], g_Vref);
+	ADC_Settings (pgm_read_byte (&ADC_Channel_Assignment[Mux_p]), g_Vref);
 	ADC_Start_Convert ();
 	results_p = ADC_Read_Data();
-	//printf_P (PSTR("p: RunBMC_Ch:%u; uC_Ch:%u; Value:%u; "), Mux_p, ADC_Channel_Assignment[Mux_p], results_p);
+	LOG_DEBUG (LOG_ADC_DIFF_P, results_p);
 	
-	ADC_Settings (ADC_Channel_Assignment[Mux_n], g_Vref);
+	ADC_Settings (pgm_read_byte (&ADC_Channel_Assignment[Mux_n]), g_Vref);
 	ADC_Start_Convert ();
 	results_n = ADC_Read_Data();
-	//printf_P (PSTR("n: RunBMC_Ch:%u; uC_Ch:%u; Value:%u; "), Mux_n, ADC_Channel_Assignment[Mux_n], results_n);
+	LOG_DEBUG (LOG_ADC_DIFF_N, results_n);
 	
 	
 	if (IS_BIT_CLEARED (g_Mux, 2))
 	{
 		results_diff = results_p - results_n;
-		//printf_P (PSTR("p-n Value:%u; \r\n"), results_diff);	
 	}
 	else
 	{
 		results_diff = results_n - results_p;
-		//printf_P (PSTR("n-p Value:%u; \r\n"), results_diff);
 	}
 	
 	return results_diff;
@@ -10,6 +10,13 @@
 
 
 extern void I2C_Device_ADC_Init (uint8_t DeviceIndex);
+extern uint8_t I2C_Device_ADC_Sample (uint8_t Channel); // single-ended convert of RunBMC channel (0..7) with the current VREF; use from main loop.
+
+// Internal temperature sensor; call from main loop until it return true with the 10-bit conversion result (internal 1.1V VREF).
+// Each call is short; the reference settling (TEMP_SETTLE_TIME) and the conversion are done between the calls. A conversion of 
+// the I2C device or I2C_Device_ADC_Sample in the middle switch the multiplexer and restart the sequence.
+#define TEMP_SETTLE_TIME	2 // msec; internal reference settling (1 msec) with msec resolution
+extern bool I2C_Device_ADC_Temp_Sample (uint16_t *pValue);
 
 #endif
 
@@ -10,13 +10,24 @@
  Virtual I2C EEPROM 64KB
 ************************************************************************
  Memory Map:
- * 0x0000..0x007F: RW: (128 bytes) part of ATtiny1634 EEPROM (via 'write enable' sequence).
+ * 0x0000..0x007F: RW: (128 bytes) part of ATtiny1634 EEPROM (via 'write enable' sequence); 0x0038..0x003F is the module configuration record (see Config.h).
  * 0x0080..0x00FF: RO: (128 bytes) part of ATtiny1634 EEPROM (logging area).
  * 0x0100..0x013F: RO: (64 bytes) software info 
+ * 0x0200..0x02FF: RO: (256 bytes) decoded event log; 32 entries of 8 bytes, newest event first (see EventLog.h).
+ * 0x0300..0x03FF: RW: (256 bytes) crash trace (see Trace.h); write any value to 0x0300 (via 'write enable' sequence) to clear and unfreeze the trace. 
  * 0x1000..0x14FF: RO: (1280 bytes) ATtiny1634 Data Memory (SRAM) and Register Files.
- * 0x3000..0x3004: RW: (5 bytes) WatchDog Module (via 'write enable' sequence)
+ * 0x2000..0x2007: RW: (8 bytes) I2C slave module: 0x2000: time-out in msec, 0 to disable (RW via 'write enable' sequence); 
+                       0x2001..0x2002: number of time-out recoveries (RO); 0x2003..0x2004: number of recoveries with SDA held low (RO).
+                       0x2005: SMBus PEC enable, bit per device index (RW via 'write enable' sequence); 0x2006..0x2007: number of PEC errors (RO).
+ * 0x2010..0x2013: RO: (4 bytes) stack: 0x2010..0x2011: stack size; 0x2012..0x2013: bytes never used by the stack (see Stack.h).
+ * 0x2100..0x217F: RW: (128 bytes) ISR profile (ISR_PROFILE; see Profile.h); write any value to 0x2100 (via 'write enable' sequence) to clear.
+ * 0x3000..0x3004: RW: (5 bytes) WatchDog Module legacy register (channel 0) (via 'write enable' sequence)
+ * 0x3100..0x313F: RW: (64 bytes) WatchDog Module channel registers, 16 bytes per channel (via 'write enable' sequence); see BMC_WD.h.
+ * 0x3F00..0x3F03: WO: (4 bytes) WatchDog Module kick register per channel; single byte write of the channel key (no 'write enable' sequence).
  * 0x4000..0x7FFF: RO: (16KB) ATtiny1634 Flash.
  * 0x8000..0x8003: RW: (4 bytes) 'write enable' module. 
+ * 0x8010:         WO: batched write command (see below).
+ * 0x8020:         WO: write BOOT_ENTER_KEY (via 'write enable' sequence) to enter the I2C bootloader (see Boot.h).
  
  unused sections are reserved and return 0xEE.
 
@@ -29,32 +40,59 @@
 	> issue write to 0x8002 with required data[7:0]    
 	> issue write to address with required data.
 	Note: Repeat this for each byte write. any other writes reset 'write enable'. 
+
+ * batched write (unlock and write in a single write transaction): 
+    > issue write to 0x8010 followed by: address[15:8], address[7:0], key, data[0], ..., data[n-1] (n = 1..16)
+	> key is CRC-8 (SMBus PEC polynomial x^8+x^2+x+1, initial value 0) of address[15:8], address[7:0] and all data bytes.
+	> data is written on stop, to consecutive addresses, only if the key match; any address that require 'write enable' sequence is allowed. 
+	> all or nothing: every address is checked (same rules as the single byte write, and room in the EEPROM write queue) 
+	  before any byte is written.
+	> 0x8003 return the status of the last batched write: bit 7: error (key, address or queue full; nothing written); bit 4..0: number of bytes written.
+	Note: the 'write enable' sequence state is not affected.
 */
 
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
 
 #include <avr/io.h>
 #include <util/atomic.h>
 #include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
 #include <avr/eeprom.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <util/crc16.h>
 #include "CoreRegisters.h"
 #include "I2C_Slave.h"
+#include "EventLog.h"
 #include "TimeStamp.h"
+#include "Trace.h"
+#include "BMC_WD.h"
+#include "EEPROM_Queue.h"
+#include "Boot.h"
+#include "Stack.h"
+#include "Profile.h"
+#define LOG_MODULE EEPROM
+#include "Log.h"
 
 #define F_CPU 8000000UL  // 8 MHz
 #include <util/delay.h>
 
-static uint8_t g_WD_Cfg; 
-static uint32_t g_WD_TimeOut;  // in msec  
+#define BATCH_ADDR		0x8010
+#define BATCH_MAX_DATA	16
+#define BATCH_STATUS_ERROR 0x80
 
-static uint8_t Write_Buffer [3]; // 2 byte address (up to 64KB) + 1 byte data 
+static uint8_t Write_Buffer [3+2+BATCH_MAX_DATA]; // 2 byte address (up to 64KB) + 1 byte data; batched write use the rest: address[7:0], key and data.
 static uint8_t Read_Buffer [16]; // 16 byte of page read
 static uint16_t g_Current_Addr; 
 
 static uint16_t g_WriteEnable_Addr; // write enable sequence is required to allow byte write; 
 static uint8_t  g_WriteEnable_Data;
 
+static uint8_t g_Batch_State; // 0: idle; 1: receiving; 2: buffer full (NACK next bytes)
+static uint8_t g_Batch_Length; // number of bytes received after address[15:8], when the buffer is full
+static uint8_t g_Batch_Status; // last batched write status (see 0x8003)
+
 static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte,  uint8_t NumOfByteUsed);
 
 //--------------------------------------------------------------------------
@@ -63,68 +101,108 @@ extern void I2C_Device_EEPROM_Init (uint8_t DeviceIndex)
 	g_Current_Addr = 0;
 	g_WriteEnable_Addr = 0;
 	g_WriteEnable_Data = 0;
-	g_WD_Cfg = 0;
-	g_WD_TimeOut = 0;
-	pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_EEPROM_Func;
+	g_Batch_State = 0;
+	g_Batch_Status = 0;
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_EEPROM_Func;
 	printf_P (PSTR("> I2C_Device_EEPROM_Init; register to I2C device index %u; \r\n"), DeviceIndex);
 }
-//---------------------------------------------------------------------------------------------
-extern void WD_Touch (void)
+//--------------------------------------------------------------------------
+// write to an address that require 'write enable' sequence; return false if address is not writable.
+// Commit false: check only (nothing is written; EEPROM write queue room is not checked).
+static bool I2C_Device_EEPROM_Write (uint16_t Addr, uint8_t Data, bool Commit)
 {
-	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	if ( (Addr >= 0x0038) && (Addr <= 0x007F) )
+	{ // we allow write only within 0x38-0x7F range where 0x40-0x7F are reserved for user defined.
+		return (Commit ? EEPROM_Queue_Write ((uint8_t)Addr, Data) : true);
+	}
+	else if (Addr == 0x2000)  // I2C slave time-out 
 	{
-		g_WD_TimeOut = ((uint32_t)1<<(g_WD_Cfg>>4)) * 1000;
+		if (Commit)
+			I2C_Slave_Set_TimeOut (Data);
+		return (true);
 	}
-}
-//---------------------------------------------------------------------------------------------
-extern void WD_Stop (void)
-{
-	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	else if (Addr == 0x2005)  // I2C slave PEC enable 
+	{
+		if (Commit)
+			I2C_Slave_Set_PEC (Data);
+		return (true);
+	}
+	else if ( (Addr >= 0x3000) && (Addr <= 0x3EFF) )  // WD config registers 
+	{
+		return (Commit ? WD_Write_Reg (Addr, Data) : WD_Is_Writable (Addr));
+	}
+	else if (Addr == 0x0300)  // crash trace clear
+	{
+		if (Commit)
+			Trace_Clear ();
+		return (true);
+	}
+#if (ISR_PROFILE == 1)
+	else if (Addr == 0x2100)  // ISR profile clear
+	{
+		if (Commit)
+			Profile_Clear ();
+		return (true);
+	}
+#endif
+	else if ( (Addr == BOOT_ENTER_ADDR) && (Data == BOOT_ENTER_KEY) )  // firmware update
 	{
-		g_WD_Cfg = 0;
-		g_WD_TimeOut = 0;
+		if (Commit)
+			Boot_Request ();
+		return (true);
 	}
+	
+	return (false);
 }
-//---------------------------------------------------------------------------------------------
-extern void WD_PeriodicTask (uint32_t ElapsedTime /*msec*/)
+//--------------------------------------------------------------------------
+// execute batched write on stop; Length is the number of bytes received after address[15:8] (address[7:0], key and data).
+static void I2C_Device_EEPROM_Batch (uint8_t Length)
 {
-	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	uint8_t *pData = &Write_Buffer[5];
+	uint8_t Count = Length - 2;
+	uint16_t Addr = (uint16_t)Write_Buffer[2]<<8  | (uint16_t)Write_Buffer[3];
+	uint8_t Key = 0;
+	uint8_t Queued = 0; // bytes to the EEPROM write queue
+	uint8_t i;
+	
+	g_Batch_Status = BATCH_STATUS_ERROR;
+	
+	if ( (Length < 3) || (Count > BATCH_MAX_DATA) )
+		return;
+	
+	Key = _crc8_ccitt_update (Key, Write_Buffer[2]);
+	Key = _crc8_ccitt_update (Key, Write_Buffer[3]);
+	for (i = 0; i < Count; i++)
+		Key = _crc8_ccitt_update (Key, pData[i]);
+	
+	if (Key != Write_Buffer[4])
 	{
-		if (g_WD_TimeOut != 0)
+		LOG_ERROR (LOG_EEPROM_BATCH_KEY, (uint8_t)Addr);
+		return;
+	}
+	
+	// all or nothing: check every address before the first write (called from TWI ISR; the queue room can't change between)
+	for (i = 0; i < Count; i++)
+	{
+		if (I2C_Device_EEPROM_Write (Addr + i, pData[i], false) == false)
 		{
-			if (g_WD_TimeOut > ElapsedTime)
-			g_WD_TimeOut -= ElapsedTime;
-			else
-			{
-				printf_P (PSTR("> WD Timeout.\r\n"));
-				EventType |= EVENT_BMC_WD;
-				TimeStamp_Reset();
-				
-				if (g_WD_Cfg & 0x01) 
-				{
-					// CORST_N (PA2)
-					printf_P (PSTR("> Asserted BMC CORST#.\r\n"));
-					CLEAR_BIT_REG (PORTA, PA2); // set low
-					SET_BIT_REG (DDRA, PA2); // set output
-					_delay_us (10);
-					CLEAR_BIT_REG (DDRA, PA2); // set input (external PU)
-				}
-				else if (g_WD_Cfg & 0x02)
-				{
-					// PORST_N (PA1)
-					printf_P (PSTR("> Asserted BMC PORST#.\r\n"));
-					CLEAR_BIT_REG (PORTA, PA1); // set low
-					SET_BIT_REG (DDRA, PA1); // set output
-					_delay_us (10);
-					CLEAR_BIT_REG (DDRA, PA1); // set input (external PU)
-				}
-			
-				WD_Stop();
-			}
+			LOG_ERROR (LOG_EEPROM_BATCH_DENIED, (uint8_t)(Addr + i));
+			return;
 		}
+		if (Addr + i <= 0x007F)
+			Queued++;
 	}
+	
+	if (EEPROM_Queue_Free () < Queued)
+		return; // EEPROM is busy; nothing is written.
+	
+	for (i = 0; i < Count; i++, Addr++)
+		I2C_Device_EEPROM_Write (Addr, pData[i], true);
+	
+	g_Batch_Status = Count;
 }
-//---------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------
 
 
 static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
@@ -142,24 +220,55 @@ static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer
 			*MaxNumOfByte = sizeof (Read_Buffer);
 			
 			if ( g_Current_Addr <= 0x00FF ) // ATtiny1634 EEPROM
-				eeprom_read_block ((void*)Read_Buffer, (const void*)(g_Current_Addr&0x00FF), sizeof(Read_Buffer));
+			{
+				EEPROM_Queue_Peek_Block ((uint8_t)g_Current_Addr, (uint8_t*)Read_Buffer, MIN ((uint16_t)sizeof(Read_Buffer), 0x0100 - g_Current_Addr)); // include bytes not yet programmed (RAM mirror with EEPROM_MIRROR)
+			}
 				
 			else if ( (g_Current_Addr >= 0x0100) && (g_Current_Addr <= 0x013F) ) // software info 
-				memcpy_P ((void*)Read_Buffer, (const void*)(0x70 + (g_Current_Addr&0x3F)), sizeof(Read_Buffer));
+				memcpy_P ((void*)Read_Buffer, (const void*)(0x70 + (g_Current_Addr&0x3F)), MIN ((uint16_t)sizeof(Read_Buffer), 0x0140 - g_Current_Addr));
+				
+			else if ( (g_Current_Addr >= 0x0200) && (g_Current_Addr <= 0x02FF) ) // decoded event log
+				EventLog_Read_Decoded ((uint8_t)g_Current_Addr, (uint8_t*)Read_Buffer, MIN ((uint16_t)sizeof(Read_Buffer), 0x0300 - g_Current_Addr));
+				
+			else if ( (g_Current_Addr >= 0x0300) && (g_Current_Addr <= 0x03FF) ) // crash trace
+				Trace_Read ((uint8_t)g_Current_Addr, (uint8_t*)Read_Buffer, MIN ((uint16_t)sizeof(Read_Buffer), 0x0400 - g_Current_Addr));
 				
-			else if ( (g_Current_Addr >= 0x3000) && (g_Current_Addr <= 0x3004) ) // WD module registers
+			else if ( (g_Current_Addr >= 0x2000) && (g_Current_Addr <= 0x2007) ) // I2C slave module registers
+			{
+				uint8_t temp [8];
+				uint16_t Count;
+				temp [0] = I2C_Slave_Get_TimeOut ();
+				Count = I2C_Slave_Get_Recovery_Count ();
+				memcpy ((void*)&temp[1], (const void*)(&Count) , sizeof(Count));
+				Count = I2C_Slave_Get_Stuck_Count ();
+				memcpy ((void*)&temp[3], (const void*)(&Count) , sizeof(Count));
+				temp [5] = I2C_Slave_Get_PEC ();
+				Count = I2C_Slave_Get_PEC_Error_Count ();
+				memcpy ((void*)&temp[6], (const void*)(&Count) , sizeof(Count));
+				memcpy ((void*)Read_Buffer, (const void*)(&temp[g_Current_Addr-0x2000]) , sizeof(temp) - (g_Current_Addr-0x2000));
+			}
+			
+			else if ( (g_Current_Addr >= 0x2010) && (g_Current_Addr <= 0x2013) ) // stack
 			{
-				uint8_t temp [5];
-				temp [0] = g_WD_Cfg;
-				memcpy ((void*)&temp[1], (const void*)(&g_WD_TimeOut) , sizeof(g_WD_TimeOut));
-				memcpy ((void*)Read_Buffer, (const void*)(&temp[g_Current_Addr&0x1]) , sizeof(temp));
+				uint16_t temp [2];
+				temp [0] = Stack_Get_Size ();
+				temp [1] = Stack_Get_Unused ();
+				memcpy ((void*)Read_Buffer, (const void*)((uint8_t*)temp + (g_Current_Addr-0x2010)) , sizeof(temp) - (g_Current_Addr-0x2010));
 			}
+			
+#if (ISR_PROFILE == 1)
+			else if ( (g_Current_Addr >= 0x2100) && (g_Current_Addr <= 0x217F) ) // ISR profile
+				Profile_Read ((uint8_t)g_Current_Addr, (uint8_t*)Read_Buffer, MIN ((uint16_t)sizeof(Read_Buffer), 0x2180 - g_Current_Addr));
+#endif
+			
+			else if ( (g_Current_Addr >= 0x3000) && (g_Current_Addr <= 0x3FFF) ) // WD module registers
+				WD_Read_Regs (g_Current_Addr, (uint8_t*)Read_Buffer, sizeof(Read_Buffer));
 		
 			else if ( (g_Current_Addr >= 0x1000) && (g_Current_Addr <= 0x14FF) )  // ATtiny1634 Data Memory (SRAM) and Register Files 
-				memcpy ((void*)Read_Buffer, (const void*)(g_Current_Addr&0x04FF), sizeof(Read_Buffer));
+				memcpy ((void*)Read_Buffer, (const void*)(g_Current_Addr - 0x1000), MIN ((uint16_t)sizeof(Read_Buffer), 0x1500 - g_Current_Addr));
 				
 			else if ( (g_Current_Addr >= 0x4000) && (g_Current_Addr <= 0x7FFF) ) // ATtiny1634 Flash
-				memcpy_P ((void*)Read_Buffer, (const void*)(g_Current_Addr&0x3FFF), sizeof(Read_Buffer));
+				memcpy_P ((void*)Read_Buffer, (const void*)(g_Current_Addr&0x3FFF), MIN ((uint16_t)sizeof(Read_Buffer), 0x8000 - g_Current_Addr));
 			
 			else if ( (g_Current_Addr >= 0x8000) && (g_Current_Addr <= 0x8003) ) // 'write enable' module registers
 			{
@@ -167,8 +276,8 @@ static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer
 				temp [0] = g_WriteEnable_Addr;
 				temp [1] = g_WriteEnable_Addr>>8;
 				temp [2] = g_WriteEnable_Data;
-				temp [3] =0;
-				memcpy ((void*)Read_Buffer, (const void*)(&temp[g_Current_Addr&0x3]) , sizeof(temp));
+				temp [3] = g_Batch_Status;
+				memcpy ((void*)Read_Buffer, (const void*)(&temp[g_Current_Addr&0x3]) , sizeof(temp) - (g_Current_Addr&0x3));
 			}
 			
 			break;
@@ -180,14 +289,21 @@ static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer
 			
 		case I2C_WR_START:
 			*pBuffer = (uint8_t *) Write_Buffer;
-			*MaxNumOfByte = sizeof (Write_Buffer);
+			*MaxNumOfByte = 3;
+			g_Batch_State = 0;
 			break;
 	
 		case I2C_WR_ERROR: 
+			g_Batch_State = 0;
 			break;  // disregard this write cycle
 			
 		case I2C_WR_STOP: 
-			if (NumOfByteUsed == 2)
+			if (g_Batch_State != 0)
+			{ // batched write: bytes after address[15:8] are in Write_Buffer[3..]
+				I2C_Device_EEPROM_Batch ((g_Batch_State == 1) ? NumOfByteUsed : g_Batch_Length);
+				g_Batch_State = 0;
+			}
+			else if (NumOfByteUsed == 2)
 			{ //  write cycle include x2 address bytes, update the address.
 				g_Current_Addr = (uint16_t)Write_Buffer[0]<<8  | (uint16_t)Write_Buffer[1];
 			}
@@ -196,6 +312,20 @@ static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer
 		case I2C_WR_BUFF_FULL:
 			//  write cycle is complete (x2 address and x1 data bytes was received), if allow, program the data; 
 		
+			if (g_Batch_State == 1)
+			{ // batched write buffer is full; program on stop. 
+				g_Batch_State = 2;
+				g_Batch_Length = NumOfByteUsed;
+				*MaxNumOfByte = 0;
+				break;
+			}
+			else if (g_Batch_State == 2)
+			{
+				*MaxNumOfByte = 0;
+				ResponseType = I2C_NACK; // too many bytes 
+				break;
+			}
+			
 			*MaxNumOfByte = 0; // no more bytes are allow according EEPROM protocol (byte write only); disregard next write cycle by NACK, if any.
 			
 			//  write cycle include x2 address bytes, update the address.  
@@ -216,20 +346,27 @@ static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer
 				g_WriteEnable_Data = Write_Buffer[2];
 			}
 			
+			else if (g_Current_Addr == BATCH_ADDR)
+			{ // batched write: Write_Buffer[2] is address[15:8]; receive the rest of the command. 
+				g_Batch_State = 1;
+				*pBuffer = (uint8_t *) &Write_Buffer[3];
+				*MaxNumOfByte = sizeof (Write_Buffer) - 3;
+			}
+			
+			else if ( (g_Current_Addr >= WD_KICK_ADDR) && (g_Current_Addr < WD_KICK_ADDR + WD_CHANNELS) )
+			{ // WD kick: single write cycle with the channel key; 'write enable' sequence is not required and not affected.
+				if (WD_Kick (g_Current_Addr - WD_KICK_ADDR, Write_Buffer[2]) == false)
+					ResponseType = I2C_NACK;
+			}
+			
 			else if ( (g_Current_Addr == g_WriteEnable_Addr) && (Write_Buffer[2] == g_WriteEnable_Data) )
 			{ // 'write enable' sequence must be update previous to this write cycle 
-				//printf_P (PSTR("> write allow:  data:0x%02X; Addr:0x%x; \r\n"),  Write_Buffer[2], g_Current_Addr);
+				LOG_DEBUG (LOG_EEPROM_WRITE, Write_Buffer[2]);
 				
-				if ( (g_Current_Addr >= 0x0038) && (g_Current_Addr <= 0x007F) )
-				{ // we allow write only within 0x38-0x7F range where 0x40-0x7F are reserved for user defined.
-					eeprom_write_byte ((uint8_t *)(g_Current_Addr&0x00FF), Write_Buffer[2]);
-				}
-				else if (g_Current_Addr == 0x3000)  // WD config register 
-				{
-					if (g_WD_Cfg==0)
-						g_WD_Cfg = Write_Buffer[2];
-						
-					WD_Touch();
+				if (I2C_Device_EEPROM_Write (g_Current_Addr, Write_Buffer[2], true) == false)
+				{ // read-only register or EEPROM write queue is full; data is not written. 
+					ResponseType = I2C_NACK;
+					LOG_ERROR (LOG_EEPROM_WRITE_DENIED, (uint8_t)g_Current_Addr);
 				}
 						
 				g_WriteEnable_Addr = 0;
@@ -241,12 +378,12 @@ static uint8_t I2C_Device_EEPROM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer
 				g_WriteEnable_Addr = 0;
 				g_WriteEnable_Data = 0;
 				ResponseType = I2C_NACK;
-				printf_P (PSTR("> EERPOM Unauthorized write:  data:0x%02X; Addr:0x%x; \r\n"),  Write_Buffer[2], g_Current_Addr);
+				LOG_ERROR (LOG_EEPROM_UNAUTHORIZED, (uint8_t)g_Current_Addr);
 			}
 			break;
 			
 		default:
-			printf_P (PSTR("> I2C_Device_EEPROM_Func: *** ERROR *** Unknown status. \r\n"));
+			LOG_ERROR (LOG_BAD_STATUS, Status);
 			break;
 	}
 	
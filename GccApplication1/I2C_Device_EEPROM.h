@@ -11,10 +11,6 @@
 
 extern void I2C_Device_EEPROM_Init (uint8_t DeviceIndex);
 
-extern void WD_PeriodicTask (uint32_t ElapsedTime /*msec*/);
-extern void WD_Touch (void);
-extern void WD_Stop (void);
-
 #endif
 
 
@@ -0,0 +1,249 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ****************************************
+ Virtual I2C Fan Controller (PWM and Tach)
+ ****************************************
+ 
+ Subset of EMC2101 (fan control registers only; temperature is I2C_Device_Temp); register set in I2C_Device_Fan.h.
+ 
+ * Write: register pointer, optionally followed by data; continues write repeat the same register.
+ * Read: the register selected by the pointer; continues read increment the pointer (e.g., tach LSB and MSB).
+ * PWM: Timer1 stay the free running time base (see SystemTick.c); OC1A toggle on compare match, so the edges are hardware timed, 
+   and the compare interrupt only schedule the next edge. The interrupt can be late by more than a setting step (e.g., behind
+   ADC_DIFF_Convert in the TWI ISR, ~200 usec); when the next edge time has already passed, it is scheduled FAN_PWM_LEAD from
+   the current Timer1 count (the pulse is stretched by the latency) instead of a compare match a full Timer1 period later (~65 msec). 
+   Setting 0 and FAN_SETTING_MAX drive a constant level without interrupts. 
+ * Tach: input capture is not available on a free pin; the pin change interrupt take a time base stamp of each falling edge.
+   Every FAN_TACH_WINDOW msec, the main loop average the period over the first to last pulse of the window and update the cached 
+   tach register; reads never wait for a measurement.
+ * The PWM and tach pins are shared with the GPI, ADC and GPIO expander devices; do not use them for other purpose when this device is enabled.
+*/
+
+/*
+TBD:
+1. Add tach limit and alert (INT# is shared; use I2C_Slave_Alert).
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_Fan.h"
+#include "SystemTick.h"
+#include "Trace.h"
+#define LOG_MODULE GPI
+#include "Log.h"
+
+#if (FAN_DEVICE == 1)
+
+#define FAN_PWM_LEAD		8 // usec; minimum time from the compare interrupt to the next edge
+
+static uint8_t g_Fan_Pointer;
+static uint8_t Write_Buffer [2]; // pointer + data
+static uint8_t Read_Buffer;
+static uint8_t g_Fan_Setting;
+static volatile uint16_t g_Fan_High; // PWM high time (usec); read by the compare interrupt
+static uint16_t g_Fan_Tach; // cached tach count
+static uint8_t g_Fan_Tach_MSB; // latched on LSB read
+static volatile uint8_t g_Fan_Edges; // tach falling edges in the current window (saturate)
+static volatile uint32_t g_Fan_First; // time base usec of the first and last edges
+static volatile uint32_t g_Fan_Last;
+static uint16_t g_Fan_Window_msec; // time base msec (low 16-bit) of the window start
+
+static uint8_t I2C_Device_Fan_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed);
+
+//----------------------------------------------------------------------------------
+// set PWM duty cycle; interrupts are disabled.
+static void Fan_Set_PWM (uint8_t Setting)
+{
+	if (Setting > FAN_SETTING_MAX)
+		Setting = FAN_SETTING_MAX;
+	g_Fan_Setting = Setting;
+	g_Fan_High = Setting * FAN_PWM_STEP;
+	
+	if ( (Setting == 0) || (Setting == FAN_SETTING_MAX) )
+	{
+		CLEAR_BIT_REG (TIMSK, OCIE1A);
+		TCCR1A = 0x00; // OC1A disconnected; normal port operation
+		WRITE_BIT_REG (PORTB, PB3, (Setting != 0));
+	}
+	else if (IS_BIT_CLEARED (TIMSK, OCIE1A))
+	{
+		OCR1A = SystemTick_Get_Timer1 () + FAN_PWM_STEP; // first edge
+		TIFR = 1<<OCF1A; // clear flag
+		TCCR1A = 1<<COM1A0; // toggle OC1A on compare match; normal mode (Timer1 time base is not changed)
+		SET_BIT_REG (TIMSK, OCIE1A);
+	}
+	// otherwise, the new duty cycle is used from the next edge
+}
+//----------------------------------------------------------------------------------
+// OC1A was toggled by hardware; schedule the next edge.
+ISR(TIMER1_COMPA_vect, ISR_BLOCK)
+{
+	uint16_t Next = OCR1A;
+	uint16_t Now;
+	
+	if (IS_BIT_SET (PINB, PB3))
+		Next += g_Fan_High;
+	else
+		Next += FAN_SETTING_MAX * FAN_PWM_STEP - g_Fan_High;
+	
+	Now = TCNT1;
+	if ((int16_t)(Next - Now) < FAN_PWM_LEAD) // late interrupt; the edge time has passed (or is too close)
+		Next = Now + FAN_PWM_LEAD;
+	OCR1A = Next;
+}
+//----------------------------------------------------------------------------------
+// tach (PC0) falling edge
+ISR(PCINT2_vect, ISR_BLOCK)
+{
+	uint32_t Now;
+	
+	if (IS_BIT_SET (PINC, PC0) || (g_Fan_Edges == 0xFF))
+		return; // rising edge, or window is full (first to last edge are kept consistent with the count)
+	
+	Now = SystemTick_Get_usec ();
+	if (g_Fan_Edges == 0)
+		g_Fan_First = Now;
+	g_Fan_Last = Now;
+	g_Fan_Edges++;
+}
+//----------------------------------------------------------------------------------
+extern void I2C_Device_Fan_Init (uint8_t DeviceIndex)
+{
+	g_Fan_Pointer = FAN_REG_TACH_LSB;
+	g_Fan_Tach = 0xFFFF;
+	g_Fan_Edges = 0;
+	g_Fan_Window_msec = (uint16_t)SystemTick_Get_msec ();
+	
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled; pins are not used
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			SET_BIT_REG (DDRB, PB3); // PWM output
+			Fan_Set_PWM (FAN_SETTING_MAX);
+		}
+		SET_BIT_REG (PUEC, PC0); // tach is open-drain; enable pull-up
+		SET_BIT_REG (PCMSK2, PCINT12); // PC0 pin change interrupt
+		SET_BIT_REG (GIMSK, PCIE2);
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_Fan_Func;
+	}
+	printf_P (PSTR("> I2C_Device_Fan_Init; register to I2C device index %u; \r\n"), DeviceIndex);
+}
+//----------------------------------------------------------------------------------
+// Call from main loop. 
+extern void I2C_Device_Fan_BackgroundTask (void)
+{
+	uint8_t Edges;
+	uint32_t Span;
+	uint32_t Tach = 0xFFFF;
+	
+	if ((uint16_t)((uint16_t)SystemTick_Get_msec () - g_Fan_Window_msec) < FAN_TACH_WINDOW)
+		return;
+	g_Fan_Window_msec += FAN_TACH_WINDOW;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Edges = g_Fan_Edges;
+		Span = g_Fan_Last - g_Fan_First;
+		g_Fan_Edges = 0; // new window
+	}
+	
+	// Edges-1 periods in Span usec; 2 pulses per revolution: RPM = 30000000 * (Edges-1) / Span;
+	// tach = FAN_TACH_RPM / RPM = Span * 9 / (50 * (Edges-1)).
+	if ( (Edges >= 2) && (Span > 0) )
+	{
+		Tach = Span * 9 / (50 * (uint16_t)(Edges - 1));
+		if (Tach > 0xFFFE)
+			Tach = 0xFFFE; // slowest measurable; 0xFFFF is stall
+	}
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		g_Fan_Tach = (uint16_t)Tach;
+	}
+}
+//--------------------------------------------------------------------------
+// read register; interrupts are disabled.
+static uint8_t Fan_Read_Reg (uint8_t Reg)
+{
+	switch (Reg)
+	{
+		case FAN_REG_TACH_LSB:
+			g_Fan_Tach_MSB = (uint8_t)(g_Fan_Tach >> 8);
+			return ((uint8_t)g_Fan_Tach);
+		case FAN_REG_TACH_MSB:
+			return (g_Fan_Tach_MSB);
+		case FAN_REG_SETTING:
+			return (g_Fan_Setting);
+		case FAN_REG_PRODUCT_ID:
+			return (0x16);
+		case FAN_REG_MFG_ID:
+			return (0x5D);
+		case FAN_REG_REVISION:
+			return (0x01);
+		default:
+			return (0x00);
+	}
+}
+//--------------------------------------------------------------------------
+static uint8_t I2C_Device_Fan_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
+{
+	uint8_t ResponseType = I2C_ACK;
+	
+	switch (Status)
+	{
+		case I2C_RD_START: 
+		case I2C_RD_BUFF_EMPTY: // continues read: next register
+			Read_Buffer = Fan_Read_Reg (g_Fan_Pointer++);
+			*pBuffer = &Read_Buffer;
+			*MaxNumOfByte = sizeof (Read_Buffer);
+			break;
+		
+		case I2C_RD_STOP:  //  nothing to do.
+		case I2C_RD_ERROR: //  we don't care about the error.
+			break;
+		
+		case I2C_WR_START:
+			*pBuffer = Write_Buffer;
+			*MaxNumOfByte = sizeof (Write_Buffer);
+			break;
+			
+		case I2C_WR_BUFF_FULL: // pointer and data (2 bytes), then one byte per data byte
+			if (NumOfByteUsed == sizeof (Write_Buffer))
+				g_Fan_Pointer = Write_Buffer [0];
+			if (g_Fan_Pointer == FAN_REG_SETTING)
+				Fan_Set_PWM (Write_Buffer [1]);
+			*pBuffer = &Write_Buffer [1];
+			*MaxNumOfByte = 1;
+			break;
+		
+		case I2C_WR_STOP:
+			if (NumOfByteUsed == 1) // pointer only (data bytes are handled on buffer full)
+				g_Fan_Pointer = Write_Buffer [0];
+			break;
+		
+		case I2C_WR_ERROR: // PEC mismatch, bus error or time-out: drop the pointer write
+			break;
+		
+		default:
+			LOG_ERROR (LOG_BAD_STATUS, Status);
+			break;
+	}
+	
+	return (ResponseType);
+}
+//--------------------------------------------------------------------------
+
+#endif
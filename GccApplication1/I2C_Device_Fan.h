@@ -0,0 +1,36 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _I2C_DEVICE_FAN_H_
+#define _I2C_DEVICE_FAN_H_
+
+// Fan PWM and tach device (FAN_DEVICE == 1); EMC2101 register subset.
+// PWM output on OC1A (PB3; RunBMC header GPI6); tach input on PC0 (RunBMC header GPI7; pin change interrupt). 
+// RAM: 20 bytes; the link fail if static data leave less than STACK_BUDGET (see Stack.h).
+#ifndef FAN_DEVICE
+#define FAN_DEVICE 0 // 1: include the fan device
+#endif
+
+// Registers (other registers read 0x00; writes are ignored)
+#define FAN_REG_TACH_LSB	0x46 // RO: tach count (FAN_TACH_RPM / RPM) bits 7..0; the MSB is latched when the LSB is read
+#define FAN_REG_TACH_MSB	0x47 // RO: tach count bits 15..8; 0xFFFF: stalled (less than 2 tach pulses in the window)
+#define FAN_REG_SETTING		0x4C // RW: PWM duty cycle (0..FAN_SETTING_MAX); default FAN_SETTING_MAX (full speed until the host take control)
+#define FAN_REG_PRODUCT_ID	0xFD // RO: 0x16
+#define FAN_REG_MFG_ID		0xFE // RO: 0x5D
+#define FAN_REG_REVISION	0xFF // RO: 0x01
+
+#define FAN_SETTING_MAX		63
+#define FAN_PWM_STEP		160 // usec per setting step; PWM period is FAN_SETTING_MAX * FAN_PWM_STEP (~99Hz)
+#define FAN_TACH_RPM		5400000UL // RPM = FAN_TACH_RPM / tach count (2 tach pulses per revolution)
+#define FAN_TACH_WINDOW		1000 // msec; tach is averaged over the pulses in the window
+
+extern void I2C_Device_Fan_Init (uint8_t DeviceIndex);
+extern void I2C_Device_Fan_BackgroundTask (void);
+
+#endif
+
+
@@ -23,10 +23,15 @@ TBD:
 #include <avr/io.h>
 #include <util/atomic.h>
 #include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include "CoreRegisters.h"
 #include "I2C_Slave.h"
+#include "Console.h"
+#include "Trace.h"
+#define LOG_MODULE GPI
+#include "Log.h"
 
 static uint8_t Read_Buffer [2]; // status of input ports + transition flags
 
@@ -35,6 +40,7 @@ static uint8_t g_GPI_PrevValue;
 static uint8_t g_GPI_InterruptMask;
 static uint8_t g_GPI_Transition;
 static uint8_t g_GPI_EnableInterrupt;
+static uint8_t g_GPI_DeviceIndex;
 
 static uint8_t I2C_Device_GPI_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed);
 
@@ -49,10 +55,8 @@ ATtiny1634:		PB2
 //----------------------------------------------------------------------------------
 static void GPI_Init (void)
 {
-	// we assume all GPIOs are default input after reset. 
-	// we assume external PU exist on INT# so no glitch will appear now.
-	SET_BIT_REG (PORTB,PB2); // Set PB2 high (disable interrupt)
-	SET_BIT_REG (DDRB,PB2); // Set PB2 output (Push-Pull)
+	// we assume all GPIOs are default input after reset (may be set as outputs by the GPIO expander; see I2C_Device_GPIO.c). 
+	// INT# (PB2) is owned by the I2C slave module (see I2C_Slave_Alert).
 }
 //----------------------------------------------------------------------------------
 static uint8_t GPI_ReadState (void)
@@ -67,6 +71,9 @@ static uint8_t GPI_ReadState (void)
 	value |=  ((l_PORTB>>3)&0x1)<<6 ; // PB3 ==> GPI6
 	value |=  ((l_PORTB>>0)&0x1)<<5 ; // PB0 ==> GPI5
 	value |=  ((l_PORTA>>3)&0x1F)<<0 ; // PA3..PA7 ==> GPI0..GPI4
+#if (CONSOLE_USART == 1)
+	value &= ~(1<<5 | 1<<4); // PA7 and PB0 are used by the console (RXD0 and TXD0)
+#endif
 	
 	return (value);
 }
@@ -79,27 +86,43 @@ extern void GPI_PeriodicTask (uint32_t ElapsedTime /*msec*/)
 		g_GPI_Transition |= g_GPI_CurrentValue ^ g_GPI_PrevValue;
 	
 		if (g_GPI_CurrentValue ^ g_GPI_PrevValue)
-		//printf_P (PSTR("> GPI_PeriodicTask; Transition detected; PrevValue:0x%x; CurrentValue:0x%x; Transition:0x%x. \r\n"), g_GPI_PrevValue, g_GPI_CurrentValue, g_GPI_Transition);
-	
-		if ( (g_GPI_EnableInterrupt == 1) /*&& (IS_BIT_SET(PINB, PB2))*/ && ((g_GPI_Transition & g_GPI_InterruptMask) != 0) )
 		{
-			CLEAR_BIT_REG (PORTB, PB2); // Set PB2 low to issue interrupt to host
-			//printf_P (PSTR("> GPI_PeriodicTask; issue interrupt to host. \r\n"));	
+			LOG_DEBUG (LOG_GPI_TRANSITION, g_GPI_Transition);
+	
+			if ( (g_GPI_EnableInterrupt == 1) /*&& (IS_BIT_SET(PINB, PB2))*/ && ((g_GPI_Transition & g_GPI_InterruptMask) != 0) )
+			{
+				I2C_Slave_Alert (g_GPI_DeviceIndex, true); // issue interrupt to host
+				LOG_DEBUG (LOG_GPI_ALERT, g_GPI_Transition & g_GPI_InterruptMask);
+			}
 		}
 	
 		g_GPI_PrevValue = g_GPI_CurrentValue;
 	}
 }
 //----------------------------------------------------------------------------------
+extern uint16_t GPI_Get_State (void)
+{
+	uint16_t State;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		State = ((uint16_t)g_GPI_Transition << 8) | g_GPI_CurrentValue;
+	}
+	
+	return (State);
+}
+//----------------------------------------------------------------------------------
 extern void I2C_Device_GPI_Init (uint8_t DeviceIndex)
 {
 	g_GPI_Transition = 0;
 	g_GPI_InterruptMask = 0;
 	g_GPI_EnableInterrupt = 1;
+	g_GPI_DeviceIndex = DeviceIndex;
 	
 	GPI_Init ();
 	
-	pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_GPI_Func;  
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_GPI_Func;  
 	printf_P (PSTR("> I2C_Device_GPI_Init; register to I2C device index %u; \r\n"), DeviceIndex);
 }
 
@@ -112,12 +135,12 @@ static uint8_t I2C_Device_GPI_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 	{
 		case I2C_RD_START: 
 		case I2C_RD_BUFF_EMPTY: // continues master read wills sample inputs over again.  
-			SET_BIT_REG (PORTB, PB2); // Set PB2 high (disable interrupt)
+			I2C_Slave_Alert (g_GPI_DeviceIndex, false); // release INT#
 			g_GPI_EnableInterrupt = 0; // disable interrupt assertion while reading 
 			GPI_PeriodicTask (0); // sample inputs and update variables
 			Read_Buffer [0] = g_GPI_CurrentValue;
 			Read_Buffer [1] = g_GPI_Transition;
-			//printf_P (PSTR("> I2C_Device_GPI_Func; Read; PrevValue:0x%x; CurrentValue:0x%x; Transition:0x%x; Mask:0x%x. \r\n"), g_GPI_PrevValue, g_GPI_CurrentValue, g_GPI_Transition, g_GPI_InterruptMask);
+			LOG_DEBUG (LOG_GPI_READ, g_GPI_CurrentValue);
 			g_GPI_Transition = 0; // reset transitions flags
 			*pBuffer = &(Read_Buffer[0]);
 			*MaxNumOfByte = sizeof (Read_Buffer);
@@ -131,7 +154,7 @@ static uint8_t I2C_Device_GPI_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 		
 		case I2C_WR_START:
 		case I2C_WR_BUFF_FULL: // support continues writes, will overwrite. 
-			SET_BIT_REG (PORTB, PB2); // Set PB2 high (disable interrupt)
+			I2C_Slave_Alert (g_GPI_DeviceIndex, false); // release INT#
 			g_GPI_EnableInterrupt = 0;  // disable interrupt assertion while writing
 			*pBuffer = &g_GPI_InterruptMask;
 			*MaxNumOfByte = sizeof (g_GPI_InterruptMask);
@@ -144,7 +167,7 @@ static uint8_t I2C_Device_GPI_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 			break;
 		
 		default:
-			printf_P (PSTR("> I2C_Device_GPI_Func: *** ERROR *** Unknown status. \r\n"));
+			LOG_ERROR (LOG_BAD_STATUS, Status);
 			break;
 	}
 	
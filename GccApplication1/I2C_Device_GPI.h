@@ -11,6 +11,7 @@
 
 extern void I2C_Device_GPI_Init (uint8_t DeviceIndex);
 extern void GPI_PeriodicTask (uint32_t ElapsedTime /*msec*/);
+extern uint16_t GPI_Get_State (void); // bit 7..0: current inputs; bit 15..8: transitions since last GPI read (not cleared).
 #endif
 
 
@@ -0,0 +1,256 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ***************************************************************
+ Virtual I2C 16-bit GPIO Expander with Configuration and Polarity
+ ***************************************************************
+ 
+ Compatible to PCA9555 (no interrupt output); register set and port pins in I2C_Device_GPIO.h.
+ 
+ * Write: command byte followed by data bytes; the data toggle between the two registers of the pair (e.g., output 0, output 1, 
+   output 0...). Each pair is applied to the pins in one update with interrupts disabled (on the second byte, or on stop).
+ * Read: the input registers of both ports are sampled together (one snapshot per register pair); the data toggle between 
+   the two registers of the pair.
+ * By default all pins are inputs; the pins are not changed until the configuration register is written.
+ * Port 1 signals are also driven by the watchdog reset pulse (see BMC_WD.c) and the INT0 power-cycle flow (see main.c);
+   the expander change a pin only when its own output or configuration bit change, and does not track the other owners 
+   (the input register reflect the pin).
+ * Port 0 pins used by the console (CONSOLE_USART == 1) or the fan device (FAN_DEVICE == 1) are not changed and read as 0.
+*/
+
+/*
+TBD:
+1. Add interrupt output on input change (INT# is shared; use I2C_Slave_Alert).
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_GPIO.h"
+#include "I2C_Device_Fan.h"
+#include "Console.h"
+#include "Trace.h"
+#define LOG_MODULE GPI
+#include "Log.h"
+
+#if (CONSOLE_USART == 1)
+#define GPIO_PORT0_CONSOLE	0x30 // PA7 and PB0 are used by the console (RXD0 and TXD0)
+#else
+#define GPIO_PORT0_CONSOLE	0x00
+#endif
+#if (FAN_DEVICE == 1)
+#define GPIO_PORT0_FAN		0xC0 // PB3 and PC0 are used by the fan device (PWM and tach)
+#else
+#define GPIO_PORT0_FAN		0x00
+#endif
+#define GPIO_PORT0_PINS		(0xFF & ~(GPIO_PORT0_CONSOLE | GPIO_PORT0_FAN))
+
+#define GPIO_CMD_MASK		0x07 // PCA9555 use only the 3 low bits of the command byte
+
+static uint8_t g_GPIO_Regs [GPIO_REGS]; // input registers hold the last snapshot (read buffer)
+static uint8_t Write_Buffer [2]; // register pair data
+static uint8_t Cmd_Buffer; // command byte as received
+static uint8_t g_GPIO_Cmd; // register of the command (GPIO_CMD_MASK bits)
+static bool g_GPIO_Data_Phase; // command byte was received; next bytes are data
+static uint8_t g_GPIO_DeviceIndex;
+
+static uint8_t I2C_Device_GPIO_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed);
+
+//----------------------------------------------------------------------------------
+/*
+Port 0:			P0.0	P0.1	P0.2	P0.3	P0.4	P0.5	P0.6	P0.7
+RunBMC Header:	GPI0	GPI1	GPI2	GPI3	GPI4	GPI5	GPI6	GPI7			
+ATtiny1634:		PA3		PA4		PA5		PA6		PA7		PB0		PB3		PC0
+
+Port 1:			P1.0	P1.1	P1.2
+RunBMC:			CORST#	PORST#	FWSPI_PWR_EN
+ATtiny1634:		PA2		PA1		PC4
+*/
+//----------------------------------------------------------------------------------
+// sample the pins of both ports; interrupts are disabled.
+static void GPIO_Snapshot (void)
+{
+	uint8_t l_PORTA = PINA;
+	uint8_t l_PORTB = PINB;
+	uint8_t l_PORTC = PINC;
+	uint8_t Port0 = 0;
+	uint8_t Port1 = 0;
+	
+	Port0 |= ((l_PORTC>>0)&0x1)<<7 ; // PC0 ==> P0.7
+	Port0 |= ((l_PORTB>>3)&0x1)<<6 ; // PB3 ==> P0.6
+	Port0 |= ((l_PORTB>>0)&0x1)<<5 ; // PB0 ==> P0.5
+	Port0 |= ((l_PORTA>>3)&0x1F)<<0 ; // PA3..PA7 ==> P0.0..P0.4
+	
+	Port1 |= ((l_PORTA>>2)&0x1)<<0 ; // PA2 ==> P1.0
+	Port1 |= ((l_PORTA>>1)&0x1)<<1 ; // PA1 ==> P1.1
+	Port1 |= ((l_PORTC>>4)&0x1)<<2 ; // PC4 ==> P1.2
+	
+	g_GPIO_Regs [GPIO_REG_INPUT0] = (Port0 & GPIO_PORT0_PINS) ^ g_GPIO_Regs [GPIO_REG_POLARITY0];
+	g_GPIO_Regs [GPIO_REG_INPUT1] = Port1 ^ g_GPIO_Regs [GPIO_REG_POLARITY1];
+}
+//----------------------------------------------------------------------------------
+// update the pins from the output and configuration registers; interrupts are disabled.
+// Low1: port 1 pins which were driven low before the registers update.
+static void GPIO_Apply (uint8_t Low1)
+{
+	uint8_t Out0 = g_GPIO_Regs [GPIO_REG_OUTPUT0];
+	uint8_t Dir0 = ~g_GPIO_Regs [GPIO_REG_CONFIG0] & GPIO_PORT0_PINS; // 1: output
+	uint8_t Assert1;
+	uint8_t Release1;
+	
+	// port 0: set the output value before the direction, so a pin which become output is driven with the new value.
+	PORTA = (PORTA & ~((GPIO_PORT0_PINS & 0x1F) << 3)) | ((Out0 & GPIO_PORT0_PINS & 0x1F) << 3);
+#if (CONSOLE_USART == 0)
+	WRITE_BIT_REG (PORTB, PB0, (Out0 >> 5) & 0x1);
+#endif
+#if (FAN_DEVICE == 0)
+	WRITE_BIT_REG (PORTB, PB3, (Out0 >> 6) & 0x1);
+	WRITE_BIT_REG (PORTC, PC0, (Out0 >> 7) & 0x1);
+#endif
+	
+	DDRA = (DDRA & ~((GPIO_PORT0_PINS & 0x1F) << 3)) | ((Dir0 & 0x1F) << 3);
+#if (CONSOLE_USART == 0)
+	WRITE_BIT_REG (DDRB, PB0, (Dir0 >> 5) & 0x1);
+#endif
+#if (FAN_DEVICE == 0)
+	WRITE_BIT_REG (DDRB, PB3, (Dir0 >> 6) & 0x1);
+	WRITE_BIT_REG (DDRC, PC0, (Dir0 >> 7) & 0x1);
+#endif
+	
+	// port 1 (open-drain): change only the pins which the expander assert or release.
+	Assert1 = ~g_GPIO_Regs [GPIO_REG_CONFIG1] & ~g_GPIO_Regs [GPIO_REG_OUTPUT1] & GPIO_PORT1_PINS;
+	Release1 = Low1 & ~Assert1;
+	Assert1 &= ~Low1;
+	
+	if (Assert1 & GPIO_PORT1_CORST)
+	{
+		CLEAR_BIT_REG (PORTA, PA2); // set low
+		SET_BIT_REG (DDRA, PA2); // set output
+	}
+	else if (Release1 & GPIO_PORT1_CORST)
+		CLEAR_BIT_REG (DDRA, PA2); // set input (external PU)
+	
+	if (Assert1 & GPIO_PORT1_PORST)
+	{
+		CLEAR_BIT_REG (PORTA, PA1); // set low
+		SET_BIT_REG (DDRA, PA1); // set output
+	}
+	else if (Release1 & GPIO_PORT1_PORST)
+		CLEAR_BIT_REG (DDRA, PA1); // set input (external PU)
+	
+	if (Assert1 & GPIO_PORT1_FWSPI)
+	{
+		CLEAR_BIT_REG (PORTC, PC4); // set low
+		SET_BIT_REG (DDRC, PC4); // set output
+	}
+	else if (Release1 & GPIO_PORT1_FWSPI)
+		CLEAR_BIT_REG (DDRC, PC4); // set input (external PU)
+}
+//----------------------------------------------------------------------------------
+// write Count data bytes to the register pair of the command and update the pins; interrupts are disabled.
+static void GPIO_Write_Regs (const uint8_t *pData, uint8_t Count)
+{
+	uint8_t Low1 = ~g_GPIO_Regs [GPIO_REG_CONFIG1] & ~g_GPIO_Regs [GPIO_REG_OUTPUT1] & GPIO_PORT1_PINS;
+	uint8_t Reg;
+	uint8_t i;
+	
+	if (Count == 0)
+		return;
+	
+	for (i = 0; i < Count; i++)
+	{
+		Reg = g_GPIO_Cmd ^ (i & 0x1);
+		if (Reg >= GPIO_REG_OUTPUT0) // input registers are read only
+			g_GPIO_Regs [Reg] = pData[i];
+	}
+	
+	GPIO_Apply (Low1);
+	LOG_DEBUG (LOG_GPI_GPIO_WRITE, g_GPIO_Cmd << 4 | Count);
+}
+//----------------------------------------------------------------------------------
+extern void I2C_Device_GPIO_Init (uint8_t DeviceIndex)
+{
+	// PCA9555 power-up defaults; the pins are left as inputs.
+	memset (g_GPIO_Regs, 0, sizeof (g_GPIO_Regs));
+	g_GPIO_Regs [GPIO_REG_OUTPUT0] = 0xFF;
+	g_GPIO_Regs [GPIO_REG_OUTPUT1] = 0xFF;
+	g_GPIO_Regs [GPIO_REG_CONFIG0] = 0xFF;
+	g_GPIO_Regs [GPIO_REG_CONFIG1] = 0xFF;
+	g_GPIO_Cmd = GPIO_REG_INPUT0;
+	g_GPIO_Data_Phase = false;
+	g_GPIO_DeviceIndex = DeviceIndex;
+	
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_GPIO_Func;  
+	printf_P (PSTR("> I2C_Device_GPIO_Init; register to I2C device index %u; \r\n"), DeviceIndex);
+}
+//--------------------------------------------------------------------------
+static uint8_t I2C_Device_GPIO_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
+{
+	uint8_t ResponseType = I2C_ACK;
+	uint8_t Reg = g_GPIO_Cmd;
+	
+	switch (Status)
+	{
+		case I2C_RD_START: 
+			GPIO_Snapshot ();
+			*pBuffer = &g_GPIO_Regs [Reg];
+			*MaxNumOfByte = 2 - (Reg & 0x1); // to the end of the pair
+			break;
+		
+		case I2C_RD_BUFF_EMPTY: // continues read toggle between the pair registers; inputs are sampled again.
+			GPIO_Snapshot ();
+			*pBuffer = &g_GPIO_Regs [Reg & ~0x1];
+			*MaxNumOfByte = 2;
+			break;
+		
+		case I2C_RD_STOP:  //  nothing to do.
+		case I2C_RD_ERROR: //  we don't care about the error.
+			break;
+		
+		case I2C_WR_START:
+			g_GPIO_Data_Phase = false;
+			*pBuffer = &Cmd_Buffer; // command byte
+			*MaxNumOfByte = 1;
+			break;
+			
+		case I2C_WR_BUFF_FULL: 
+			if (g_GPIO_Data_Phase)
+				GPIO_Write_Regs (Write_Buffer, sizeof (Write_Buffer)); // pair is complete; continues write overwrite the pair
+			else
+			{
+				g_GPIO_Cmd = Cmd_Buffer & GPIO_CMD_MASK;
+				g_GPIO_Data_Phase = true;
+			}
+			*pBuffer = Write_Buffer;
+			*MaxNumOfByte = sizeof (Write_Buffer);
+			break;
+		
+		case I2C_WR_STOP: // apply the received bytes (as PCA9555 does on each byte acknowledge)
+			if (g_GPIO_Data_Phase)
+				GPIO_Write_Regs (Write_Buffer, NumOfByteUsed);
+			g_GPIO_Data_Phase = false;
+			break;
+		
+		case I2C_WR_ERROR: // PEC mismatch, bus error or time-out: drop the incomplete pair
+			g_GPIO_Data_Phase = false;
+			break;
+		
+		default:
+			LOG_ERROR (LOG_BAD_STATUS, Status);
+			break;
+	}
+	
+	return (ResponseType);
+}
+//--------------------------------------------------------------------------
@@ -0,0 +1,34 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _I2C_DEVICE_GPIO_H_
+#define _I2C_DEVICE_GPIO_H_
+
+// PCA9555 registers (command byte bits 2..0); registers are accessed in pairs (port 0 and port 1).
+#define GPIO_REG_INPUT0		0x00 // RO: pins state (after polarity inversion)
+#define GPIO_REG_INPUT1		0x01
+#define GPIO_REG_OUTPUT0	0x02 // RW: output value; default 0xFF
+#define GPIO_REG_OUTPUT1	0x03
+#define GPIO_REG_POLARITY0	0x04 // RW: 1: input register bit is inverted; default 0x00
+#define GPIO_REG_POLARITY1	0x05
+#define GPIO_REG_CONFIG0	0x06 // RW: 1: input; 0: output; default 0xFF
+#define GPIO_REG_CONFIG1	0x07
+#define GPIO_REGS			8
+
+// Port 0: RunBMC header GPI0..GPI7 (push-pull outputs; shared with the GPI and ADC devices). P0.6 and P0.7 are owned by the fan
+// device when FAN_DEVICE == 1; P0.4 and P0.5 by the console when CONSOLE_USART == 1 (not changed; read as 0).
+// Port 1: board signals (open-drain outputs with external pull-up; output 1 release the signal):
+#define GPIO_PORT1_CORST	0x01 // CORST# (PA2)
+#define GPIO_PORT1_PORST	0x02 // PORST# (PA1)
+#define GPIO_PORT1_FWSPI	0x04 // FWSPI_PWR_EN (PC4)
+#define GPIO_PORT1_PINS		(GPIO_PORT1_CORST | GPIO_PORT1_PORST | GPIO_PORT1_FWSPI) // other bits are stored only; read as 0
+
+extern void I2C_Device_GPIO_Init (uint8_t DeviceIndex);
+
+#endif
+
+
@@ -27,16 +27,21 @@
 #include <util/atomic.h>
 #include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
 #include <avr/eeprom.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include "CoreRegisters.h"
 #include "I2C_Slave.h"
+#include "I2C_Device_SRAM.h"
 #include "TimeStamp.h"
+#include "Trace.h"
+#define LOG_MODULE SRAM
+#include "Log.h"
 
 #define F_CPU 8000000UL  // 8 MHz
 #include <util/delay.h>
 
-static uint8_t Generic_SRAM [512]; // set to 512 or 256
+static uint8_t Generic_SRAM [I2C_DEVICE_SRAM_SIZE];
 
 #define WRITE_PHASE_ADDR 0
 #define WRITE_PHASE_DATA 1
@@ -50,7 +55,8 @@ static uint8_t I2C_Device_SRAM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 extern void I2C_Device_SRAM_Init (uint8_t DeviceIndex)
 {
 	g_Current_Addr = 0;
-	pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_SRAM_Func;
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_SRAM_Func;
 	printf_P (PSTR("> I2C_Device_SRAM_Init; register to I2C device index %u; \r\n"), DeviceIndex);
 }
 
@@ -69,7 +75,7 @@ static uint8_t I2C_Device_SRAM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 			*pBuffer = &Generic_SRAM[g_Current_Addr];
 			*MaxNumOfByte = MIN (sizeof (Generic_SRAM) - g_Current_Addr, 0x80);
 			
-			//printf_P (PSTR("> SRAM read: g_Current_Addr=0x%X, MaxNumOfByte=%u  \r\n"),g_Current_Addr, *MaxNumOfByte);
+			LOG_DEBUG (LOG_SRAM_READ, (uint8_t)g_Current_Addr);
 			
 			break;
 		
@@ -107,12 +113,12 @@ static uint8_t I2C_Device_SRAM_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,
 			*pBuffer = &Generic_SRAM[g_Current_Addr];
 			*MaxNumOfByte = MIN (sizeof (Generic_SRAM) - g_Current_Addr, 0x80);
 			
-			//printf_P (PSTR("> SRAM write: g_Current_Addr=0x%X, MaxNumOfByte=%u, NumOfByteUsed=%u \r\n"),g_Current_Addr, *MaxNumOfByte, NumOfByteUsed);
+			LOG_DEBUG (LOG_SRAM_WRITE, NumOfByteUsed);
 			
 			break;
 			
 		default:
-			printf_P (PSTR("> I2C_Device_SRAM_Func: *** ERROR *** Unknown status. \r\n"));
+			LOG_ERROR (LOG_BAD_STATUS, Status);
 			break;
 	}
 	
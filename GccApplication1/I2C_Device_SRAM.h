@@ -9,6 +9,10 @@
 #define _I2C_DEVICE_SRAM_H_
 
 
+#ifndef I2C_DEVICE_SRAM_SIZE
+#define I2C_DEVICE_SRAM_SIZE 256 // bytes; 512, 256 or 64 (512 does not fit with STACK_BUDGET; 64 with EEPROM_MIRROR; see the static data budget in Stack.h)
+#endif
+
 extern void I2C_Device_SRAM_Init (uint8_t DeviceIndex);
 
 
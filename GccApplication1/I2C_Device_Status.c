@@ -0,0 +1,165 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Virtual I2C module status device (SMBus block read)
+************************************************************************
+
+ Protocol (SMBus block read): 
+ <I2C Address + W> <Command> <I2C Address + R> <Byte Count> <Data 0> .... <Data n>
+ 
+ Read without command (or after stop) use the last command. Unknown command is NACK.
+ 
+ Commands (see snapshot layout in I2C_Device_Status.h):
+ * 0x00: all (32 bytes)
+ * 0x01: ADC channels (8 bytes)
+ * 0x02: GPI (2 bytes)
+ * 0x03: WD channels status (4 bytes)
+ * 0x04: newest event log entry (8 bytes)
+ * 0x05: counters and time base (10 bytes)
+ 
+ The snapshot is assembled every STATUS_REFRESH msec from main loop and the response is copied at read start, 
+ so one transaction return a consistent module status. 
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_ADC.h"
+#include "I2C_Device_GPI.h"
+#include "SystemTick.h"
+#include "EventLog.h"
+#include "BMC_WD.h"
+#include "I2C_Device_Status.h"
+#include "Trace.h"
+#define LOG_MODULE STATUS
+#include "Log.h"
+
+static const uint8_t Status_Cmd_Table [][2] PROGMEM = // {offset, size}
+{
+	{0, STATUS_SIZE},					// STATUS_CMD_ALL
+	{STATUS_ADC, 8},					// STATUS_CMD_ADC
+	{STATUS_GPI, 2},					// STATUS_CMD_GPI
+	{STATUS_WD, WD_CHANNELS},			// STATUS_CMD_WD
+	{STATUS_EVENT, EVENTLOG_DECODED_ENTRY_SIZE}, // STATUS_CMD_EVENT
+	{STATUS_I2C_RECOVERY, STATUS_SIZE - STATUS_I2C_RECOVERY}, // STATUS_CMD_COUNTERS
+};
+
+static uint8_t g_Snapshot [STATUS_SIZE];
+static uint8_t Read_Buffer [1 + STATUS_SIZE]; // byte count + data
+static uint8_t g_Cmd; 
+static uint8_t Write_Buffer; 
+static uint16_t g_Refresh_msec; // time base msec (low 16-bit) of the last refresh
+
+static uint8_t I2C_Device_Status_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed);
+
+//--------------------------------------------------------------------------
+extern void I2C_Device_Status_Init (uint8_t DeviceIndex)
+{
+	g_Cmd = STATUS_CMD_ALL;
+	memset ((void*)g_Snapshot, 0, sizeof(g_Snapshot));
+	g_Refresh_msec = (uint16_t)SystemTick_Get_msec () - STATUS_REFRESH; // refresh on first call
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_Status_Func;
+	printf_P (PSTR("> I2C_Device_Status_Init; register to I2C device index %u; \r\n"), DeviceIndex);
+}
+//--------------------------------------------------------------------------
+// Call from main loop. 
+extern void I2C_Device_Status_BackgroundTask (void)
+{
+	uint8_t Snapshot [STATUS_SIZE];
+	uint32_t Now = SystemTick_Get_msec ();
+	uint16_t Value;
+	uint8_t i;
+	
+	if ((uint16_t)((uint16_t)Now - g_Refresh_msec) < STATUS_REFRESH)
+		return;
+	g_Refresh_msec = (uint16_t)Now;
+	
+	for (i = 0; i < 8; i++)
+		Snapshot [STATUS_ADC + i] = I2C_Device_ADC_Sample (i);
+	
+	Value = GPI_Get_State ();
+	memcpy ((void*)&Snapshot[STATUS_GPI], (const void*)&Value, sizeof(Value));
+	
+	for (i = 0; i < WD_CHANNELS; i++)
+		WD_Read_Regs (WD_CHANNEL_ADDR + i*WD_REG_SIZE + WD_REG_STATUS, &Snapshot[STATUS_WD + i], 1);
+	
+	EventLog_Read_Decoded (0, &Snapshot[STATUS_EVENT], EVENTLOG_DECODED_ENTRY_SIZE);
+	
+	Value = I2C_Slave_Get_Recovery_Count ();
+	memcpy ((void*)&Snapshot[STATUS_I2C_RECOVERY], (const void*)&Value, sizeof(Value));
+	Value = I2C_Slave_Get_PEC_Error_Count ();
+	memcpy ((void*)&Snapshot[STATUS_PEC_ERROR], (const void*)&Value, sizeof(Value));
+	Snapshot [STATUS_EVENT_LOST] = EventLog_Get_Lost ();
+	Snapshot [STATUS_ALERT] = I2C_Slave_Get_Alert ();
+	Now = SystemTick_Get_msec ();
+	memcpy ((void*)&Snapshot[STATUS_UPTIME], (const void*)&Now, sizeof(Now));
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy ((void*)g_Snapshot, (const void*)Snapshot, sizeof(g_Snapshot));
+	}
+}
+//--------------------------------------------------------------------------
+static uint8_t I2C_Device_Status_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
+{
+	uint8_t ResponseType = I2C_ACK;
+	
+	switch (Status)
+	{
+		case I2C_RD_START: 
+			Read_Buffer [0] = pgm_read_byte (&Status_Cmd_Table[g_Cmd][1]);
+			memcpy ((void*)&Read_Buffer[1], (const void*)&g_Snapshot[pgm_read_byte (&Status_Cmd_Table[g_Cmd][0])], Read_Buffer [0]);
+			*pBuffer = Read_Buffer;
+			*MaxNumOfByte = 1 + Read_Buffer [0];
+			break;
+			
+		case I2C_RD_BUFF_EMPTY: // block is complete; master get 0xFF. 
+			*MaxNumOfByte = 0;
+			break;
+		
+		case I2C_RD_STOP:  //  nothing to do.
+		case I2C_RD_ERROR: //  we don't care about the error.
+			break;
+		
+		case I2C_WR_START:
+			*pBuffer = &Write_Buffer;
+			*MaxNumOfByte = sizeof (Write_Buffer);
+			break;
+			
+		case I2C_WR_BUFF_FULL: 
+			*MaxNumOfByte = 0; // no more bytes are allow 
+			if (Write_Buffer < sizeof(Status_Cmd_Table)/sizeof(Status_Cmd_Table[0]))
+				g_Cmd = Write_Buffer;
+			else
+				ResponseType = I2C_NACK; // unknown command
+			break;
+		
+		case I2C_WR_STOP:
+		case I2C_WR_ERROR: // we don't care about the error.
+			break;
+		
+		default:
+			LOG_ERROR (LOG_BAD_STATUS, Status);
+			break;
+	}
+	
+	return (ResponseType);
+}
+//--------------------------------------------------------------------------
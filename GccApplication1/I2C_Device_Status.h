@@ -0,0 +1,38 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _I2C_DEVICE_STATUS_H_
+#define _I2C_DEVICE_STATUS_H_
+
+// Module status snapshot (SMBus block read; see I2C_Device_Status.c)
+#define STATUS_ADC			0x00 // 0x00..0x07: ADC RunBMC channel 0..7 (single-ended, 8-bit)
+#define STATUS_GPI			0x08 // 0x08: GPI inputs; 0x09: GPI transitions since last GPI device read
+#define STATUS_WD			0x0A // 0x0A..0x0D: WD channel 0..3 status (see BMC_WD.h)
+#define STATUS_EVENT		0x0E // 0x0E..0x15: newest event log entry (see EventLog.h)
+#define STATUS_I2C_RECOVERY	0x16 // 0x16..0x17: I2C time-out recoveries
+#define STATUS_PEC_ERROR	0x18 // 0x18..0x19: I2C PEC errors
+#define STATUS_EVENT_LOST	0x1A // 0x1A: event log records lost 
+#define STATUS_ALERT		0x1B // 0x1B: pending alerts; bit per I2C device index
+#define STATUS_UPTIME		0x1C // 0x1C..0x1F: time base in msec
+#define STATUS_SIZE			0x20 // SMBus block max size is 32 bytes
+
+// command codes
+#define STATUS_CMD_ALL		0x00
+#define STATUS_CMD_ADC		0x01
+#define STATUS_CMD_GPI		0x02
+#define STATUS_CMD_WD		0x03
+#define STATUS_CMD_EVENT	0x04
+#define STATUS_CMD_COUNTERS	0x05
+
+#define STATUS_REFRESH		100 // msec
+
+extern void I2C_Device_Status_Init (uint8_t DeviceIndex);
+extern void I2C_Device_Status_BackgroundTask (void);
+
+#endif
+
+
@@ -0,0 +1,224 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ *************************************
+ Virtual I2C Temperature Sensor 
+ *************************************
+ 
+ Compatible to LM75 (and TMP75 in 9-bit resolution); register set in I2C_Device_Temp.h.
+ 
+ * Write: pointer byte, optionally followed by the register data (MSB first); the pointer remain for the next reads.
+ * Read: the register selected by the pointer; continues read repeat the same register.
+ * The ATtiny1634 internal temperature sensor is sampled every TEMP_PERIOD msec from main loop (see I2C_Device_ADC_Temp_Sample); 
+   the I2C device only copy the registers, so the master is never stretched by a conversion.
+ * Conversion use the typical sensor values (ATtiny1634 datasheet: 230 at -40 degC, 300 at +25 degC and 370 at +85 degC);
+   the sensor is not calibrated (up to +/-10 degC) and has 1 degC resolution.
+ * OS (alert) is reported on the shared INT# (see I2C_Slave_Alert):
+   comparator mode: asserted when temperature exceed Tos and released when it fall below Thyst. 
+   interrupt mode: asserted when temperature exceed Tos, and again when it fall below Thyst; released by any read of the device. 
+   A change of OS require the fault queue number of consecutive samples.
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_ADC.h"
+#include "I2C_Device_Temp.h"
+#include "SystemTick.h"
+#include "Trace.h"
+#define LOG_MODULE ADC
+#include "Log.h"
+
+#define TEMP_ADC_0C			272 // 10-bit ADC value at 0 degC (typical)
+#define TEMP_ADC_100C		112 // ADC LSB per 100 degC (typical)
+#define TEMP_MIN			(-55 * 2) // 0.5 degC
+#define TEMP_MAX			(125 * 2)
+
+static const uint8_t Temp_Fault_Queue [4] PROGMEM = {1, 2, 4, 6};
+
+static uint8_t g_Temp_Regs [4][2]; // MSB first, as sent to the master (read buffer); TEMP_REG_CONFIG in the first byte
+static uint8_t g_Temp_Pointer;
+static uint8_t Write_Buffer [3]; // pointer + 16-bit data
+static uint8_t g_Temp_DeviceIndex;
+static uint8_t g_Temp_Faults; // consecutive samples beyond the active threshold
+static bool g_Temp_Over; // above Tos (waiting for Thyst)
+static bool g_Temp_OS; // alert output
+static uint16_t g_Temp_Sample_msec; // time base msec (low 16-bit) of the last sample
+
+static uint8_t I2C_Device_Temp_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed);
+
+//--------------------------------------------------------------------------
+extern void I2C_Device_Temp_Init (uint8_t DeviceIndex)
+{
+	memset (g_Temp_Regs, 0, sizeof (g_Temp_Regs));
+	g_Temp_Regs [TEMP_REG_THYST][0] = 75; // degC
+	g_Temp_Regs [TEMP_REG_TOS][0] = 80;
+	g_Temp_Pointer = TEMP_REG_TEMP;
+	g_Temp_Faults = 0;
+	g_Temp_Over = false;
+	g_Temp_OS = false;
+	g_Temp_DeviceIndex = DeviceIndex;
+	g_Temp_Sample_msec = (uint16_t)SystemTick_Get_msec () - TEMP_PERIOD; // sample on first call
+	if (DeviceIndex < I2C_DEVICES) // otherwise, device is not enabled 
+		pI2C_Device_Func[DeviceIndex] = (I2C_DEVICE_FUNC) I2C_Device_Temp_Func;
+	printf_P (PSTR("> I2C_Device_Temp_Init; register to I2C device index %u; \r\n"), DeviceIndex);
+}
+//--------------------------------------------------------------------------
+// temperature format register value (LM75 format; bits 15..7)
+static int16_t I2C_Device_Temp_Reg (uint8_t Reg)
+{
+	return ((int16_t)((uint16_t)g_Temp_Regs [Reg][0] << 8 | g_Temp_Regs [Reg][1]));
+}
+//--------------------------------------------------------------------------
+// set OS output; interrupts are disabled.
+static void I2C_Device_Temp_OS (bool OS)
+{
+	if (OS == g_Temp_OS)
+		return;
+	
+	g_Temp_OS = OS;
+	I2C_Slave_Alert (g_Temp_DeviceIndex, OS);
+	LOG_DEBUG (LOG_ADC_TEMP_ALERT, OS);
+}
+//--------------------------------------------------------------------------
+// new sample; interrupts are disabled.
+static void I2C_Device_Temp_Update (int16_t Temp /*LM75 format*/)
+{
+	uint8_t Config = g_Temp_Regs [TEMP_REG_CONFIG][0];
+	bool Fault;
+	
+	g_Temp_Regs [TEMP_REG_TEMP][0] = (uint8_t)((uint16_t)Temp >> 8);
+	g_Temp_Regs [TEMP_REG_TEMP][1] = (uint8_t)Temp;
+	
+	if (g_Temp_Over)
+		Fault = (Temp < I2C_Device_Temp_Reg (TEMP_REG_THYST));
+	else
+		Fault = (Temp > I2C_Device_Temp_Reg (TEMP_REG_TOS));
+	
+	if (Fault == false)
+	{
+		g_Temp_Faults = 0;
+		return;
+	}
+	
+	g_Temp_Faults++;
+	if (g_Temp_Faults < pgm_read_byte (&Temp_Fault_Queue [(Config & TEMP_CONFIG_FAULT) >> 3]))
+		return;
+	
+	g_Temp_Faults = 0;
+	g_Temp_Over = ! g_Temp_Over;
+	if (Config & TEMP_CONFIG_INT)
+		I2C_Device_Temp_OS (true); // released by read
+	else
+		I2C_Device_Temp_OS (g_Temp_Over);
+}
+//--------------------------------------------------------------------------
+// Call from main loop. 
+extern void I2C_Device_Temp_BackgroundTask (void)
+{
+	uint16_t Value;
+	int16_t Temp;
+	
+	if (g_Temp_DeviceIndex >= I2C_DEVICES)
+		return; // device is not enabled; keep the ADC for the other users
+	if (g_Temp_Regs [TEMP_REG_CONFIG][0] & TEMP_CONFIG_SHUTDOWN)
+		return;
+	if ((uint16_t)((uint16_t)SystemTick_Get_msec () - g_Temp_Sample_msec) < TEMP_PERIOD)
+		return;
+	if (I2C_Device_ADC_Temp_Sample (&Value) == false)
+		return; // settling or converting
+	
+	g_Temp_Sample_msec = (uint16_t)SystemTick_Get_msec ();
+	
+	Temp = (int16_t)(((int32_t)Value - TEMP_ADC_0C) * 200 / TEMP_ADC_100C); // 0.5 degC
+	if (Temp < TEMP_MIN)
+		Temp = TEMP_MIN;
+	if (Temp > TEMP_MAX)
+		Temp = TEMP_MAX;
+	LOG_DEBUG (LOG_ADC_TEMP, (uint8_t)(Temp / 2));
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // registers and alert state are shared with the I2C device
+	{
+		I2C_Device_Temp_Update ((int16_t)((uint16_t)Temp << 7));
+	}
+}
+//--------------------------------------------------------------------------
+static uint8_t I2C_Device_Temp_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
+{
+	uint8_t ResponseType = I2C_ACK;
+	uint8_t Config = g_Temp_Regs [TEMP_REG_CONFIG][0];
+	
+	switch (Status)
+	{
+		case I2C_RD_START: 
+			if (Config & TEMP_CONFIG_INT)
+				I2C_Device_Temp_OS (false); // any read release the alert in interrupt mode
+			// fall through
+		case I2C_RD_BUFF_EMPTY: // continues read repeat the same register
+			*pBuffer = g_Temp_Regs [g_Temp_Pointer];
+			*MaxNumOfByte = (g_Temp_Pointer == TEMP_REG_CONFIG) ? 1 : 2;
+			break;
+		
+		case I2C_RD_STOP:  //  nothing to do.
+		case I2C_RD_ERROR: //  we don't care about the error.
+			break;
+		
+		case I2C_WR_START:
+			*pBuffer = Write_Buffer;
+			*MaxNumOfByte = sizeof (Write_Buffer);
+			break;
+			
+		case I2C_WR_ERROR: // PEC mismatch, bus error or time-out: drop the pointer and register data
+			break;
+			
+		case I2C_WR_BUFF_FULL: 
+			if (*MaxNumOfByte == 0)
+			{
+				ResponseType = I2C_NACK; // byte beyond the register data
+				break;
+			}
+			*MaxNumOfByte = 0; // no more bytes are allow 
+			// continue parse the register data (stop is reported with no bytes). 
+			// fall through
+		
+		case I2C_WR_STOP:
+			if (NumOfByteUsed >= 1)
+				g_Temp_Pointer = Write_Buffer [0] & 0x03;
+			
+			if ( (g_Temp_Pointer == TEMP_REG_CONFIG) && (NumOfByteUsed >= 2) )
+			{
+				g_Temp_Regs [TEMP_REG_CONFIG][0] = Write_Buffer [1];
+				g_Temp_Faults = 0; // alert is evaluated again from the next sample 
+				g_Temp_Over = false;
+				I2C_Device_Temp_OS (false);
+			}
+			else if ( (g_Temp_Pointer >= TEMP_REG_THYST) && (NumOfByteUsed == 3) )
+			{
+				g_Temp_Regs [g_Temp_Pointer][0] = Write_Buffer [1];
+				g_Temp_Regs [g_Temp_Pointer][1] = Write_Buffer [2] & 0x80;
+			}
+			break;
+		
+		default:
+			LOG_ERROR (LOG_BAD_STATUS, Status);
+			break;
+	}
+	
+	return (ResponseType);
+}
+//--------------------------------------------------------------------------
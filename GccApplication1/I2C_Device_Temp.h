@@ -0,0 +1,29 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _I2C_DEVICE_TEMP_H_
+#define _I2C_DEVICE_TEMP_H_
+
+// LM75 registers (pointer register bits 1..0)
+#define TEMP_REG_TEMP		0x00 // RO: temperature; 16-bit, MSB first; bits 15..7: two's complement in 0.5 degC.
+#define TEMP_REG_CONFIG		0x01 // RW: configuration (TEMP_CONFIG_*).
+#define TEMP_REG_THYST		0x02 // RW: hysteresis; same format as temperature; default 75 degC.
+#define TEMP_REG_TOS		0x03 // RW: over-temperature shutdown; same format as temperature; default 80 degC.
+
+#define TEMP_CONFIG_SHUTDOWN	0x01 // stop sampling (temperature keep the last value)
+#define TEMP_CONFIG_INT			0x02 // 0: comparator mode; 1: interrupt mode (alert cleared by any read)
+#define TEMP_CONFIG_POLARITY	0x04 // stored only; INT# is shared and always active low
+#define TEMP_CONFIG_FAULT		0x18 // fault queue: 1, 2, 4 or 6 consecutive samples beyond the threshold
+
+#define TEMP_PERIOD			100 // msec between samples
+
+extern void I2C_Device_Temp_Init (uint8_t DeviceIndex);
+extern void I2C_Device_Temp_BackgroundTask (void);
+
+#endif
+
+
@@ -12,57 +12,629 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <util/crc16.h>
 #include "CoreRegisters.h"
 #include "I2C_Slave.h"
+#include "Trace.h"
+#include "SystemTick.h"
+#include "Profile.h"
+#include "Seqlock.h"
+#define LOG_MODULE I2C
+#include "Log.h"
 
-static uint8_t g_DeviceIndex;
-static uint8_t g_ActualByteCount;
-static uint8_t g_MaxByteCount;
-static uint8_t g_Status;
-static uint8_t *g_pBuffer;
+// PEC state
+#define PEC_ACTIVE	0x01 // PEC is enabled for the current device
+#define PEC_VALID	0x02 // write: the last byte received match the CRC of all bytes before it (the PEC, if stop follows)
+#define PEC_DATA	0x08 // read: data was sent
+#define PEC_SENT	0x10 // read: PEC was sent
 
-static volatile uint32_t I2C_TimeOut = 0;
-I2C_DEVICE_FUNC pI2C_Device_Func [4]  = {NULL, NULL, NULL, NULL};
+// Per bus transaction state.
+// The transaction engine (I2C_Bus_xxx) is independent of the slave hardware; the bus interrupt translate the hardware
+// events (start, stop, data, error) to engine calls.
+typedef struct
+{
+	I2C_DEVICE_FUNC pDevice_Func; // device of current transaction
+	uint8_t *pBuffer;
+	uint8_t DeviceIndex;
+	uint8_t ActualByteCount;
+	uint8_t MaxByteCount;
+	uint8_t Status;
+	bool InTransaction; // start was detected and stop was not
+	volatile uint8_t TimeOut; // msec; remaining time to time-out
+	uint8_t PEC_State;
+	uint8_t PEC; // CRC of all bytes of current transaction
+	uint8_t PEC_Count; // write: number of bytes in PEC_Stage
+	uint8_t PEC_Stage [I2C_PEC_STAGE]; // write: received bytes until the PEC is verified
+} I2C_BUS;
+
+static I2C_BUS g_TWI_Bus; // TWI slave module
+static uint8_t g_BaseAddr;
+static uint8_t g_AddrMask; // addresses claimed - 1 (TWSAM)
+
+static uint8_t g_Alert; // bit per device index
+static uint8_t g_Alert_Reported; // alerts reported by ARA
+static uint8_t g_ARA_Index;
+static uint8_t g_ARA_Data;
+
+static uint8_t g_I2C_TimeOut_Cfg = I2C_TIME_OUT; // msec
+static uint16_t g_Recovery_Count;
+static uint16_t g_Stuck_Count;
+
+static uint8_t g_PEC_Enable; // bit per device index
+static uint16_t g_PEC_Error_Count;
+static SEQLOCK g_Count_Seq; // recovery, stuck and PEC error counters update (see Seqlock.h)
+
+#if (I2C_PEC_TABLE == 1)
+static const uint8_t PEC_Table [256] PROGMEM = 
+{
+	0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+	0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+	0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+	0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+	0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+	0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+	0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+	0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+	0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+	0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+	0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+	0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+	0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+	0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+	0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+	0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+#define PEC_UPDATE(crc, data)	pgm_read_byte (&PEC_Table[(uint8_t)((crc) ^ (data))])
+#else
+#define PEC_UPDATE(crc, data)	_crc8_ccitt_update ((crc), (data))
+#endif
+
+#define F_CPU 8000000UL  // 8 MHz
+#include <util/delay.h>
+
+I2C_DEVICE_FUNC pI2C_Device_Func [I2C_DEVICES]; // default is NULL (not emulated; address is NACK)
 
 //---------------------------------------------------------------------------------------------
-extern void I2C_Slave_Init (uint8_t BaseAddr)
+extern void I2C_Slave_Init (uint8_t BaseAddr, uint8_t Devices)
 {
+	// INT# 
+	// we assume external PU exist on INT# so no glitch will appear now.
+	g_Alert = 0;
+	g_Alert_Reported = 0;
+	SET_BIT_REG (PORTB,PB2); // Set PB2 high (disable interrupt)
+	SET_BIT_REG (DDRB,PB2); // Set PB2 output (Push-Pull)
+	
 	//  TWI module Init
+	g_BaseAddr = BaseAddr;
+	g_AddrMask = Devices - 1;
 	CLEAR_BIT_REG (TWSCRA, TWEN);   // Disable TWI
 	CLEAR_BIT_REG (PRR, PRTWI); // disable Power Reduction Two-Wire Interface, if any. 
 	WRITE_REG (TWSA,  BaseAddr<<1 | 0); // Set Slave addresses; and disable general call address recognition
-	WRITE_REG (TWSAM, 0x03<<1 | 0); // set address mask to emulate x4 I2c devices;
+	WRITE_REG (TWSAM, g_AddrMask<<1 | 0); // set address mask to emulate Devices I2c devices;
 	SET_BIT_REG (TWSCRA, TWDIE);   // Enable Interrupt when TWSSRA.TWDIF flag is set (Data).
 	SET_BIT_REG (TWSCRA, TWASIE);  // Enable Interrupt when TWSSRA.TWASIFflag is set (Address match; Stop condition if TWSIE is set).
 	SET_BIT_REG (TWSCRA, TWSIE);   // Enable the stop condition detector to set TWSSRA.TWASIF flag.
 	CLEAR_BIT_REG (TWSCRA, TWPME); // Disable Promiscuous Mode (software address match); use TWSA register to determine which address to recognize.
 	CLEAR_BIT_REG (TWSCRA, TWSME); // Disable Auto Acknowledge on buffer read (Smart Mode).
-	I2C_TimeOut = 0;
-	g_ActualByteCount = 0;
-	g_DeviceIndex = 0;
+	memset (&g_TWI_Bus, 0, sizeof (g_TWI_Bus));
+	g_Recovery_Count = 0;
+	g_Stuck_Count = 0;
+	g_PEC_Error_Count = 0;
 	SET_BIT_REG (TWSCRA, TWEN);   // Enable TWI
-	printf_P (PSTR("> I2C slave module Init. Slave base address: 0x%x; Emulate x4 I2C devices. \r\n"), BaseAddr);
+	printf_P (PSTR("> I2C slave module Init. Slave base address: 0x%x; Emulate x%u I2C devices. \r\n"), BaseAddr, Devices);
 }
 //---------------------------------------------------------------------------------------------
-extern void I2C_Slave_PeriodicTask (uint32_t ElapsedTime /*msec*/)
+extern void I2C_Slave_Set_TimeOut (uint8_t TimeOut /*msec; 0: disable*/)
+{
+	g_I2C_TimeOut_Cfg = TimeOut;
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t I2C_Slave_Get_TimeOut (void)
+{
+	return (g_I2C_TimeOut_Cfg);
+}
+//---------------------------------------------------------------------------------------------
+extern uint16_t I2C_Slave_Get_Recovery_Count (void)
+{
+	uint16_t Count;
+	uint8_t Seq;
+	do
+	{
+		Seq = SEQLOCK_READ_BEGIN (g_Count_Seq);
+		Count = g_Recovery_Count;
+	} while (SEQLOCK_READ_RETRY (g_Count_Seq, Seq));
+	return (Count);
+}
+//---------------------------------------------------------------------------------------------
+extern uint16_t I2C_Slave_Get_Stuck_Count (void)
+{
+	uint16_t Count;
+	uint8_t Seq;
+	do
+	{
+		Seq = SEQLOCK_READ_BEGIN (g_Count_Seq);
+		Count = g_Stuck_Count;
+	} while (SEQLOCK_READ_RETRY (g_Count_Seq, Seq));
+	return (Count);
+}
+//---------------------------------------------------------------------------------------------
+extern void I2C_Slave_Set_PEC (uint8_t DeviceMask /*bit per device index*/)
+{
+	g_PEC_Enable = DeviceMask;
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t I2C_Slave_Get_PEC (void)
+{
+	return (g_PEC_Enable);
+}
+//---------------------------------------------------------------------------------------------
+extern uint16_t I2C_Slave_Get_PEC_Error_Count (void)
 {
+	uint16_t Count;
+	uint8_t Seq;
+	do
+	{
+		Seq = SEQLOCK_READ_BEGIN (g_Count_Seq);
+		Count = g_PEC_Error_Count;
+	} while (SEQLOCK_READ_RETRY (g_Count_Seq, Seq));
+	return (Count);
+}
+//---------------------------------------------------------------------------------------------
+static void I2C_Slave_Alert_Update (void)
+{
+	if (g_Alert & ~g_Alert_Reported)
+	{
+		CLEAR_BIT_REG (PORTB, PB2); // Set PB2 low to issue interrupt to host
+		SET_BIT_REG (TWSCRA, TWPME); // software address match; answer ARA
+	}
+	else
+	{
+		SET_BIT_REG (PORTB, PB2); // Set PB2 high (disable interrupt)
+		CLEAR_BIT_REG (TWSCRA, TWPME); // use TWSA/TWSAM address match
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern void I2C_Slave_Alert (uint8_t DeviceIndex, bool Assert)
+{
+	uint8_t Mask = 1<<DeviceIndex;
+	
+	if (DeviceIndex >= I2C_DEVICES)
+		return; // device is not enabled
+	
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		if (I2C_TimeOut != 0)
+		if (Assert)
+			g_Alert |= Mask;
+		else
 		{
-			if (I2C_TimeOut > ElapsedTime)
-				I2C_TimeOut -= ElapsedTime;
-			else
+			g_Alert &= ~Mask;
+			g_Alert_Reported &= ~Mask;
+		}
+		I2C_Slave_Alert_Update ();
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t I2C_Slave_Get_Alert (void)
+{
+	return (g_Alert & ~g_Alert_Reported);
+}
+//---------------------------------------------------------------------------------------------
+// Alert Response Address (ARA); read only; return address of the alerting device with the lowest address.
+// If other device on the bus win the arbitration (lower address), the collision end the transaction with I2C_RD_ERROR and the alert is kept.
+static uint8_t I2C_Slave_ARA_Func (uint8_t Status, /*out*/ uint8_t **pBuffer,  /*out*/ uint8_t *MaxNumOfByte, uint8_t NumOfByteUsed)
+{
+	uint8_t ResponseType = I2C_ACK;
+	uint8_t Pending = g_Alert & ~g_Alert_Reported;
+	
+	switch (Status)
+	{
+		case I2C_RD_START:
+			if (Pending == 0)
 			{
-				I2C_TimeOut = 0;
-				printf_P (PSTR("> I2C Timeout. Restart I2C slave module.  \r\n"));
-				CLEAR_BIT_REG (TWSCRA, TWEN); // Disable TWI
-				SET_BIT_REG (TWSCRA, TWEN);   // Enable TWI
+				ResponseType = I2C_NACK;
+				break;
 			}
+			for (g_ARA_Index = 0; (Pending & (1<<g_ARA_Index)) == 0; g_ARA_Index++);
+			g_ARA_Data = (g_BaseAddr + g_ARA_Index) << 1;
+			*pBuffer = &g_ARA_Data;
+			*MaxNumOfByte = sizeof (g_ARA_Data);
+			break;
+			
+		case I2C_RD_BUFF_EMPTY:
+			*MaxNumOfByte = 0;
+			break;
+			
+		case I2C_RD_STOP:
+			if (NumOfByteUsed != 0)
+			{
+				g_Alert_Reported |= 1<<g_ARA_Index;
+				I2C_Slave_Alert_Update ();
+			}
+			break;
+			
+		case I2C_WR_START:
+			ResponseType = I2C_NACK;
+			break;
+		
+		default:
+			break;
+	}
+	
+	return (ResponseType);
+}
+//---------------------------------------------------------------------------------------------
+// Master write: store a byte in the device buffer; return response type for the byte (I2C_NACK or I2C_ACK).
+static uint8_t I2C_Bus_Store (I2C_BUS *pBus, uint8_t Data)
+{
+	uint8_t ResponseType;
+
+	if (pBus->ActualByteCount >= pBus->MaxByteCount)
+	{
+		ResponseType = I2C_NACK;  // Send 'NACK' on the next action
+	}
+	else
+	{
+		ResponseType = I2C_ACK; // Send 'ACK' on the next action
+		*pBus->pBuffer = Data;
+		pBus->ActualByteCount++;
+		pBus->pBuffer++;
+	}
+
+	if ( (pBus->ActualByteCount >= pBus->MaxByteCount) && (pBus->pDevice_Func != NULL) )
+	{
+		// request the device to allocate a new write buffer;
+		// device return response type (NACK or ACK) for this cycle.
+		ResponseType = pBus->pDevice_Func (I2C_WR_BUFF_FULL, &pBus->pBuffer, &pBus->MaxByteCount, pBus->ActualByteCount);
+		pBus->ActualByteCount = 0;
+	}
+
+	return (ResponseType);
+}
+//---------------------------------------------------------------------------------------------
+// PEC write: deliver the first Count staged bytes to the device. Bytes after a NACK are dropped (the device refused them).
+static void I2C_Bus_PEC_Deliver (I2C_BUS *pBus, uint8_t Count)
+{
+	uint8_t i;
+
+	for (i = 0; i < Count; i++)
+	{
+		if (I2C_Bus_Store (pBus, pBus->PEC_Stage [i]) == I2C_NACK)
+			break;
+	}
+	pBus->PEC_Count = 0;
+}
+//---------------------------------------------------------------------------------------------
+// PEC write: byte received; return response type for the byte (I2C_NACK or I2C_ACK).
+// Bytes are staged on the bus and delivered only on stop, once the last byte is confirmed as the PEC, so a device never 
+// sees a byte of a write that fail the PEC check (a data byte that happen to match the running CRC is not the PEC). 
+static uint8_t I2C_Bus_PEC_Receive (I2C_BUS *pBus, uint8_t Data)
+{
+	bool Valid = (Data == pBus->PEC);
+
+	pBus->PEC = PEC_UPDATE (pBus->PEC, Data);
+	pBus->PEC_State &= ~PEC_VALID;
+
+	if (pBus->PEC_Count >= sizeof (pBus->PEC_Stage))
+		return (I2C_NACK); // write is too long for PEC
+
+	pBus->PEC_Stage [pBus->PEC_Count++] = Data;
+	if (Valid)
+		pBus->PEC_State |= PEC_VALID;
+	return (I2C_ACK);
+}
+//---------------------------------------------------------------------------------------------
+// PEC write: stop detected; the last byte is the PEC. Valid: the bytes before it are delivered and the device get 
+// I2C_WR_STOP; otherwise the device get I2C_WR_ERROR with no data.
+static void I2C_Bus_PEC_Stop (I2C_BUS *pBus)
+{
+	if (pBus->pDevice_Func == NULL)
+		return;
+
+	if (pBus->PEC_Count == 0)
+	{ // no data (e.g., quick command); no PEC
+		pBus->pDevice_Func (I2C_WR_STOP, NULL, NULL, 0);
+		return;
+	}
+
+	if ((pBus->PEC_State & PEC_VALID) == 0)
+	{
+		g_PEC_Error_Count++;
+		SEQLOCK_WRITE (g_Count_Seq);
+		Trace_Add (TRACE_TWI_PEC_ERROR, pBus->DeviceIndex);
+		pBus->pDevice_Func (I2C_WR_ERROR, NULL, NULL, 0);
+		return;
+	}
+
+	I2C_Bus_PEC_Deliver (pBus, pBus->PEC_Count - 1);
+	pBus->pDevice_Func (I2C_WR_STOP, NULL, NULL, pBus->ActualByteCount);
+}
+//---------------------------------------------------------------------------------------------
+// Bus error or time-out: end the open transaction.
+static void I2C_Bus_Error (I2C_BUS *pBus)
+{
+	if (pBus->pDevice_Func != NULL)
+		pBus->pDevice_Func (pBus->Status|I2C_ERROR, NULL, NULL, pBus->ActualByteCount);
+	pBus->TimeOut = 0;
+	pBus->ActualByteCount = 0;
+	pBus->MaxByteCount = 0;
+	pBus->PEC_State = 0;
+	pBus->InTransaction = false;
+}
+//---------------------------------------------------------------------------------------------
+// Start or re-start detected; AddrByte is the received address byte (address and direction).
+// return: response type for the address byte (I2C_NACK or I2C_ACK).
+static uint8_t I2C_Bus_Start (I2C_BUS *pBus, uint8_t AddrByte)
+{
+	if ( (pBus->PEC_State & PEC_ACTIVE) && (pBus->Status == I2C_WR) )
+		I2C_Bus_PEC_Deliver (pBus, pBus->PEC_Count); // write part of combined transaction has no PEC
+
+	if (pBus->InTransaction)
+	{// star detected (re-start transaction w/o exec stop); also when the last buffer is empty (e.g., re-start on buffer boundary)
+		if (pBus->pDevice_Func != NULL)
+			pBus->pDevice_Func (pBus->Status|I2C_STOP, NULL, NULL, pBus->ActualByteCount);  // end any open transaction before start a new one.
+	}
+
+	if (pBus->InTransaction == false)
+		pBus->PEC = 0; // PEC of re-start transaction include the previous part
+	pBus->PEC = PEC_UPDATE (pBus->PEC, AddrByte); // address byte
+	pBus->InTransaction = true;
+
+	pBus->DeviceIndex = (AddrByte>>1) & g_AddrMask;
+	pBus->pDevice_Func = pI2C_Device_Func[pBus->DeviceIndex];
+	if ( ((AddrByte>>1) & ~g_AddrMask) != g_BaseAddr )
+	{ // software address match (promiscuous mode)
+		pBus->DeviceIndex = I2C_DEVICES; // PEC is not enabled
+		pBus->pDevice_Func = ((AddrByte>>1) == I2C_ARA_ADDR) ? (I2C_DEVICE_FUNC) I2C_Slave_ARA_Func : NULL;
+	}
+	pBus->PEC_State = (g_PEC_Enable & (1<<pBus->DeviceIndex)) ? PEC_ACTIVE : 0;
+	pBus->PEC_Count = 0;
+	pBus->TimeOut = g_I2C_TimeOut_Cfg;
+	pBus->ActualByteCount = 0;
+	pBus->MaxByteCount = 0;
+	pBus->Status = AddrByte & I2C_RD; // 1:I2C_RD; 0:I2C_WR
+
+	if (pBus->pDevice_Func != NULL)
+		return (pBus->pDevice_Func (pBus->Status|I2C_START, &pBus->pBuffer, &pBus->MaxByteCount, 0));
+
+	return (I2C_NACK);  // Send 'NACK' response for address match
+}
+//---------------------------------------------------------------------------------------------
+// Stop detected.
+static void I2C_Bus_Stop (I2C_BUS *pBus)
+{
+	if ( (pBus->PEC_State & PEC_ACTIVE) && (pBus->Status == I2C_WR) )
+		I2C_Bus_PEC_Stop (pBus);
+	else if (pBus->pDevice_Func != NULL)
+		pBus->pDevice_Func (pBus->Status|I2C_STOP, NULL, NULL, pBus->ActualByteCount);
+	pBus->TimeOut = 0;
+	pBus->ActualByteCount = 0;
+	pBus->PEC_State = 0;
+	pBus->InTransaction = false;
+}
+//---------------------------------------------------------------------------------------------
+// Master read: return the next byte to send. MasterNack: master NACK the previous byte.
+static uint8_t I2C_Bus_Read (I2C_BUS *pBus, bool MasterNack)
+{
+	uint8_t Data = 0xFF; // send 'FF' to master when there is no data.
+
+	pBus->TimeOut = g_I2C_TimeOut_Cfg;
+
+	if ( (MasterNack) && (pBus->ActualByteCount>0) )  // master action is valid from the second byte interrupt
+	{
+		// when master NACK the previous data, do not reload I2C buffer with a new data since master stop reading.
+		return (Data); // send 'FF' to master it master continue to read after it's own NACK.
+	}
+
+	// The first read buffer allocation can be done on I2C_START state or on I2C_BUFF.
+	// When I2C_BUFF event is send to device emulation, this means the I2C module sent MaxByteCount to the master.
+
+	// With PEC, the read is limited to one buffer followed by the PEC byte.
+	if ( (pBus->ActualByteCount >= pBus->MaxByteCount) && (pBus->pDevice_Func != NULL) && ((pBus->PEC_State & PEC_DATA) == 0) )
+	{
+		// request the device to allocate a read buffer
+		pBus->pDevice_Func (I2C_RD_BUFF_EMPTY, &pBus->pBuffer, &pBus->MaxByteCount, pBus->ActualByteCount);
+		pBus->ActualByteCount = 0;
+	}
+
+	if (pBus->ActualByteCount >= pBus->MaxByteCount)
+	{
+		// no more data to send to master.
+		if ( (pBus->PEC_State & (PEC_DATA | PEC_SENT)) == PEC_DATA )
+		{
+			Data = pBus->PEC; // send PEC to master.
+			pBus->PEC_State |= PEC_SENT;
+		}
+	}
+	else
+	{
+		// reload byte to send to master
+		Data = *pBus->pBuffer;
+		if (pBus->PEC_State & PEC_ACTIVE)
+		{
+			pBus->PEC = PEC_UPDATE (pBus->PEC, Data);
+			pBus->PEC_State |= PEC_DATA;
 		}
+		pBus->ActualByteCount++;
+		pBus->pBuffer++;
 	}
+
+	return (Data);
 }
 //---------------------------------------------------------------------------------------------
+// Master write: byte received; return response type for the byte (I2C_NACK or I2C_ACK).
+static uint8_t I2C_Bus_Write (I2C_BUS *pBus, uint8_t Data)
+{
+	pBus->TimeOut = g_I2C_TimeOut_Cfg;
+
+	// The first write buffer allocation *MUST* be done in I2C_WR_START state.
+	// When I2C_WR_BUFF_FULL event is send to device emulation, this means the I2C module received MaxByteCount from the master and hold the bus before sending the action for this last byte.
+	// e.g., when MaxByteCount is 3, the I2C_WR_BUFF_FULL event occur after receiving 3 bytes from the master and just before sending the response. The emulate device can ACK or NACK the third byte.
+
+	if (pBus->PEC_State & PEC_ACTIVE)
+		return (I2C_Bus_PEC_Receive (pBus, Data));
+
+	return (I2C_Bus_Store (pBus, Data));
+}
+//---------------------------------------------------------------------------------------------
+// return true when the open transaction is timed-out; the transaction is ended with I2C_ERROR.
+static bool I2C_Bus_TimeOut (I2C_BUS *pBus, uint32_t ElapsedTime /*msec*/)
+{
+	if (pBus->TimeOut == 0)
+		return (false);
+
+	if (pBus->TimeOut > ElapsedTime)
+	{
+		pBus->TimeOut -= ElapsedTime;
+		return (false);
+	}
+
+	Trace_Add (TRACE_TWI_TIMEOUT, pBus->DeviceIndex);
+	I2C_Bus_Error (pBus);
+	return (true);
+}
+//---------------------------------------------------------------------------------------------
+// SDA (PB1) and SCL (PC1) are open drain; drive low by output direction (PORT is 0) and release by input direction (external PU).
+static void I2C_Slave_Bus_Recovery (void)
+{
+	uint8_t i;
+	
+	CLEAR_BIT_REG (TWSCRA, TWEN); // Disable TWI; release SDA and SCL if held by the slave module.
+	_delay_us (5);
+	
+	if (IS_BIT_SET (PINB, PB1))
+		return; // SDA is released 
+	
+	// SDA is held low by other device; clock it out (up to 9 clocks) and issue a stop condition.
+	g_Stuck_Count++;
+	SEQLOCK_WRITE (g_Count_Seq);
+	CLEAR_BIT_REG (PORTB, PB1);
+	CLEAR_BIT_REG (PORTC, PC1);
+	for (i = 0; (i < I2C_RECOVERY_CLOCKS) && (IS_BIT_SET (PINB, PB1) == 0); i++)
+	{
+		SET_BIT_REG (DDRC, PC1); // SCL low
+		_delay_us (5);
+		CLEAR_BIT_REG (DDRC, PC1); // SCL high
+		_delay_us (5);
+	}
+	
+	// stop condition: SDA low to high while SCL is high.
+	SET_BIT_REG (DDRC, PC1); // SCL low
+	_delay_us (5);
+	SET_BIT_REG (DDRB, PB1); // SDA low
+	_delay_us (5);
+	CLEAR_BIT_REG (DDRC, PC1); // SCL high
+	_delay_us (5);
+	CLEAR_BIT_REG (DDRB, PB1); // SDA high
+	_delay_us (5);
+	
+	Trace_Add (TRACE_TWI_RECOVERY, i);
+}
+//---------------------------------------------------------------------------------------------
+extern void I2C_Slave_PeriodicTask (uint32_t ElapsedTime /*msec*/)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (I2C_Bus_TimeOut (&g_TWI_Bus, ElapsedTime))
+		{
+			g_Recovery_Count++;
+			SEQLOCK_WRITE (g_Count_Seq);
+			I2C_Slave_Bus_Recovery ();
+			SET_BIT_REG (TWSCRA, TWEN);   // Enable TWI
+		}
+	}
+}
+//---------------------------------------------------------------------------------------------
+#if (I2C_SELF_TEST == 1)
+static I2C_BUS g_Sim_Bus; // simulated master
+
+extern void I2C_Sim_Begin (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		CLEAR_BIT_REG (TWSCRA, TWEN); // Disable TWI
+		if (g_TWI_Bus.InTransaction)
+			I2C_Bus_Error (&g_TWI_Bus);
+		memset (&g_Sim_Bus, 0, sizeof (g_Sim_Bus));
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern void I2C_Sim_End (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (g_Sim_Bus.InTransaction)
+			I2C_Bus_Error (&g_Sim_Bus);
+		SET_BIT_REG (TWSCRA, TWEN); // Enable TWI
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t I2C_Sim_Start (uint8_t AddrByte)
+{
+	uint8_t ResponseType;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ResponseType = I2C_Bus_Start (&g_Sim_Bus, AddrByte);
+	}
+	return (ResponseType);
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t I2C_Sim_Write (uint8_t Data)
+{
+	uint8_t ResponseType;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ResponseType = I2C_Bus_Write (&g_Sim_Bus, Data);
+	}
+	return (ResponseType);
+}
+//---------------------------------------------------------------------------------------------
+extern uint8_t I2C_Sim_Read (bool MasterNack)
+{
+	uint8_t Data;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Data = I2C_Bus_Read (&g_Sim_Bus, MasterNack);
+	}
+	return (Data);
+}
+//---------------------------------------------------------------------------------------------
+extern void I2C_Sim_Stop (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		I2C_Bus_Stop (&g_Sim_Bus);
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern void I2C_Sim_Error (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		I2C_Bus_Error (&g_Sim_Bus);
+	}
+}
+//---------------------------------------------------------------------------------------------
+extern bool I2C_Sim_TimeOut (uint32_t ElapsedTime /*msec*/)
+{
+	bool TimeOut;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TimeOut = I2C_Bus_TimeOut (&g_Sim_Bus, ElapsedTime);
+	}
+	return (TimeOut);
+}
+//---------------------------------------------------------------------------------------------
+extern bool I2C_Sim_Check (void)
+{
+	bool Pass;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Pass = (g_Sim_Bus.ActualByteCount <= g_Sim_Bus.MaxByteCount) && ( (g_Sim_Bus.MaxByteCount == 0) || (g_Sim_Bus.pBuffer != NULL) );
+	}
+	return (Pass);
+}
+//---------------------------------------------------------------------------------------------
+#endif
 
 
 ISR(TWI_SLAVE_vect, ISR_BLOCK)
@@ -70,54 +642,30 @@ ISR(TWI_SLAVE_vect, ISR_BLOCK)
 	uint8_t reg_TWSSRA = TWSSRA;
 	uint8_t reg_TWSD = TWSD;
 	uint8_t l_TWAA;
-	
-	//printf_P (PSTR("> I2C Interrupt: (TWSSRA:0x%x); "), reg_TWSSRA);
-	
+	PROFILE_BEGIN (PROFILE_TWI);
+
+	LOG_DEBUG (LOG_I2C_INTERRUPT, reg_TWSSRA);
+
 	//----------------------------------------------------------------------------
 	if (IS_BIT_SET(reg_TWSSRA, TWASIF))
 	{
-		//printf_P (PSTR("TWASIF; "));
 		if ( (IS_BIT_SET(reg_TWSSRA, TWC)) || (IS_BIT_SET(reg_TWSSRA, TWBE)) )
 		{// bus error.
-			//printf_P (PSTR("Bus Collision or Bus Error (last ByteCount:%u); \r\n"), g_ActualByteCount);
-			if (pI2C_Device_Func[g_DeviceIndex] != NULL)
-				pI2C_Device_Func[g_DeviceIndex](g_Status|I2C_ERROR, NULL, NULL, g_ActualByteCount); 
-			I2C_TimeOut = 0;
-			g_ActualByteCount = 0;
+			Trace_Add (TRACE_TWI_ERROR, reg_TWSSRA);
+			I2C_Bus_Error (&g_TWI_Bus);
 		}
 		else if (IS_BIT_SET(reg_TWSSRA, TWAS))
 		{// start or re-start detected.
-			
-			if (g_ActualByteCount != 0)
-			{// star detected (re-start transaction w/o exec stop)
-				//printf_P (PSTR("Restart (last ByteCount:%u);"), g_ActualByteCount);
-				if (pI2C_Device_Func[g_DeviceIndex] != NULL)
-					pI2C_Device_Func[g_DeviceIndex] (g_Status|I2C_STOP, NULL, NULL, g_ActualByteCount);  // end any open transaction before start a new one.
-			}
-			
-			g_DeviceIndex = (reg_TWSD>>1) & 0x03;
-			I2C_TimeOut = I2C_TIME_OUT;
-			g_ActualByteCount = 0;
-			g_MaxByteCount = 0;
-			g_Status = READ_BIT_REG (reg_TWSSRA, TWDIR); // 1:I2C_RD; 0:I2C_WR
-			
-			//-------------------------------------------------
-			if (pI2C_Device_Func[g_DeviceIndex] != NULL)
-				l_TWAA = pI2C_Device_Func[g_DeviceIndex] (g_Status|I2C_START, &g_pBuffer, &g_MaxByteCount, 0); 
-			else
-				l_TWAA = I2C_NACK;  // Send 'NACK' response for address match  
-			
+			Trace_Add (TRACE_TWI_START, reg_TWSD);
+			l_TWAA = I2C_Bus_Start (&g_TWI_Bus, reg_TWSD);
 			WRITE_BIT_REG (TWSCRB, TWAA, l_TWAA);
-			//-----------------------------------------------
 		}
 		else
-		{// stop detected 
-			if (pI2C_Device_Func[g_DeviceIndex] != NULL)
-				pI2C_Device_Func[g_DeviceIndex] (g_Status|I2C_STOP, NULL, NULL, g_ActualByteCount); 
-			I2C_TimeOut = 0;
-			g_ActualByteCount = 0;
+		{// stop detected
+			Trace_Add (TRACE_TWI_STOP, g_TWI_Bus.ActualByteCount);
+			I2C_Bus_Stop (&g_TWI_Bus);
 		}
-		
+
 		TWSSRA = 1<<TWASIF; // clear flag // also send response (after address match) according to TWAA bit value.
 	}
 	//----------------------------------------------------------------------------
@@ -125,73 +673,19 @@ ISR(TWI_SLAVE_vect, ISR_BLOCK)
 	{
 		if (IS_BIT_SET(reg_TWSSRA, TWDIR))
 		{// master read mode
-			
-			if ( (IS_BIT_SET(reg_TWSSRA, TWRA)) && (g_ActualByteCount>0) )  // master action is valid from the second byte interrupt
-			{
-				// when master NACK the previous data, do not reload I2C buffer with a new data since master stop reading.
-				TWSD = 0xFF; // send 'FF' to master it master continue to read after it's own NACK.
-			}
-			else
-			{
-				// The first read buffer allocation can be done on I2C_START state or on I2C_BUFF.
-				// When I2C_BUFF event is send to device emulation, this means the I2C module sent g_MaxByteCount to the master.  
-				
-				if ( (g_ActualByteCount >= g_MaxByteCount) && (pI2C_Device_Func[g_DeviceIndex] != NULL) )
-				{
-					// request the device to allocate a read buffer 
-					pI2C_Device_Func[g_DeviceIndex] (I2C_RD_BUFF_EMPTY, &g_pBuffer, &g_MaxByteCount, g_ActualByteCount);
-					g_ActualByteCount = 0;
-				}
-								
-				if (g_ActualByteCount >= g_MaxByteCount)
-				{ 
-					// no more data to send to master.
-					TWSD = 0xFF;  // send 'FF' to master.
-				}
-				else
-				{
-					// reload byte to send to master
-					TWSD = *g_pBuffer;
-					g_ActualByteCount++;
-					g_pBuffer++;
-				}
-			}
+			TWSD = I2C_Bus_Read (&g_TWI_Bus, IS_BIT_SET(reg_TWSSRA, TWRA));
 		}
 		else
 		{// master write mode
-			
-			// The first write buffer allocation *MUST* be done in I2C_WR_START state.
-			// When I2C_WR_BUFF_FULL event is send to device emulation, this means the I2C module received g_MaxByteCount from the master and hold the bus before sending the action for this last byte.
-			// e.g., when g_MaxByteCount is 3, the I2C_WR_BUFF_FULL event occur after receiving 3 bytes from the master and just before sending the response. The emulate device can ACK or NACK the third byte. 
-			
-			if (g_ActualByteCount >= g_MaxByteCount)
-			{
-				l_TWAA = I2C_NACK;  // Send 'NACK' on the next action 
-			}
-			else
-			{
-				l_TWAA = I2C_ACK; // Send 'ACK' on the next action 
-				*g_pBuffer = reg_TWSD;
-				g_ActualByteCount++;
-				g_pBuffer++;
-			}
-			
-			if ( (g_ActualByteCount >= g_MaxByteCount) && (pI2C_Device_Func[g_DeviceIndex] != NULL) )
-			{
-				// request the device to allocate a new write buffer; 
-				// device return response type (NACK or ACK) for this cycle. 
-				l_TWAA = pI2C_Device_Func[g_DeviceIndex] (I2C_WR_BUFF_FULL, &g_pBuffer, &g_MaxByteCount, g_ActualByteCount);
-				g_ActualByteCount = 0;
-			}
-			
+			l_TWAA = I2C_Bus_Write (&g_TWI_Bus, reg_TWSD);
 			WRITE_BIT_REG (TWSCRB, TWAA, l_TWAA);
 		}
-		
+
 		//----------------------------------------------------------
 		// ????? Accessing TWSD will clear the slave interrupt flags
 		TWSSRA = 1<<TWDIF; // clear flag // also executed Acknowledge action (while master transmit) according to TWAA bit value.
-		I2C_TimeOut = I2C_TIME_OUT; 
 	}
 	//----------------------------------------------------------------------------
+	PROFILE_END (PROFILE_TWI);
 }
 
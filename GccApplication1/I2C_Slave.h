@@ -8,13 +8,40 @@
 #ifndef _I2C_SLAVE_H_
 #define _I2C_SLAVE_H_
 
-#define I2C_Slave_Addr ((uint8_t)0x70) // base address to emulate x4 I2C devices. Address value must aline to 4.
+#define I2C_DEVICES 8 // max number of emulated I2C devices; must be power of 2.
+#define I2C_Slave_Addr ((uint8_t)0x70) // default base address; must aline to the number of addresses claimed (see I2C_Slave_Init).
 
-// I2C_Slave_PeriodicTask() can be use in main loop or system tick to restart I2C slave module in case of time-out. 
-// Time-out value is update on each I2C action interrupt to I2C_TIME_OUT or 0 to disable the time-out.
-#define I2C_TIME_OUT (uint32_t)100  //  msec 
-extern void I2C_Slave_Init (uint8_t BaseAddr);
+// I2C_Slave_PeriodicTask() can be use in main loop or system tick (1 msec) to recover the I2C bus in case of time-out. 
+// Time-out value is update on each I2C action interrupt to the configured time-out or 0 to disable the time-out (between transactions).
+// On time-out: the active device get I2C_WR_ERROR / I2C_RD_ERROR, the slave module is restarted (release SDA and SCL) and, 
+// if SDA is still held low, up to I2C_RECOVERY_CLOCKS clocks are issued on SCL followed by a stop condition.
+#define I2C_TIME_OUT		(uint8_t)100 // msec; default time-out 
+#define I2C_TIME_OUT_SMBUS	(uint8_t)25  // msec; SMBus time-out (tTIMEOUT,MIN) 
+#define I2C_RECOVERY_CLOCKS	9
+extern void I2C_Slave_Init (uint8_t BaseAddr, uint8_t Devices /*addresses claimed from BaseAddr; power of 2, up to I2C_DEVICES*/);
 extern void I2C_Slave_PeriodicTask (uint32_t ElapsedTime /*msec*/); 
+extern void I2C_Slave_Set_TimeOut (uint8_t TimeOut /*msec; 0: disable*/);
+extern uint8_t I2C_Slave_Get_TimeOut (void);
+extern uint16_t I2C_Slave_Get_Recovery_Count (void); // number of time-out recoveries 
+extern uint16_t I2C_Slave_Get_Stuck_Count (void);    // number of recoveries where SDA was held low after the slave module released the bus
+
+// SMBus Packet Error Checking (PEC; CRC-8 x^8+x^2+x+1 over all bytes of the transaction including address bytes), enabled per emulated device:
+// * read: the PEC byte is sent after the read buffer allocated on I2C_RD_START (I2C_RD_BUFF_EMPTY is not issued once data was sent).
+// * write: the last byte before stop must be the PEC; on mismatch the device get I2C_WR_ERROR (no data) instead of I2C_WR_STOP.
+//   Received bytes are staged on the bus (up to I2C_PEC_STAGE bytes including the PEC; longer write is NACK) and are ACK; 
+//   on stop, when the last byte is the PEC of all bytes before it, the bytes before it are passed to the device (a byte
+//   the device NACK end the delivery) followed by I2C_WR_STOP. The PEC byte is not pass to the device. A device never get
+//   a byte of a write that fail the PEC check; device NACK (e.g., I2C_WR_BUFF_FULL) is not reported to the master.
+//   Write part of a combined transaction (re-start) has no PEC; its bytes are passed to the device on the re-start. 
+#ifndef I2C_PEC_STAGE
+#define I2C_PEC_STAGE 24 // bytes; longest write with PEC (e.g., EEPROM batched write: 21 bytes + PEC)
+#endif
+#ifndef I2C_PEC_TABLE
+#define I2C_PEC_TABLE 1 // 1: table base CRC (256 bytes of flash); 0: bitwise CRC (smaller and slower).
+#endif
+extern void I2C_Slave_Set_PEC (uint8_t DeviceMask /*bit per device index*/);
+extern uint8_t I2C_Slave_Get_PEC (void);
+extern uint16_t I2C_Slave_Get_PEC_Error_Count (void);
 
 //--------------------------------------------
 // Callback function for emulated devices 
@@ -60,7 +87,37 @@ typedef uint8_t (*I2C_DEVICE_FUNC)(uint8_t Status, /*out*/ uint8_t **pBuffer, /*
 
 
 // default is NULL for all pointers
-extern I2C_DEVICE_FUNC pI2C_Device_Func [4];
+extern I2C_DEVICE_FUNC pI2C_Device_Func [I2C_DEVICES];
+
+//-------------------------------------------------
+// SMBus alert (INT# on PB2) and Alert Response Address
+//-------------------------------------------------
+// INT# is asserted while any device request an alert which was not yet reported by ARA. 
+// While INT# is asserted, the slave module also answer ARA read (0x0C) with the address of the alerting device (lowest address first). 
+// The reported alert is masked until the device release it (I2C_Slave_Alert (DeviceIndex, false)) and request it again. 
+// Note: ARA needs software address match (promiscuous mode); it is enabled only while INT# is asserted.
+#define I2C_ARA_ADDR ((uint8_t)0x0C)
+extern void I2C_Slave_Alert (uint8_t DeviceIndex, bool Assert);
+extern uint8_t I2C_Slave_Get_Alert (void); // bit per device index; alerts not yet reported by ARA.
+
+//-------------------------------------------------
+// Simulated master (self-test; see I2C_Test.h)
+//-------------------------------------------------
+// Drive the transaction engine on a private bus with the same calls the TWI interrupt use for the hardware events
+// (start / re-start, data, stop, bus error and time-out). Device callbacks are called in atomic context, like from the TWI interrupt.
+// The TWI slave module is disabled between I2C_Sim_Begin and I2C_Sim_End (the host get NACK).
+#ifndef I2C_SELF_TEST
+#define I2C_SELF_TEST 0 // 1: include the simulated master and the conformance self-test
+#endif
+extern void I2C_Sim_Begin (void);
+extern void I2C_Sim_End (void);
+extern uint8_t I2C_Sim_Start (uint8_t AddrByte); // return response type for the address byte (I2C_NACK or I2C_ACK).
+extern uint8_t I2C_Sim_Write (uint8_t Data);     // return response type for the byte.
+extern uint8_t I2C_Sim_Read (bool MasterNack);   // return the byte sent by the slave; MasterNack: master NACK the previous byte.
+extern void I2C_Sim_Stop (void);
+extern void I2C_Sim_Error (void);
+extern bool I2C_Sim_TimeOut (uint32_t ElapsedTime /*msec*/); // return true when the open transaction is timed-out.
+extern bool I2C_Sim_Check (void); // return false if the engine state is not consistent (e.g., device callback allocated a NULL buffer).
 
 #endif
 	
\ No newline at end of file
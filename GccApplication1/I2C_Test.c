@@ -0,0 +1,531 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+ I2C conformance self-test
+ ************************************
+
+ The simulated master (see I2C_Slave.h) issue start, re-start, stop, NACK terminated reads, bus error and time-out
+ to the same transaction engine used by the TWI interrupt, and checks:
+ * protocol: not emulated address is NACK; master NACK does not consume data; time-out and bus error end the transaction.
+ * EEPROM (24Cxx): random read (address write and re-start), sequential read across the read buffer and current address read.
+ * SRAM: page write and read wraparound at the end of the memory (original data is restored).
+ * ADC (ADS7830): single command byte (next byte is NACK); one conversion result per read byte.
+ * GPI (MAX7319): read return inputs and transition flags; continues read sample the inputs again.
+ * GPIO (PCA9555): register pair write and toggled read; input register follow the polarity register (pins are not changed).
+ * Fan (EMC2101, FAN_DEVICE == 1): identification registers with continues read (PWM and tach are not changed).
+ * Temperature (LM75): pointer write, register write (9-bit; unused bits are cleared) and continues read of the same register.
+ Throughput: CPU cycles per byte for SRAM read (one 128 bytes transaction) and write (16 bytes transactions).
+ Latency: a Timer0 compare B interrupt (ISR_BLOCK, stand for TWI_SLAVE_vect) fire right after each tick, while the tick ISR
+ is running, with simulated SRAM traffic from main loop; its worst-case latency must be within I2C_TEST_LATENCY_BOUND 
+ (hold only with the interrupt priority emulation; see ISR_Priority.h). Skipped when run at boot (interrupts disabled).
+ The other ISR_BLOCK vectors are not probed; INT0_vect and WDT_vect do not print or wait (the power-cycle and the WDT report
+ are run from main loop; see PowerCycle.c and main.c), so they are bound by a few usec each (Trace_Add, WD_Stop); their
+ max duration is reported by the ISR profile (PROFILE_INT0, PROFILE_WDT; see Profile.h).
+ Stack: the high-water mark since reset (including the latency probe nesting) must leave STACK_GUARD bytes unused (see Stack.h).
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_GPI.h"
+#include "I2C_Device_SRAM.h"
+#include "I2C_Device_Temp.h"
+#include "I2C_Device_GPIO.h"
+#include "I2C_Device_Fan.h"
+#include "SystemTick.h"
+#include "Config.h"
+#include "Stack.h"
+#include "I2C_Test.h"
+
+#if (I2C_SELF_TEST == 1)
+
+#define F_CPU 8000000UL  // 8 MHz
+
+#define I2C_TEST_ADDR(Index, Rw)	((uint8_t)((g_Test_BaseAddr + (Index)) << 1 | (Rw)))
+#define I2C_TEST_CHECK(Pass)		I2C_Test_Check ((Pass), __LINE__)
+
+#define I2C_TEST_ROM				0x70 // software info in flash; emulated EEPROM address 0x0100 (see I2C_Device_EEPROM.c)
+#define I2C_TEST_SRAM_END			(I2C_DEVICE_SRAM_SIZE - 2) // last 2 bytes of the emulated SRAM
+#define I2C_TEST_LATENCY_TIME		100 // msec
+#define I2C_TEST_LATENCY_BOUND		40  // usec; less than half a byte time at 100KHz
+
+static MODULE_CONFIG *g_Test_Config;
+static uint8_t g_Test_BaseAddr;
+static uint8_t g_Test_Fail;
+static uint16_t g_Test_Random = 0xACE1;
+static volatile uint8_t g_Test_Latency_Max; // Timer0 counts (8 usec)
+static volatile uint8_t g_Test_Latency_Count;
+
+//--------------------------------------------------------------------------
+extern void I2C_Test_Init (MODULE_CONFIG *pConfig)
+{
+	g_Test_Config = pConfig;
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_Check (bool Pass, uint16_t Line)
+{
+	if (Pass)
+		return;
+
+	g_Test_Fail++;
+	printf_P (PSTR("> I2C test: check at line %u failed \r\n"), Line);
+}
+//--------------------------------------------------------------------------
+// Write transaction; the master stop sending on NACK. Stop: false to continue with re-start.
+// return: 0 if the address is NACK; otherwise 1 + number of data bytes ACK.
+static uint8_t I2C_Test_Write (uint8_t Index, const uint8_t *pData, uint8_t Count, bool Stop)
+{
+	uint8_t Ack = 0;
+
+	if (I2C_Sim_Start (I2C_TEST_ADDR (Index, I2C_WR)) == I2C_ACK)
+	{
+		for (Ack = 1; (Ack <= Count) && (I2C_Sim_Write (pData[Ack-1]) == I2C_ACK); Ack++);
+	}
+
+	if (Stop)
+		I2C_Sim_Stop ();
+
+	return (Ack);
+}
+//--------------------------------------------------------------------------
+// Read transaction (start or re-start); the master ACK all bytes but the last, NACK the last one and stop.
+// return false if the address is NACK.
+static bool I2C_Test_Read (uint8_t Index, uint8_t *pData, uint8_t Count)
+{
+	uint8_t i;
+	bool Ack = (I2C_Sim_Start (I2C_TEST_ADDR (Index, I2C_RD)) == I2C_ACK);
+
+	if (Ack)
+	{
+		for (i = 0; i < Count; i++)
+			pData[i] = I2C_Sim_Read (false);
+		I2C_TEST_CHECK (I2C_Sim_Read (true) == 0xFF); // after master NACK: no data is consumed
+	}
+
+	I2C_Sim_Stop ();
+	return (Ack);
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_Protocol (uint8_t Index /*any emulated device*/)
+{
+	uint8_t i;
+	uint8_t TimeOut = I2C_Slave_Get_TimeOut ();
+
+	for (i = 0; i < I2C_DEVICES; i++)
+	{
+		if (pI2C_Device_Func[i] == NULL)
+		{
+			I2C_TEST_CHECK (I2C_Sim_Start (I2C_TEST_ADDR (i, I2C_RD)) == I2C_NACK); // not emulated
+			I2C_Sim_Stop ();
+			break;
+		}
+	}
+
+	// time-out while the master hold the bus; the device get I2C_WR_ERROR.
+	I2C_TEST_CHECK (I2C_Test_Write (Index, &i, 0, false) == 1);
+	if (TimeOut != 0)
+	{
+		I2C_TEST_CHECK (I2C_Sim_TimeOut (TimeOut - 1) == false);
+		I2C_TEST_CHECK (I2C_Sim_TimeOut (1) == true);
+	}
+	else
+	{
+		I2C_Sim_Stop ();
+	}
+	I2C_TEST_CHECK (I2C_Sim_TimeOut (0xFFFF) == false); // no open transaction
+
+	// bus error in the middle of a transaction
+	I2C_TEST_CHECK (I2C_Sim_Start (I2C_TEST_ADDR (Index, I2C_WR)) == I2C_ACK);
+	I2C_Sim_Error ();
+	I2C_TEST_CHECK (I2C_Sim_TimeOut (0xFFFF) == false);
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_EEPROM (uint8_t Index)
+{
+	uint8_t Cmd [2] = {0x01, 0x00}; // software info
+	uint8_t Data [20]; // more than the device read buffer (16 bytes)
+	uint8_t i;
+
+	// random read: address write, re-start and sequential read
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, sizeof (Cmd), false) == 1 + sizeof (Cmd));
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data)));
+	for (i = 0; i < sizeof (Data); i++)
+		I2C_TEST_CHECK (Data[i] == pgm_read_byte (I2C_TEST_ROM + i));
+
+	// current address read continues after the last byte ACK by the master
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, 4));
+	for (i = 0; i < 4; i++)
+		I2C_TEST_CHECK (Data[i] == pgm_read_byte (I2C_TEST_ROM + sizeof (Data) + i));
+
+	// address write with stop, then current address read
+	Cmd[1] = 0x10;
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, sizeof (Cmd), true) == 1 + sizeof (Cmd));
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, 1));
+	I2C_TEST_CHECK (Data[0] == pgm_read_byte (I2C_TEST_ROM + 0x10));
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_SRAM (uint8_t Index)
+{
+	static const uint8_t Pattern [4] PROGMEM = {0xA5, 0x5A, 0xC3, 0x3C};
+	uint8_t Save [2 + sizeof (Pattern)]; // address + data
+	uint8_t Cmd [2 + sizeof (Pattern)];
+	uint8_t Data [sizeof (Pattern)];
+
+	Cmd[0] = Save[0] = (uint8_t)(I2C_TEST_SRAM_END >> 8);
+	Cmd[1] = Save[1] = (uint8_t)I2C_TEST_SRAM_END;
+	memcpy_P (&Cmd[2], Pattern, sizeof (Pattern));
+
+	I2C_Test_Write (Index, Save, 2, false);
+	I2C_TEST_CHECK (I2C_Test_Read (Index, &Save[2], sizeof (Pattern)));
+
+	// page write across the end of the memory
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, sizeof (Cmd), true) == 1 + sizeof (Cmd));
+	I2C_Test_Write (Index, Cmd, 2, false);
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data)));
+	I2C_TEST_CHECK (memcmp (Data, &Cmd[2], sizeof (Data)) == 0);
+
+	// the last two bytes were written at address 0
+	Cmd[0] = Cmd[1] = 0;
+	I2C_Test_Write (Index, Cmd, 2, false);
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, 2));
+	I2C_TEST_CHECK ( (Data[0] == pgm_read_byte (&Pattern[2])) && (Data[1] == pgm_read_byte (&Pattern[3])) );
+
+	I2C_Test_Write (Index, Save, sizeof (Save), true); // restore
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_ADC (uint8_t Index)
+{
+	uint8_t Cmd [2] = {0x88, 0x88}; // single-ended; channel 0; external VREF
+	uint8_t Data [2];
+
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 1, true) == 2);
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 2, true) == 2); // second command byte is NACK
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data))); // a conversion per byte
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_GPI (uint8_t Index)
+{
+	uint8_t Data [3];
+
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data)));
+	I2C_TEST_CHECK (Data[0] == (uint8_t)GPI_Get_State ()); // inputs (assume stable inputs)
+	I2C_TEST_CHECK (Data[2] == Data[0]); // continues read
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_GPIO (uint8_t Index)
+{
+	uint8_t Cmd [3] = {GPIO_REG_POLARITY0, 0xFF, 0xFF};
+	uint8_t Save [3] = {GPIO_REG_POLARITY0};
+	uint8_t Data [3];
+
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 1, true) == 2); // command only
+	I2C_TEST_CHECK (I2C_Test_Read (Index, &Save[1], 2));
+	Cmd[0] = GPIO_REG_INPUT0;
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 1, true) == 2);
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data)));
+	I2C_TEST_CHECK (Data[2] == Data[0]); // toggle back to input 0 (assume stable inputs)
+	Cmd[0] = GPIO_REG_POLARITY0;
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, sizeof (Cmd), true) == 4); // both polarity registers
+	Cmd[0] = GPIO_REG_INPUT1;
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 1, true) == 2);
+	I2C_TEST_CHECK (I2C_Test_Read (Index, &Cmd[1], 2));
+	I2C_TEST_CHECK ( ((Cmd[1] ^ Data[1]) == 0xFF) && ((Cmd[2] ^ Data[0]) == 0xFF) ); // input 1, then input 0; inverted
+	I2C_Test_Write (Index, Save, sizeof (Save), true); // restore
+}
+//--------------------------------------------------------------------------
+#if (FAN_DEVICE == 1)
+static void I2C_Test_Fan (uint8_t Index)
+{
+	uint8_t Cmd [1] = {FAN_REG_PRODUCT_ID};
+	uint8_t Data [3];
+
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 1, true) == 2);
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data)));
+	I2C_TEST_CHECK ( (Data[0] == 0x16) && (Data[1] == 0x5D) && (Data[2] == 0x01) ); // product, manufacturer and revision
+}
+#endif
+//--------------------------------------------------------------------------
+static void I2C_Test_Temp (uint8_t Index)
+{
+	uint8_t Cmd [4] = {TEMP_REG_THYST, 0x40, 0xFF, 0x00};
+	uint8_t Save [3] = {TEMP_REG_THYST};
+	uint8_t Data [3];
+
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, 1, true) == 2); // pointer only
+	I2C_TEST_CHECK (I2C_Test_Read (Index, &Save[1], 2));
+	I2C_TEST_CHECK (I2C_Test_Write (Index, Cmd, sizeof (Cmd), true) == 4); // fourth byte is NACK
+	I2C_TEST_CHECK (I2C_Test_Read (Index, Data, sizeof (Data)));
+	I2C_TEST_CHECK ( (Data[0] == 0x40) && (Data[1] == 0x80) && (Data[2] == 0x40) ); // bits 6..0 are cleared; continues read
+	I2C_Test_Write (Index, Save, sizeof (Save), true); // restore
+}
+#if (I2C_TEST_THROUGHPUT > 0)
+//--------------------------------------------------------------------------
+// return CPU cycles per byte; Count: total data bytes.
+static uint32_t I2C_Test_Cycles (uint16_t Start, uint16_t Count)
+{
+	return ((uint32_t)(uint16_t)(SystemTick_Get_Timer1 () - Start) * (F_CPU / 1000000UL) / Count);
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_Throughput (uint8_t Index)
+{
+	uint8_t Cmd [2 + 16]; // address + data
+	uint16_t Start;
+	uint16_t Time = 0; // usec
+	uint8_t i;
+
+	Cmd[0] = Cmd[1] = 0;
+	I2C_Test_Write (Index, Cmd, 2, false);
+	Start = SystemTick_Get_Timer1 ();
+	I2C_Sim_Start (I2C_TEST_ADDR (Index, I2C_RD));
+	for (i = 0; i < I2C_TEST_THROUGHPUT; i++)
+		I2C_Sim_Read (false);
+	I2C_Sim_Stop ();
+	printf_P (PSTR("> I2C test: read %lu cycles/byte; "), I2C_Test_Cycles (Start, I2C_TEST_THROUGHPUT));
+
+	// write back the same data
+	for (i = 0; i < I2C_TEST_THROUGHPUT; i += 16)
+	{
+		Cmd[0] = 0;
+		Cmd[1] = i;
+		I2C_Test_Write (Index, Cmd, 2, false);
+		I2C_Test_Read (Index, &Cmd[2], 16);
+		Start = SystemTick_Get_Timer1 ();
+		I2C_Test_Write (Index, Cmd, sizeof (Cmd), true);
+		Time += SystemTick_Get_Timer1 () - Start;
+	}
+	printf_P (PSTR("write %lu cycles/byte \r\n"), (uint32_t)Time * (F_CPU / 1000000UL) / I2C_TEST_THROUGHPUT);
+}
+#endif
+//--------------------------------------------------------------------------
+// latency probe; Timer0 compare B match when Timer0 is cleared by the tick compare A match (CTC), 8 usec after the tick. 
+ISR(TIMER0_COMPB_vect, ISR_BLOCK)
+{
+	uint8_t Latency = TCNT0 - OCR0B;
+	
+	if (Latency > g_Test_Latency_Max)
+		g_Test_Latency_Max = Latency;
+	if (g_Test_Latency_Count != 0xFF)
+		g_Test_Latency_Count++;
+}
+//--------------------------------------------------------------------------
+static void I2C_Test_Latency (uint8_t Index)
+{
+	uint8_t Data [16];
+	uint16_t Start = (uint16_t)SystemTick_Get_msec ();
+
+	if (! IS_BIT_SET (SREG, SREG_I))
+	{
+		printf_P (PSTR("> I2C test: latency skipped; interrupts are disabled (boot) \r\n"));
+		return;
+	}
+
+	g_Test_Latency_Max = 0;
+	g_Test_Latency_Count = 0;
+	OCR0B = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TIFR = 1<<OCF0B; // clear flag
+		SET_BIT_REG (TIMSK, OCIE0B);
+	}
+
+	// worst-case mix: the tick ISR (periodic tasks) and simulated TWI traffic (interrupts are disabled per bus event)
+	while ((uint16_t)SystemTick_Get_msec () - Start < I2C_TEST_LATENCY_TIME)
+	{
+		__asm__ __volatile__ ("wdr"); // reset (touch) ATtiny1634 Watchdog
+		Data[0] = Data[1] = 0;
+		I2C_Test_Write (Index, Data, 2, false);
+		I2C_Test_Read (Index, Data, sizeof (Data));
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		CLEAR_BIT_REG (TIMSK, OCIE0B);
+	}
+	printf_P (PSTR("> I2C test: latency %u usec after tick (bound %u usec); %u samples \r\n"), 
+		g_Test_Latency_Max * 8, I2C_TEST_LATENCY_BOUND, g_Test_Latency_Count);
+	I2C_TEST_CHECK (g_Test_Latency_Count >= I2C_TEST_LATENCY_TIME / 2);
+	I2C_TEST_CHECK (g_Test_Latency_Max * 8 <= I2C_TEST_LATENCY_BOUND);
+}
+//--------------------------------------------------------------------------
+extern uint8_t I2C_Test_Run (void)
+{
+	uint8_t PEC = I2C_Slave_Get_PEC ();
+	uint8_t Index;
+
+	g_Test_Fail = 0;
+	g_Test_BaseAddr = g_Test_Config->BaseAddr;
+	I2C_Slave_Set_PEC (0); // the simulated master does not send PEC
+	I2C_Sim_Begin ();
+
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_EEPROM)) != I2C_DEVICE_NONE )
+	{
+		I2C_Test_Protocol (Index);
+		I2C_Test_EEPROM (Index);
+	}
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_ADC)) != I2C_DEVICE_NONE )
+		I2C_Test_ADC (Index);
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_GPI)) != I2C_DEVICE_NONE )
+		I2C_Test_GPI (Index);
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_GPIO)) != I2C_DEVICE_NONE )
+		I2C_Test_GPIO (Index);
+#if (FAN_DEVICE == 1)
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_FAN)) != I2C_DEVICE_NONE )
+		I2C_Test_Fan (Index);
+#endif
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_TEMP)) != I2C_DEVICE_NONE )
+		I2C_Test_Temp (Index);
+	if ( (Index = Config_Get_Index (g_Test_Config, CONFIG_DEV_SRAM)) != I2C_DEVICE_NONE )
+	{
+		I2C_Test_SRAM (Index);
+#if (I2C_TEST_THROUGHPUT > 0)
+		I2C_Test_Throughput (Index);
+#endif
+		I2C_Test_Latency (Index);
+	}
+
+	I2C_Sim_End ();
+	I2C_Slave_Set_PEC (PEC);
+	I2C_TEST_CHECK (Stack_Get_Unused () >= STACK_GUARD);
+	printf_P (PSTR("> I2C test: %u checks failed \r\n"), g_Test_Fail);
+	return (g_Test_Fail);
+}
+//--------------------------------------------------------------------------
+// xorshift (7, 9, 8); never 0.
+static uint8_t I2C_Test_Random (void)
+{
+	g_Test_Random ^= g_Test_Random << 7;
+	g_Test_Random ^= g_Test_Random >> 9;
+	g_Test_Random ^= g_Test_Random << 8;
+	return ((uint8_t)g_Test_Random);
+}
+//--------------------------------------------------------------------------
+// Data byte: random, address[15:8] of an emulated EEPROM region (see I2C_Device_EEPROM.c) or SRAM end, or address[7:0] near a boundary.
+static uint8_t I2C_Test_Fuzz_Data (void)
+{
+	static const uint8_t Addr_MSB [] PROGMEM = {0x00, 0x01, 0x02, 0x03, 0x10, 0x14, 0x20, 0x30, 0x31, 0x3F, 0x40, 0x7F, 0x80};
+	uint8_t Data = I2C_Test_Random ();
+
+	switch (Data & 0xC0)
+	{
+		case 0x80:
+			return (pgm_read_byte (&Addr_MSB[(Data & 0x3F) % sizeof (Addr_MSB)]));
+
+		case 0xC0:
+			return ((Data & 0x08) ? (0xF8 | (Data & 0x07)) : (Data & 0x07)); // 0x00..0x07 or 0xF8..0xFF
+
+		default:
+			return (I2C_Test_Random ());
+	}
+}
+//--------------------------------------------------------------------------
+// Bit per device index; devices which get write transactions (see I2C_Test.h).
+static uint8_t I2C_Test_Fuzz_Writable (void)
+{
+	uint8_t Mask = 0;
+	uint8_t i;
+
+	for (i = 0; i < I2C_DEVICES; i++)
+	{
+#if (I2C_TEST_FUZZ_ALL == 1)
+		Mask |= 1<<i;
+#else
+		if ( (i == Config_Get_Index (g_Test_Config, CONFIG_DEV_SRAM)) || (i == Config_Get_Index (g_Test_Config, CONFIG_DEV_STATUS)) )
+			Mask |= 1<<i;
+#endif
+	}
+	return (Mask);
+}
+//--------------------------------------------------------------------------
+extern uint8_t I2C_Test_Fuzz (uint16_t Seed, uint16_t Count)
+{
+	uint8_t PEC = I2C_Slave_Get_PEC ();
+	uint8_t Writable = I2C_Test_Fuzz_Writable ();
+	uint8_t Addr = 0; // address byte of the open transaction; 0: none
+	uint8_t Event;
+	uint16_t i;
+
+	if (Seed != 0)
+		g_Test_Random = Seed;
+	printf_P (PSTR("> I2C fuzz: seed 0x%04X; %u events \r\n"), g_Test_Random, Count);
+
+	g_Test_Fail = 0;
+	g_Test_BaseAddr = g_Test_Config->BaseAddr;
+	I2C_Slave_Set_PEC (I2C_Test_Random ()); // PEC state machine is part of the fuzzing
+	I2C_Sim_Begin ();
+
+	for (i = 0; i < Count; i++)
+	{
+		__asm__ __volatile__ ("wdr"); // reset (touch) ATtiny1634 Watchdog
+		Event = I2C_Test_Random () & 0x0F;
+
+		if ( (Event < 2) || ((Addr == 0) && (Event < 12)) )
+		{ // start or re-start; emulated devices, ARA or any address (promiscuous mode)
+			Event = I2C_Test_Random ();
+			if (Event & 0x80)
+				Addr = (Event & 0x40) ? I2C_ARA_ADDR : (Event & 0x7F);
+			else
+				Addr = g_Test_BaseAddr + (Event & (I2C_DEVICES-1));
+			Event = (uint8_t)(Addr - g_Test_BaseAddr);
+			Addr = Addr<<1 | (I2C_Test_Random () & I2C_RD);
+			if ( (Event < I2C_DEVICES) && IS_BIT_CLEARED (Writable, Event) )
+				Addr |= I2C_RD;
+			if (I2C_Sim_Start (Addr) == I2C_NACK)
+				Addr = 0; // no data interrupts until next start
+		}
+		else if (Event < 12)
+		{ // data in the direction of the open transaction 
+			if (Addr & I2C_RD)
+				I2C_Sim_Read ((I2C_Test_Random () & 0x07) == 0);
+			else
+				I2C_Sim_Write (I2C_Test_Fuzz_Data ());
+		}
+		else if (Event < 14)
+		{
+			I2C_Sim_Stop ();
+			Addr = 0;
+		}
+		else if (Event == 14)
+		{
+			I2C_Sim_Error ();
+			Addr = 0;
+		}
+		else if (I2C_Sim_TimeOut (I2C_Test_Random ()))
+		{
+			Addr = 0;
+		}
+
+		if (I2C_Sim_Check () == false)
+		{
+			g_Test_Fail++;
+			printf_P (PSTR("> I2C fuzz: engine state at event %u (address byte 0x%02X) \r\n"), i, Addr);
+			I2C_Sim_Error ();
+			Addr = 0;
+		}
+	}
+
+	I2C_Sim_End ();
+	I2C_Slave_Set_PEC (PEC);
+	I2C_TEST_CHECK (Stack_Get_Unused () >= STACK_GUARD);
+	printf_P (PSTR("> I2C fuzz: %u checks failed; next seed 0x%04X \r\n"), g_Test_Fail, g_Test_Random);
+	return (g_Test_Fail);
+}
+//--------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _I2C_TEST_H_
+#define _I2C_TEST_H_
+
+// I2C conformance self-test (I2C_SELF_TEST == 1; see I2C_Slave.h).
+// Run the emulated devices through the simulated master and check them against the emulated parts behavior;
+// also measure the transaction engine throughput (CPU cycles per byte, including the device callback) and the interrupt
+// latency during the tick ISR (see ISR_Priority.h).
+// The TWI slave module is disabled while the test is running; device state (e.g., EEPROM current address, ADC command) is changed.
+// The same test runs on the host with the other host tests (Host/Test_I2C.c; make -C Host).
+#ifndef I2C_TEST_THROUGHPUT
+#define I2C_TEST_THROUGHPUT 128 // bytes; 0: no throughput measure (host build: Timer1 does not run).
+#endif
+
+extern void I2C_Test_Init (MODULE_CONFIG *pConfig); // active configuration (base address and device layout)
+extern uint8_t I2C_Test_Run (void); // return number of failed checks; results are printed.
+
+// Fuzzing: Count random bus events (start / re-start to any address, data, master NACK, stop, bus error and time-out), biased to
+// the emulated EEPROM regions boundaries and the SRAM wraparound. The engine state is checked after each event.
+// Seed 0 continue the previous sequence. Emulated SRAM content is changed.
+// Only devices without side effects outside the module RAM (SRAM and status) get write transactions; a start with write to any
+// other device (e.g., EEPROM / config programming, boot request, WD reset signals, GPIO pins, fan PWM, INT#) is issued as read.
+// The host build fuzz all devices (I2C_TEST_FUZZ_ALL == 1; see Host/Test_Fuzz.c).
+#ifndef I2C_TEST_FUZZ_ALL
+#define I2C_TEST_FUZZ_ALL 0 // 1: write transactions to all devices; host build only.
+#endif
+extern uint8_t I2C_Test_Fuzz (uint16_t Seed, uint16_t Count); // return number of failed checks.
+
+#endif
+
+
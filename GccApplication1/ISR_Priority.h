@@ -0,0 +1,34 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _ISR_PRIORITY_H_
+#define _ISR_PRIORITY_H_
+
+// Interrupt priority emulation; the AVR has no interrupt priorities and an ISR_BLOCK vector delay all other vectors.
+// The 1 msec tick is the only low priority ISR; it runs with interrupts enabled, so TWI_SLAVE_vect (and the other ISR_BLOCK 
+// vectors) preempt it; the TWI latency is bound by the longest interrupts-disabled section (ATOMIC_BLOCK or ISR_BLOCK 
+// vector) instead of the tick.
+// * ISR_LOW_PRIORITY_BEGIN (Reg, Bit): mask the ISR own interrupt source (reentrancy guard) and enable interrupts.
+// * ISR_LOW_PRIORITY_END (Reg, Bit): disable interrupts and unmask the source; an event during the ISR is served after return.
+// Only one ISR nest over the tick, so the nested stack is bound (see Stack.h); code called from the tick must not print 
+// (printing is done from main loop, e.g., WD_BackgroundTask) and state shared with other ISRs must be updated in ATOMIC_BLOCK. 
+// INT0 and WDT stay ISR_BLOCK; they do not print or wait (see PowerCycle.c and WDT_BackgroundTask in main.c).
+#ifndef ISR_PRIORITY
+#define ISR_PRIORITY 1 // 0: all ISRs block interrupts
+#endif
+
+#if (ISR_PRIORITY == 1)
+#define ISR_LOW_PRIORITY_BEGIN(Reg, Bit)	do { CLEAR_BIT_REG (Reg, Bit); sei (); } while (0)
+#define ISR_LOW_PRIORITY_END(Reg, Bit)		do { cli (); SET_BIT_REG (Reg, Bit); } while (0)
+#else
+#define ISR_LOW_PRIORITY_BEGIN(Reg, Bit)
+#define ISR_LOW_PRIORITY_END(Reg, Bit)
+#endif
+
+#endif
+
+
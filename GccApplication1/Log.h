@@ -0,0 +1,120 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+// Binary log on top of the trace ring (see Trace.h); cheap enough for ISRs and hot paths (no printf).
+// Usage: define LOG_MODULE (module name below, e.g. ADC) before including this file;
+//        LOG_ERROR / LOG_INFO / LOG_DEBUG (Id, Data) add trace entry code 0x80 | module<<4 | Id (Id: 0x0..0xF) with 8-bit data.
+// * Levels above the module compile-time level (LOG_LEVEL_<module>) compile to nothing.
+// * Entries are added to the trace ring only when enabled at run time by g_Log_Mask (bit per module; 0 after reset, console
+//   'd' command), so host driven errors (e.g., unauthorized writes) do not push the crash history out of the 16 entries ring.
+// * LOG_ERROR is also latched and printed from main loop (Log_BackgroundTask); only the last error since the previous print
+//   is kept.
+// Compile-time level default is LOG_LEVEL_DEBUG for the DEBUG configuration and LOG_LEVEL_ERROR otherwise;
+// override per module with -DLOG_LEVEL_<module>=<level>.
+
+#define LOG_LEVEL_NONE		0
+#define LOG_LEVEL_ERROR		1
+#define LOG_LEVEL_INFO		2
+#define LOG_LEVEL_DEBUG		3
+
+#ifdef DEBUG
+#define LOG_LEVEL_DEFAULT	LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL_DEFAULT	LOG_LEVEL_ERROR
+#endif
+
+// Modules: id (trace code bits 6..4 and g_Log_Mask bit) and compile-time level
+#define LOG_ID_I2C		0
+#define LOG_ID_EEPROM	1
+#define LOG_ID_ADC		2
+#define LOG_ID_GPI		3
+#define LOG_ID_SRAM		4
+#define LOG_ID_STATUS	5
+#define LOG_ID_WD		6
+#define LOG_ID_MAIN		7
+
+#ifndef LOG_LEVEL_I2C
+#define LOG_LEVEL_I2C		LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_EEPROM
+#define LOG_LEVEL_EEPROM	LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_ADC
+#define LOG_LEVEL_ADC		LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_GPI
+#define LOG_LEVEL_GPI		LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_SRAM
+#define LOG_LEVEL_SRAM		LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_STATUS
+#define LOG_LEVEL_STATUS	LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_WD
+#define LOG_LEVEL_WD		LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_MAIN
+#define LOG_LEVEL_MAIN		LOG_LEVEL_DEFAULT
+#endif
+
+// Log ids (entry data in brackets)
+#define LOG_BAD_STATUS			0x0F // all devices: unknown callback status (Status)
+#define LOG_I2C_INTERRUPT		0x00 // TWI slave interrupt (TWSSRA)
+#define LOG_EEPROM_WRITE		0x00 // write allowed (data)
+#define LOG_EEPROM_UNAUTHORIZED	0x01 // write without 'write enable' sequence (address bits 7..0)
+#define LOG_EEPROM_BATCH_KEY	0x02 // batched write with bad key (address bits 7..0)
+#define LOG_EEPROM_BATCH_DENIED	0x03 // batched write to not writable address (address bits 7..0)
+#define LOG_EEPROM_WRITE_DENIED	0x04 // single write to read-only register or with full write queue (address bits 7..0)
+#define LOG_ADC_VALUE			0x00 // value sent to host
+#define LOG_ADC_CMD				0x01 // command byte written
+#define LOG_ADC_SE				0x02 // single-ended convert result
+#define LOG_ADC_DIFF_P			0x03 // differential convert; positive input result
+#define LOG_ADC_DIFF_N			0x04 // differential convert; negative input result
+#define LOG_ADC_TEMP			0x05 // temperature device sample (degC, two's complement)
+#define LOG_ADC_TEMP_ALERT		0x06 // temperature device alert (OS output)
+#define LOG_GPI_TRANSITION		0x00 // input transition (accumulated transitions)
+#define LOG_GPI_ALERT			0x01 // alert issued (transitions & mask)
+#define LOG_GPI_READ			0x02 // inputs read by host (current value)
+#define LOG_GPI_GPIO_WRITE		0x03 // GPIO expander registers written (command<<4 | number of bytes)
+#define LOG_SRAM_READ			0x00 // read (address bits 7..0)
+#define LOG_SRAM_WRITE			0x01 // write (number of bytes)
+
+#define LOG_CAT_(a, b)	a##b
+#define LOG_CAT(a, b)	LOG_CAT_(a, b)
+#define LOG_MODULE_ID		LOG_CAT(LOG_ID_, LOG_MODULE)
+#define LOG_MODULE_LEVEL	LOG_CAT(LOG_LEVEL_, LOG_MODULE)
+#define LOG_CODE(Id)		(0x80 | LOG_MODULE_ID<<4 | (Id))
+
+extern uint8_t g_Log_Mask; // bit per module id; enable the trace entries at run time
+extern void Log_Error (uint8_t Code, uint8_t Data); // latch for printing; trace entry if enabled by g_Log_Mask
+extern void Log_BackgroundTask (void);
+
+#if (LOG_MODULE_LEVEL >= LOG_LEVEL_ERROR)
+#define LOG_ERROR(Id, Data)	Log_Error (LOG_CODE(Id), (Data))
+#else
+#define LOG_ERROR(Id, Data)	do {} while (0)
+#endif
+
+#if (LOG_MODULE_LEVEL >= LOG_LEVEL_INFO)
+#define LOG_INFO(Id, Data)	do { if (g_Log_Mask & (1<<LOG_MODULE_ID)) Trace_Add (LOG_CODE(Id), (Data)); } while (0)
+#else
+#define LOG_INFO(Id, Data)	do {} while (0)
+#endif
+
+#if (LOG_MODULE_LEVEL >= LOG_LEVEL_DEBUG)
+#define LOG_DEBUG(Id, Data)	do { if (g_Log_Mask & (1<<LOG_MODULE_ID)) Trace_Add (LOG_CODE(Id), (Data)); } while (0)
+#else
+#define LOG_DEBUG(Id, Data)	do {} while (0)
+#endif
+
+#endif
+
+
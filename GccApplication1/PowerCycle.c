@@ -0,0 +1,179 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+ BMC flash power-cycle (SPILOAD#)
+ ************************************
+
+ Sequence (see PowerCycle.h); INT0_vect only assert CORST# and start it, so TWI is not held off by the delays:
+ 1. CORST# (PA2) is asserted by INT0_vect; the BMC watchdog channels are stopped.
+ 2. EXTEND_SPILOAD_N (PC2) is sampled: high for BMC reset; low when the host pull HGPIO7 low (force FUP).
+ 3. FWSPI_PWR_EN (PC4) is driven low for POWER_CYCLE_FLASH_OFF.
+ 4. FWSPI_PWR_EN is released (open-drain with external PU) and POWER_CYCLE_FLASH_ON is waited after it goes high
+    (other source may extend the delay by holding it low).
+ 5. CORST# is released and waited to go high (other source may keep it low); INTF0 is cleared, since a SPILOAD# pulse
+    before the release would start a second power-cycle (13/05/2020: double power-cycle on module power-up).
+ 6. BMC reset only: the second SPILOAD# pulse (~17 msec internal BMC reset delay after CORST# release) is waited and masked;
+    in FUP mode EXTEND_SPILOAD_N is kept low and the second pulse can't be detected. If some external signal keep CORST#
+    low, waiting for the pulse (and not a fixed 20 msec) avoid end-less loops of resets. The wait end after
+    POWER_CYCLE_PULSE_TIMEOUT, so SPILOAD# is not masked forever.
+ 7. INTF0 is cleared and INT0 is unmasked; the BMC watchdog channels are stopped again (in case one was started over I2C
+    during the sequence).
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include "CoreRegisters.h"
+#include "SystemTick.h"
+#include "TimeStamp.h"
+#include "Trace.h"
+#include "BMC_WD.h"
+#include "PowerCycle.h"
+
+#define POWER_CYCLE_IDLE		0
+#define POWER_CYCLE_CORST		1 // CORST# asserted; wait to sample EXTEND_SPILOAD_N
+#define POWER_CYCLE_FLASH_OFF_WAIT 2
+#define POWER_CYCLE_FLASH_ON_WAIT 3 // wait for FWSPI_PWR_EN high
+#define POWER_CYCLE_FLASH_ON_DELAY 4
+#define POWER_CYCLE_RELEASE_WAIT 5 // wait for CORST# high
+#define POWER_CYCLE_PULSE_WAIT	6 // wait for the second SPILOAD# pulse
+
+static volatile uint8_t g_PowerCycle_State;
+static uint32_t g_PowerCycle_Time; // usec; start of the current step
+static uint8_t g_PowerCycle_PINC; // EXTEND_SPILOAD_N sample
+
+//--------------------------------------------------------------------------
+extern void PowerCycle_Start (void)
+{
+	CLEAR_BIT_REG (GIMSK, INT0); // until the sequence is done
+	Trace_Add (TRACE_INT0, TRACE_INT0_CORST_ASSERT);
+	WD_Stop ();
+	g_PowerCycle_Time = SystemTick_Get_usec ();
+	g_PowerCycle_State = POWER_CYCLE_CORST;
+}
+//--------------------------------------------------------------------------
+static bool PowerCycle_Elapsed (uint32_t Delay /*usec*/)
+{
+	return (SystemTick_Get_usec () - g_PowerCycle_Time >= Delay);
+}
+//--------------------------------------------------------------------------
+static void PowerCycle_Done (void)
+{
+	SET_BIT_REG (GIFR, INTF0); //  Clear INTF0 bit caused by the second SPILOAD pulse.
+	Trace_Add (TRACE_INT0, TRACE_INT0_DONE);
+	printf_P (PSTR("> Done. \r\n"));
+
+	WD_Stop ();
+	g_PowerCycle_State = POWER_CYCLE_IDLE;
+	SET_BIT_REG (GIMSK, INT0);
+}
+//--------------------------------------------------------------------------
+// Call from main loop.
+extern void PowerCycle_BackgroundTask (void)
+{
+	switch (g_PowerCycle_State)
+	{
+		case POWER_CYCLE_CORST:
+			if (! PowerCycle_Elapsed (POWER_CYCLE_SAMPLE_DELAY))
+				break;
+
+			g_PowerCycle_PINC = PINC; // read EXTEND_SPILOAD_N (PC2) value. If value is low, this means the host pull HGPIO7 low.
+			printf_P (PSTR("> Asserted BMC CORST# . \r\n"));
+			if (IS_BIT_SET (g_PowerCycle_PINC, PC2))
+			{
+				Trace_Add (TRACE_INT0, TRACE_INT0_BMC_RESET);
+				printf_P (PSTR("> BMC reset detected. \r\n"));
+				TimeStamp_Event (EVENT_BMC_RESET_DETECT, g_PowerCycle_PINC); // log the even and reset timestamp
+			}
+			else
+			{
+				Trace_Add (TRACE_INT0, TRACE_INT0_HOST_FUP);
+				printf_P (PSTR("> Host force FUP detected. \r\n"));
+				TimeStamp_Event (EVENT_BMC_ENTER_FUP, g_PowerCycle_PINC); // log the even and reset timestamp
+			}
+
+			// FWSPI_PWR_EN (PC4)
+			Trace_Add (TRACE_INT0, TRACE_INT0_FLASH_OFF);
+			SET_BIT_REG (DDRC, PC4); // set output
+			CLEAR_BIT_REG (PORTC, PC4); // set low
+			printf_P (PSTR("> Turn-off flash power; wait 5 msec ... \r\n"));
+			g_PowerCycle_Time = SystemTick_Get_usec ();
+			g_PowerCycle_State = POWER_CYCLE_FLASH_OFF_WAIT;
+			break;
+
+		case POWER_CYCLE_FLASH_OFF_WAIT:
+			if (! PowerCycle_Elapsed (POWER_CYCLE_FLASH_OFF))
+				break;
+
+			// FWSPI_PWR_EN (PC4)
+			Trace_Add (TRACE_INT0, TRACE_INT0_FLASH_ON);
+			CLEAR_BIT_REG (DDRC, PC4); // set input (open-drain with external PU)
+			printf_P (PSTR("> Turn-on flash power. \r\n"));
+			g_PowerCycle_State = POWER_CYCLE_FLASH_ON_WAIT;
+			break;
+
+		case POWER_CYCLE_FLASH_ON_WAIT:
+			if (! IS_BIT_SET (PINC, PC4))
+				break; // wait for FWSPI_PWR_EN goes high. Can be use to extend the delay.
+
+			printf_P (PSTR("> Wait 5 msec  ... \r\n"));
+			g_PowerCycle_Time = SystemTick_Get_usec ();
+			g_PowerCycle_State = POWER_CYCLE_FLASH_ON_DELAY;
+			break;
+
+		case POWER_CYCLE_FLASH_ON_DELAY:
+			if (! PowerCycle_Elapsed (POWER_CYCLE_FLASH_ON))
+				break;
+
+			// CORST_N (PA2)
+			Trace_Add (TRACE_INT0, TRACE_INT0_CORST_RELEASE);
+			CLEAR_BIT_REG (DDRA, PA2); // set input (open-drain with external PU)
+			printf_P (PSTR("> Release CORST#. \r\n"));
+			g_PowerCycle_State = POWER_CYCLE_RELEASE_WAIT;
+			break;
+
+		case POWER_CYCLE_RELEASE_WAIT:
+			if (! IS_BIT_SET (PINA, PA2))
+				break; // wait for CORST# to goes high. Can be use to extend the delay (maybe other source keep this signal low).
+
+			SET_BIT_REG (GIFR, INTF0); // SPILOAD pulse before reset was released (see step 5)
+			if (! IS_BIT_SET (g_PowerCycle_PINC, PC2))
+			{
+				PowerCycle_Done (); // FUP: the second pulse can't be detected
+				break;
+			}
+
+			printf_P (PSTR("> Wait for the second pulse on SPILOAD# ... \r\n"));
+			g_PowerCycle_Time = SystemTick_Get_usec ();
+			g_PowerCycle_State = POWER_CYCLE_PULSE_WAIT;
+			break;
+
+		case POWER_CYCLE_PULSE_WAIT:
+			if (IS_BIT_SET (GIFR, INTF0))
+				PowerCycle_Done ();
+			else if (PowerCycle_Elapsed (POWER_CYCLE_PULSE_TIMEOUT * 1000UL))
+			{
+				printf_P (PSTR("> No second pulse on SPILOAD#. \r\n"));
+				PowerCycle_Done ();
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+//--------------------------------------------------------------------------
@@ -0,0 +1,24 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _POWER_CYCLE_H_
+#define _POWER_CYCLE_H_
+
+// BMC flash power-cycle on SPILOAD# pulse (INT0 falling edge).
+// INT0_vect assert CORST# and call PowerCycle_Start; the rest of the sequence (EXTEND_SPILOAD_N sample, flash power off and on,
+// CORST# release and the second SPILOAD# pulse) is run by PowerCycle_BackgroundTask from main loop. INT0 is masked from
+// PowerCycle_Start until the sequence is done; the second pulse is polled by INTF0.
+// Delays are minimum times; each step may be late by one main loop round.
+#define POWER_CYCLE_SAMPLE_DELAY	100   // usec; CORST# assert to EXTEND_SPILOAD_N (PC2) sample (measured pulse: 10 usec)
+#define POWER_CYCLE_FLASH_OFF		5000  // usec; measured SPI power-down slew rate time: 50 usec
+#define POWER_CYCLE_FLASH_ON		5000  // usec; measured SPI power-up slew rate time: 2.3 msec
+#define POWER_CYCLE_PULSE_TIMEOUT	1000  // msec; wait for the second SPILOAD# pulse (~17 msec internal BMC reset delay)
+
+extern void PowerCycle_Start (void); // call from INT0_vect after CORST# is asserted
+extern void PowerCycle_BackgroundTask (void);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+   ISR Profiler 
+ ************************************
+ 
+ * Per slot (see Profile.h): number of sections, longest duration and a log2 histogram of durations, in Timer1 usec.
+ * Counters saturate at 0xFFFF; clear via Profile_Clear (emulated EEPROM write) to start a new measurement.
+ * Timer1 wrap-around every 65.536 msec; longer sections (e.g., flash programming) are counted with wrong duration.
+ * Profile is readable via Profile_Read (see view format in Profile.h).
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "SystemTick.h"
+#include "Profile.h"
+
+#if (ISR_PROFILE == 1)
+
+typedef struct
+{
+	uint16_t Count;
+	uint16_t Max; // usec
+	uint16_t Histogram [PROFILE_BINS];
+} PROFILE_SLOT;
+
+static PROFILE_SLOT g_Profile [PROFILE_SLOTS];
+
+//---------------------------------------------------------------------------
+extern void Profile_Clear (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset ((void*)g_Profile, 0, sizeof (g_Profile));
+	}
+}
+//---------------------------------------------------------------------------
+extern void Profile_Add (uint8_t Slot, uint16_t Start)
+{
+	PROFILE_SLOT *pSlot = &g_Profile[Slot];
+	uint16_t Duration = SystemTick_Get_Timer1 () - Start;
+	uint16_t Scaled = Duration >> 3;
+	uint8_t Bin = 0;
+	
+	while ( (Scaled != 0) && (Bin < (PROFILE_BINS - 1)) )
+	{
+		Scaled >>= 1;
+		Bin++;
+	}
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // no-op in ISR_BLOCK vector and ATOMIC_BLOCK sections
+	{
+		if (pSlot->Count != 0xFFFF)
+			pSlot->Count++;
+		if (pSlot->Histogram[Bin] != 0xFFFF)
+			pSlot->Histogram[Bin]++;
+		if (Duration > pSlot->Max)
+			pSlot->Max = Duration;
+	}
+}
+//---------------------------------------------------------------------------
+extern void Profile_Read (uint8_t Offset, uint8_t *pBuffer, uint8_t Size)
+{
+	uint8_t i;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (i = 0; i < Size; i++, Offset++)
+			pBuffer[i] = (Offset < PROFILE_VIEW_SIZE) ? ((uint8_t*)g_Profile)[Offset] : 0xEE; // reserved, beyond the view 
+	}
+}
+//---------------------------------------------------------------------------
+extern void Profile_Print (void)
+{
+	PROFILE_SLOT Slot;
+	uint8_t i, Bin;
+	
+	for (i = 0; i < PROFILE_SLOTS; i++)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Slot = g_Profile[i];
+		}
+		printf_P (PSTR("> Profile %u: count %u; max %u usec; histogram"), i, Slot.Count, Slot.Max);
+		for (Bin = 0; Bin < PROFILE_BINS; Bin++)
+			printf_P (PSTR(" %u"), Slot.Histogram[Bin]);
+		printf_P (PSTR(" \r\n"));
+	}
+}
+
+#endif
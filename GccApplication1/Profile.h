@@ -0,0 +1,51 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+// ISR and interrupts-disabled profiler (ISR_PROFILE == 1).
+// Each measured section is bracketed by PROFILE_BEGIN / PROFILE_END (Timer1 capture; 1 usec = 8 CPU cycles); the ISR
+// prologue and epilogue are not included. The tick (low priority; see ISR_Priority.h) duration include the ISRs that preempt it.
+// RAM: PROFILE_SLOTS * 20 bytes; the link fail if static data leave less than STACK_BUDGET (see Stack.h).
+#ifndef ISR_PROFILE
+#define ISR_PROFILE 0 // 1: include the profiler
+#endif
+
+// Profile slots
+#define PROFILE_TWI				0 // TWI_SLAVE_vect
+#define PROFILE_TICK			1 // TIMER0_COMPA_vect
+#define PROFILE_INT0			2 // INT0_vect
+#define PROFILE_WDT				3 // WDT_vect
+#define PROFILE_ATOMIC_SOFTUART	4 // SoftUart_PutChar_Stream interrupts-disabled section
+#define PROFILE_ATOMIC_EVENTLOG	5 // EventLog_Add interrupts-disabled section
+#define PROFILE_SLOTS			6
+
+// Duration histogram: bin 0: 0..7 usec; bin n: 2^(n+2)..2^(n+3)-1 usec; bin 7: 512 usec and above.
+#define PROFILE_BINS			8
+
+// Profile view (see Profile_Read); PROFILE_VIEW_SLOT_SIZE bytes per slot, 16-bit values are little endian and saturate at 0xFFFF:
+// [0..1] count; [2..3] max duration (usec); [4..4+2*PROFILE_BINS-1] histogram.
+#define PROFILE_VIEW_SLOT_SIZE	(4 + 2*PROFILE_BINS)
+#define PROFILE_VIEW_SIZE		(PROFILE_SLOTS * PROFILE_VIEW_SLOT_SIZE)
+
+#if (ISR_PROFILE == 1)
+#define PROFILE_BEGIN(Slot)		uint16_t l_Profile_Start_##Slot = SystemTick_Get_Timer1 ()
+#define PROFILE_END(Slot)		Profile_Add (Slot, l_Profile_Start_##Slot)
+#else
+#define PROFILE_BEGIN(Slot)
+#define PROFILE_END(Slot)
+#endif
+
+extern void Profile_Clear (void);
+extern void Profile_Add (uint8_t Slot, uint16_t Start /*Timer1*/);
+extern void Profile_Read (uint8_t Offset, uint8_t *pBuffer, uint8_t Size); // view offset; beyond the view return 0xEE
+extern void Profile_Print (void);
+
+#endif
+
+
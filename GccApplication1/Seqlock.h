@@ -0,0 +1,27 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+// Sequence lock: consistent read of multi-byte state shared with ISRs, without disabling interrupts in the reader.
+// * Writer: update the state with interrupts disabled (ISR_BLOCK vector or ATOMIC_BLOCK), then SEQLOCK_WRITE; 
+//   a reader never observe a write in progress, so a single increment per update is enough.
+// * Reader: 
+//     do { Seq = SEQLOCK_READ_BEGIN (g_Seq); <copy the state>; } while (SEQLOCK_READ_RETRY (g_Seq, Seq));
+//   the copy is repeated only if an interrupt updated the state in the middle; a reader in ISR context never repeat.
+// The sequence is 8-bit; a reader would have to be preempted by 256 updates to miss one.
+typedef volatile uint8_t SEQLOCK;
+
+#define SEQLOCK_BARRIER()					__asm__ __volatile__ ("" ::: "memory") // keep state accesses between the sequence reads
+#define SEQLOCK_WRITE(Seq)					do { SEQLOCK_BARRIER (); (Seq)++; } while (0)
+#define SEQLOCK_READ_BEGIN(Seq)				({ uint8_t l_Seq = (Seq); SEQLOCK_BARRIER (); l_Seq; })
+#define SEQLOCK_READ_RETRY(Seq, Start)		({ SEQLOCK_BARRIER (); (uint8_t)(Seq) != (Start); })
+
+#endif
+
+
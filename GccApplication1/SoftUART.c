@@ -25,6 +25,8 @@ TBD:
 #include <string.h>
 #include "CoreRegisters.h"
 #include "SoftUART.h"
+#include "SystemTick.h"
+#include "Profile.h"
 
 #define F_CPU 8000000UL  // 8 MHz
 #include <util/delay.h>
@@ -51,6 +53,7 @@ extern int SoftUart_PutChar_Stream (char var, FILE *stream)
 
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) 
 	{
+		PROFILE_BEGIN (PROFILE_ATOMIC_SOFTUART);
 		while (1)
 		{
 			if ((data&mask)==0)
@@ -68,6 +71,7 @@ extern int SoftUart_PutChar_Stream (char var, FILE *stream)
 		
 			mask = mask << 1;
 		}
+		PROFILE_END (PROFILE_ATOMIC_SOFTUART);
 	}
 	
 	return (0);
@@ -0,0 +1,88 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+ Stack and RAM budget
+ ************************************
+ 
+ See Stack.h.
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include "CoreRegisters.h"
+#include "Trace.h"
+#include "Stack.h"
+
+extern uint8_t __heap_start; // end of static data (.data, .bss and .noinit); avr-libc linker script symbol.
+
+static bool g_Stack_Low;
+
+//---------------------------------------------------------------------------
+// C start-up code section .init3: SP is set and r1 is zero; .data and .bss are not yet initialized. 
+// Not called; naked function code is placed inline in the start-up sequence (no return).
+void Stack_Paint (void) __attribute__ ((naked, used, section (".init3")));
+void Stack_Paint (void)
+{
+	uint8_t *p = &__heap_start;
+	
+	while (p <= (uint8_t *)RAMEND)
+		*p++ = STACK_PAINT;
+}
+//---------------------------------------------------------------------------
+extern uint16_t Stack_Get_Size (void)
+{
+	return ((uint16_t)(RAMEND + 1) - (uint16_t)&__heap_start);
+}
+//---------------------------------------------------------------------------
+extern uint16_t Stack_Get_Unused (void)
+{
+	uint8_t *p = &__heap_start;
+	
+	while ( (p <= (uint8_t *)RAMEND) && (*p == STACK_PAINT) )
+		p++;
+	
+	return ((uint16_t)(p - &__heap_start));
+}
+//---------------------------------------------------------------------------
+extern void Stack_Init (void)
+{
+	uint16_t Size = Stack_Get_Size ();
+	
+	g_Stack_Low = false;
+	printf_P (PSTR("> Stack: %u bytes; static data %u bytes; unused %u bytes \r\n"), Size, (uint16_t)&__heap_start - RAMSTART, Stack_Get_Unused ());
+	if (Size < STACK_BUDGET)
+		printf_P (PSTR("> Stack: *** ERROR *** less than %u bytes \r\n"), STACK_BUDGET);
+}
+//---------------------------------------------------------------------------
+// Call from main loop.
+extern void Stack_BackgroundTask (void)
+{
+	uint8_t i;
+	
+	if (g_Stack_Low)
+		return;
+	
+	for (i = 0; i < STACK_GUARD; i++)
+	{
+		if ((&__heap_start)[i] != STACK_PAINT)
+		{
+			g_Stack_Low = true;
+			Trace_Add (TRACE_STACK_LOW, (uint8_t)Stack_Get_Unused ());
+			break;
+		}
+	}
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,59 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _STACK_H_
+#define _STACK_H_
+
+// Stack and RAM budget (1KB SRAM; static data is placed from RAMSTART, the stack grows down from RAMEND; no heap is used).
+// Build time (see project compiler and linker flags):
+// * -fstack-usage report the stack frame of each function (.su file per object); -Werror=stack-usage=STACK_FRAME_BUDGET fail
+//   the build when a function frame exceed the budget.
+// * the linker data region is limited to RAMEND+1-RAMSTART-STACK_BUDGET bytes (__DATA_REGION_LENGTH__); the link fail
+//   ("region `data' overflowed") when static data leave less than STACK_BUDGET bytes for the stack.
+// Run time:
+// * the free RAM is painted with STACK_PAINT before .data and .bss are initialized; Stack_Get_Unused return the number of 
+//   bytes never used by the stack (high-water mark).
+// * Stack_BackgroundTask add TRACE_STACK_LOW (once) when the stack reach the last STACK_GUARD bytes; the I2C self-test fail
+//   (see I2C_Test.c).
+// Worst case (ISR_PRIORITY 1; see ISR_Priority.h): only the tick is preemptible, so at most one ISR_BLOCK vector nest over it:
+//   main loop (e.g., console command printing)  + tick (no printing)  + one ISR_BLOCK vector (TWI callback; no ISR print)
+// An ISR that call functions push the return address, SREG, r0, r1 and the call-clobbered registers (17 bytes). 
+#define STACK_ISR_CONTEXT	17 // bytes
+#define STACK_PRINTF		48 // bytes; printf_P, vfprintf (printf_min) and the putchar function
+#define STACK_MAIN			(24 + STACK_PRINTF) // bytes; main loop task frames + printing
+#define STACK_TICK			(STACK_ISR_CONTEXT + 32) // bytes; WD_PeriodicTask (WD_Remain, SystemTick_Get_msec), GPI and I2C slave time-out
+#define STACK_ISR			(STACK_ISR_CONTEXT + 8 + STACK_PRINTF) // bytes; TWI callback (device write, EEPROM queue); kept at the printing size, as BADISR_vect print before halting
+#define STACK_BUDGET		192 // bytes; >= STACK_MAIN + STACK_TICK + STACK_ISR (186); must match the linker flag __DATA_REGION_LENGTH__ (0x340 = 1024 - 192)
+#define STACK_FRAME_BUDGET	48 // bytes; must match the compiler flag -Werror=stack-usage= (a quarter of STACK_BUDGET; Boot_Main is exempt, see Boot.c)
+#define STACK_GUARD			8  // bytes
+#define STACK_PAINT			0xC5
+
+// Static data budget (production build: I2C_SELF_TEST 0, FAN_DEVICE 0, ISR_PROFILE 0; bytes), 1024 - STACK_BUDGET = 832:
+//   I2C_Device_SRAM memory (I2C_DEVICE_SRAM_SIZE) + state   261
+//   Trace ring (.noinit)                                       86
+//   I2C slave (bus state with PEC stage, device table)         69
+//   I2C_Device_Status (read buffer and snapshot)               69
+//   BMC watchdog channels                                      60
+//   I2C_Device_EEPROM (read and write buffers)                 45
+//   EEPROM write queue                                         35
+//   event log index                                            35
+//   GPIO, temperature, GPI and ADC devices                     47
+//   stdio (SoftUART stream, __iob)                             21
+//   tick, time stamp, boot request, power-cycle, config, misc  40
+//   total                                                     768 (64 free)
+// EEPROM_MIRROR 1 (see EEPROM_Queue.c) add 254 (mirror 256, no checksum 2): it fit only with I2C_DEVICE_SRAM_SIZE 64 (830; 2 free).
+// An SRAM device of 512 bytes need 256 more, 192 over the free RAM (the link fail); it was the default before the trace,
+// event log index, status snapshot and stack budget were added, and is kept only as a build option (I2C_DEVICE_SRAM_SIZE).
+
+extern void Stack_Init (void); // print stack size and check the budget
+extern void Stack_BackgroundTask (void);
+extern uint16_t Stack_Get_Size (void);   // bytes from the end of static data to RAMEND
+extern uint16_t Stack_Get_Unused (void); // bytes never used since reset
+
+#endif
+
+
@@ -19,6 +19,7 @@ TBD:
 #include <avr/io.h>
 #include <util/atomic.h>
 #include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include "CoreRegisters.h"
@@ -26,11 +27,18 @@ TBD:
 #include "I2C_Device_EEPROM.h"
 #include "I2C_Device_ADC.h"
 #include "I2C_Device_GPI.h"
-#include "TimeStamp.h"
+#include "BMC_WD.h"
+#include "SystemTick.h"
+#include "Seqlock.h"
+#include "ISR_Priority.h"
+#include "Profile.h"
 
-uint32_t g_TimeElapased_msec;
+static volatile uint32_t g_Timer1_Overflow; // Timer1 overflow counter; bits [47:16] of the usec time base.
+static volatile uint32_t g_Timer1_Overflow_msec; // time base at last Timer1 overflow in msec; 
+static volatile uint16_t g_Timer1_Overflow_usec; // and the remainder in usec (0..999).
+static SEQLOCK g_Timer1_Seq; // time base update (see Seqlock.h)
 
-// init for 1 msec tick
+// init for 1 msec tick and for the 1 usec time base
 extern void SystemTick_Init (void)
 {
 	
@@ -38,8 +46,8 @@ extern void SystemTick_Init (void)
 	GTCCR = 0x81; // hold Prescaler at reset
 	TCNT0 = 0;
 	OCR0A = 125-1; // for 1msec tick interrupt
-	TIMSK = 1<<OCIE0A;  // Timer/Counter0 Output Compare Match A Interrupt Enable
-	TIFR = 1<<OCF0A; // clear Output Compare Flag 0 A
+	TIMSK = (1<<OCIE0A) | (1<<TOIE1);  // Timer/Counter0 Output Compare Match A Interrupt Enable; Timer/Counter1 Overflow Interrupt Enable
+	TIFR = (1<<OCF0A) | (1<<TOV1); // clear Output Compare Flag 0 A and Timer/Counter1 Overflow Flag
 	
 	// Normal port operation, OC0A and OC0B are disconnected
 	// Set Clear Timer on Compare Match (CTC) mode mode (TOP==OCRA);
@@ -48,9 +56,121 @@ extern void SystemTick_Init (void)
 	// Clock Select: clkI/O/64. When clkI/O is 8MHz, Counter/Timer clock is 125KHz
 	TCCR0B = 0x03;
 	
+	// Timer/Counter1 configure (time base)
+	CLEAR_BIT_REG (PRR, PRTIM1); // disable Power Reduction Timer/Counter1, if any.
+	TCNT1 = 0;
+	
+	// Normal port operation, OC1A and OC1B are disconnected; Normal mode (TOP==0xFFFF)
+	TCCR1A = 0x00;
+	TCCR1C = 0x00;
+	
+	// Clock Select: clkI/O/8. When clkI/O is 8MHz, Counter/Timer clock is 1MHz (1 usec per count)
+	TCCR1B = 0x02;
+	
 	GTCCR = 0; // release Prescaler.
 	
-	g_TimeElapased_msec = 0;
+	g_Timer1_Overflow = 0;
+	g_Timer1_Overflow_msec = 0;
+	g_Timer1_Overflow_usec = 0;
+	g_Timer1_Seq = 0;
+}
+//---------------------------------------------------------------------------------------------
+extern uint16_t SystemTick_Get_Timer1 (void)
+{
+	uint16_t count;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		count = TCNT1; // 16-bit access must not be interrupted (shared TEMP register)
+	}
+	return (count);
+}
+//---------------------------------------------------------------------------------------------
+// read Timer1 counter with its overflow counter as one consistent 48-bit value; 
+// interrupts are disabled only for the 16-bit counter read.
+static void SystemTick_Read_Time (uint32_t *pOverflow, uint16_t *pCount)
+{
+	uint8_t Seq;
+	
+	do
+	{
+		Seq = SEQLOCK_READ_BEGIN (g_Timer1_Seq);
+		*pCount = SystemTick_Get_Timer1 ();
+		*pOverflow = g_Timer1_Overflow;
+		
+		// Timer1 wrap-around and overflow interrupt is pending (e.g., interrupts are disabled) and not counted yet. 
+		if ( IS_BIT_SET (TIFR, TOV1) && (*pCount < 0x8000) )
+			(*pOverflow)++;
+	} while (SEQLOCK_READ_RETRY (g_Timer1_Seq, Seq));
+}
+//---------------------------------------------------------------------------------------------
+extern uint32_t SystemTick_Get_usec (void)
+{
+	uint32_t overflow;
+	uint16_t count;
+	
+	SystemTick_Read_Time (&overflow, &count);
+	return ((overflow << 16) | count);
+}
+//---------------------------------------------------------------------------------------------
+extern uint64_t SystemTick_Get_usec48 (void)
+{
+	uint32_t overflow;
+	uint16_t count;
+	
+	SystemTick_Read_Time (&overflow, &count);
+	return ((((uint64_t)overflow << 16) | count) & 0xFFFFFFFFFFFFULL);
+}
+//---------------------------------------------------------------------------------------------
+extern uint32_t SystemTick_Get_msec (void)
+{
+	uint32_t msec;
+	uint16_t usec;
+	uint16_t count;
+	uint8_t Seq;
+	
+	do
+	{
+		Seq = SEQLOCK_READ_BEGIN (g_Timer1_Seq);
+		count = SystemTick_Get_Timer1 ();
+		msec = g_Timer1_Overflow_msec;
+		usec = g_Timer1_Overflow_usec;
+		
+		// Timer1 wrap-around and overflow interrupt is pending (e.g., interrupts are disabled) and not counted yet. 
+		if ( IS_BIT_SET (TIFR, TOV1) && (count < 0x8000) )
+		{
+			msec += 65;
+			usec += 536;
+		}
+	} while (SEQLOCK_READ_RETRY (g_Timer1_Seq, Seq));
+	
+	// msec = msec + (usec + count) / 1000; using 16-bit division only (called every 1 msec tick).
+	msec += count / 1000;
+	usec += count % 1000;
+	while (usec >= 1000)
+	{
+		usec -= 1000;
+		msec++;
+	}
+	
+	return (msec);
+}
+//---------------------------------------------------------------------------------------------
+
+// time base overflow; every 65.536 msec
+ISR(TIMER1_OVF_vect, ISR_BLOCK)
+{
+	g_Timer1_Overflow++;
+	
+	// 65536 usec = 65 msec + 536 usec
+	g_Timer1_Overflow_msec += 65;
+	g_Timer1_Overflow_usec += 536;
+	if (g_Timer1_Overflow_usec >= 1000)
+	{
+		g_Timer1_Overflow_usec -= 1000;
+		g_Timer1_Overflow_msec++;
+	}
+	SEQLOCK_WRITE (g_Timer1_Seq);
 }
 
 //uint32_t timeout_1min = 0;
@@ -58,16 +178,12 @@ extern void SystemTick_Init (void)
 // system tick 1msec
 ISR(TIMER0_COMPA_vect, ISR_BLOCK)
 {
-	GPI_PeriodicTask (1);			// Elapsed Time: 1 msec
+	PROFILE_BEGIN (PROFILE_TICK);
+	ISR_LOW_PRIORITY_BEGIN (TIMSK, OCIE0A); // TWI preempt the periodic tasks (see ISR_Priority.h)
 	
-	g_TimeElapased_msec++;
-	if (g_TimeElapased_msec == 10)
-	{
-		I2C_Slave_PeriodicTask (10);	// Elapsed Time: 10 msec
-		WD_PeriodicTask (10);			// Elapsed Time: 10 msec
-		TimeStamp_PeriodicTask (10);	// Elapsed Time: 10 msec
-		g_TimeElapased_msec = 0;
-	}
+	GPI_PeriodicTask (1);			// Elapsed Time: 1 msec
+	WD_PeriodicTask (1);			// Elapsed Time: 1 msec
+	I2C_Slave_PeriodicTask (1);		// Elapsed Time: 1 msec
 	
 	/*
 	timeout_1min++;
@@ -78,6 +194,8 @@ ISR(TIMER0_COMPA_vect, ISR_BLOCK)
 	}
 	*/
 	
+	ISR_LOW_PRIORITY_END (TIMSK, OCIE0A);
+	PROFILE_END (PROFILE_TICK);
 }
 
 
@@ -11,6 +11,14 @@
 
 extern void SystemTick_Init (void);
 
+// Monotonic time base: Timer1 free-running at 1MHz (1 usec per count), extended to 48-bit by counting Timer1 overflows. 
+// All read functions are consistent and may be called from main loop or ISR context; the time base is read via sequence lock
+// (see Seqlock.h), interrupts are disabled only for the 16-bit Timer1 read.
+extern uint16_t SystemTick_Get_Timer1 (void);		// raw Timer1 counter (1 usec resolution, wrap-around every 65.536 msec); use for short measurements (e.g., ISR latency).
+extern uint32_t SystemTick_Get_usec (void);			// time in usec since init; low 32-bit (wrap-around every 71.5 minutes).
+extern uint64_t SystemTick_Get_usec48 (void);		// time in usec since init; full 48-bit (wrap-around every 8.9 years).
+extern uint32_t SystemTick_Get_msec (void);			// time in msec since init; 32-bit (wrap-around every 49.7 days).
+
 #endif
 
 
@@ -8,19 +8,20 @@
 #ifndef _TIME_STAMP_H_
 #define _TIME_STAMP_H_
 
-#define EVENT_MICRO_PORF			0x01 // Micro-controller Power-on Reset occur
-#define EVENT_MICRO_EXTRF			0x02 // Micro-controller External Reset occur
-#define EVENT_MICRO_BORF			0x04 // Micro-controller Brown-out Reset occur
-#define EVENT_MICRO_WDRF			0x08 // Micro-controller Watchdog Reset occur
-#define EVENT_BMC_WD				0x10 // BMC Watchdog Reset issued
-#define EVENT_BMC_RESET_DETECT		0x20 // BMC flash power-cycle issued (duo to BMC reset detected)
-#define EVENT_BMC_ENTER_FUP			0x40 // BMC enter FUP (duo to Host requested)
-#define EVENT_HEARTBEAT				0x80 // generic heartbeat
+// Event codes (0x00..0x1F) 
+#define EVENT_MICRO_PORF			0x00 // Micro-controller Power-on Reset occur; payload: MCUSR
+#define EVENT_MICRO_EXTRF			0x01 // Micro-controller External Reset occur; payload: MCUSR
+#define EVENT_MICRO_BORF			0x02 // Micro-controller Brown-out Reset occur; payload: MCUSR
+#define EVENT_MICRO_WDRF			0x03 // Micro-controller Watchdog Reset occur; payload: MCUSR
+#define EVENT_BMC_WD				0x04 // BMC Watchdog Reset issued; payload: WD channel<<4 | control
+#define EVENT_BMC_RESET_DETECT		0x05 // BMC flash power-cycle issued (duo to BMC reset detected); payload: PINC
+#define EVENT_BMC_ENTER_FUP			0x06 // BMC enter FUP (duo to Host requested); payload: PINC
+#define EVENT_HEARTBEAT				0x07 // generic heartbeat; payload: none on TimeStamp wrap-around, WDTCSR on micro-controller watchdog time-out interrupt
 
-extern void TimeStamp_Reset (void);
-extern void TimeStamp_PeriodicTask (uint32_t ElapsedTime /*msec*/);
-
-extern uint8_t EventType;
+extern void TimeStamp_Reset (void); // restart TimeStamp without logging
+extern void TimeStamp_Event (uint8_t EventCode, uint16_t Payload); // log the event (Payload or EVENTLOG_NO_PAYLOAD) and restart TimeStamp
+extern void TimeStamp_BackgroundTask (void); // EVENT_HEARTBEAT before TimeStamp wrap-around
+extern uint32_t TimeStamp_Get_Linear (void); // msec from last event
 
 #endif
 
@@ -0,0 +1,217 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+ ************************************
+   Crash Trace 
+ ************************************
+ 
+ Small trace ring in .noinit RAM section; it is not cleared by the C start-up code, so it survives
+ watchdog and external resets (but not power-on or brown-out).
+ 
+ * Each entry holds a code, 8-bit data, 16-bit time and a check byte; Trace_Add is cheap enough to be used from ISRs.
+ * On init, the ring header is validated by magic and check byte, and each entry by its check byte. 
+   Invalid entries (e.g., random RAM content after power-on) are dropped.
+ * After a watchdog reset, the trace is frozen (new entries are discarded) to keep the post-mortem trace, 
+   until cleared via Trace_Clear (emulated EEPROM write). 
+ * Trace is readable via Trace_Read (see view format in Trace.h).
+*/
+
+/*
+TBD:
+
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h> // use const and string values stored in flash and not copy them to ram before use them. (see https://www.nongnu.org/avr-libc/user-manual/pgmspace.html)
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "CoreRegisters.h"
+#include "SystemTick.h"
+#include "Trace.h"
+#include "Log.h"
+
+#define TRACE_MAGIC		0x5452 // 'TR'
+#define TRACE_CHECK		0x5A
+
+typedef struct 
+{
+	uint8_t  Code;  // 0: empty entry
+	uint8_t  Data;
+	uint16_t Time;  // usec time base bits [23:8] 
+	uint8_t  Check; // Code ^ Data ^ Time ^ TRACE_CHECK
+} TRACE_ENTRY;
+
+typedef struct 
+{
+	uint16_t Magic;
+	uint8_t  Head;  // next entry to write
+	uint8_t  Flags;
+	uint8_t  Check; // Head ^ Flags ^ TRACE_CHECK
+	TRACE_ENTRY Entry [TRACE_SIZE];
+} TRACE_RING;
+
+static TRACE_RING g_Trace __attribute__ ((section (".noinit")));
+
+uint8_t g_Log_Mask; // log trace entries run-time enable; bit per module (see Log.h)
+static uint8_t g_Log_Error [2]; // last LOG_ERROR not yet printed: code (0: none), data
+
+//---------------------------------------------------------------------------
+static uint8_t Trace_Entry_Check (TRACE_ENTRY *pEntry)
+{
+	return (pEntry->Code ^ pEntry->Data ^ (uint8_t)pEntry->Time ^ (uint8_t)(pEntry->Time>>8) ^ TRACE_CHECK);
+}
+//---------------------------------------------------------------------------
+static void Trace_Update_Header (void)
+{
+	g_Trace.Check = g_Trace.Head ^ g_Trace.Flags ^ TRACE_CHECK;
+}
+//---------------------------------------------------------------------------
+extern void Trace_Clear (void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset ((void*)&g_Trace, 0, sizeof(g_Trace));
+		g_Trace.Magic = TRACE_MAGIC;
+		Trace_Update_Header ();
+	}
+}
+//---------------------------------------------------------------------------
+extern void Trace_Init (uint8_t ResetFlags /*MCUSR*/)
+{
+	uint8_t i, Count = 0;
+	
+	if ( (g_Trace.Magic != TRACE_MAGIC) || (g_Trace.Check != (g_Trace.Head ^ g_Trace.Flags ^ TRACE_CHECK)) || (g_Trace.Head >= TRACE_SIZE) )
+	{
+		Trace_Clear ();
+	}
+	else
+	{
+		for (i = 0; i < TRACE_SIZE; i++)
+		{
+			if ( (g_Trace.Entry[i].Code == 0) || (g_Trace.Entry[i].Check != Trace_Entry_Check (&g_Trace.Entry[i])) )
+				memset ((void*)&g_Trace.Entry[i], 0, sizeof(TRACE_ENTRY)); // drop invalid entry 
+			else
+				Count++;
+		}
+		
+		if (Count != 0)
+			g_Trace.Flags |= TRACE_FLAG_PREV_BOOT;
+		
+		if (ResetFlags & (1<<WDRF))
+			g_Trace.Flags |= TRACE_FLAG_FROZEN;
+			
+		Trace_Update_Header ();
+	}
+	
+	printf_P (PSTR("> Trace init; %u entries from previous boot; flags 0x%02X; \r\n"), Count, g_Trace.Flags);
+	
+	Trace_Add (TRACE_BOOT, ResetFlags);
+}
+//---------------------------------------------------------------------------
+extern void Trace_Add (uint8_t Code, uint8_t Data)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if ((g_Trace.Flags & TRACE_FLAG_FROZEN) == 0)
+		{
+			TRACE_ENTRY *pEntry = &g_Trace.Entry[g_Trace.Head];
+			
+			pEntry->Code = Code;
+			pEntry->Data = Data;
+			pEntry->Time = (uint16_t)(SystemTick_Get_usec () >> 8);
+			pEntry->Check = Trace_Entry_Check (pEntry);
+			
+			g_Trace.Head = (g_Trace.Head + 1) % TRACE_SIZE;
+			Trace_Update_Header ();
+		}
+	}
+}
+//---------------------------------------------------------------------------
+// Read trace view; Offset and Size are in bytes of the view (see Trace.h).
+extern void Trace_Read (uint8_t Offset, uint8_t *pBuffer, uint8_t Size)
+{
+	uint8_t View [TRACE_VIEW_ENTRY_SIZE];
+	uint8_t i, j, Index, Count = 0;
+	uint8_t ViewOffset;
+	
+	memset ((void*)pBuffer, 0xEE, Size); // reserved, beyond the view 
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Index = g_Trace.Head; // oldest entry
+		for (i = 0; i < TRACE_SIZE; i++)
+		{
+			TRACE_ENTRY *pEntry = &g_Trace.Entry[Index];
+			
+			if (pEntry->Code != 0)
+			{
+				View[0] = pEntry->Code;
+				View[1] = pEntry->Data;
+				View[2] = (uint8_t)pEntry->Time;
+				View[3] = (uint8_t)(pEntry->Time>>8);
+				
+				ViewOffset = TRACE_VIEW_HEADER_SIZE + Count*TRACE_VIEW_ENTRY_SIZE;
+				for (j = 0; j < TRACE_VIEW_ENTRY_SIZE; j++, ViewOffset++)
+				{
+					if ( (ViewOffset >= Offset) && (ViewOffset < (uint16_t)Offset + Size) )
+						pBuffer [ViewOffset - Offset] = View[j];
+				}
+				Count++;
+			}
+			Index = (Index + 1) % TRACE_SIZE;
+		}
+		
+		// unused entries are 0 
+		for (ViewOffset = TRACE_VIEW_HEADER_SIZE + Count*TRACE_VIEW_ENTRY_SIZE; ViewOffset < TRACE_VIEW_SIZE; ViewOffset++)
+		{
+			if ( (ViewOffset >= Offset) && (ViewOffset < (uint16_t)Offset + Size) )
+				pBuffer [ViewOffset - Offset] = 0;
+		}
+		
+		View[0] = g_Trace.Flags;
+		View[1] = Count;
+		View[2] = 0;
+		View[3] = 0;
+		for (ViewOffset = 0; ViewOffset < TRACE_VIEW_HEADER_SIZE; ViewOffset++)
+		{
+			if ( (ViewOffset >= Offset) && (ViewOffset < (uint16_t)Offset + Size) )
+				pBuffer [ViewOffset - Offset] = View[ViewOffset];
+		}
+	}
+}
+//---------------------------------------------------------------------------
+// LOG_ERROR (see Log.h); called from ISRs.
+extern void Log_Error (uint8_t Code, uint8_t Data)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		g_Log_Error [0] = Code;
+		g_Log_Error [1] = Data;
+	}
+	if (g_Log_Mask & (1 << ((Code >> 4) & 0x07)))
+		Trace_Add (Code, Data);
+}
+//---------------------------------------------------------------------------
+// Call from main loop; print the last LOG_ERROR.
+extern void Log_BackgroundTask (void)
+{
+	uint8_t Code, Data;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Code = g_Log_Error [0];
+		Data = g_Log_Error [1];
+		g_Log_Error [0] = 0;
+	}
+	
+	if (Code != 0)
+		printf_P (PSTR("> Log error: module %u; id 0x%X; data 0x%02X \r\n"), (Code >> 4) & 0x07, Code & 0x0F, Data);
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#define TRACE_SIZE 16 // number of entries in trace ring
+
+// Trace codes (entry data in brackets)
+#define TRACE_BOOT				0x01 // micro-controller boot (MCUSR)
+#define TRACE_BADISR			0x02 // unexpected interrupt; CPU halted (0)
+#define TRACE_MICRO_WDT			0x03 // micro-controller watchdog time-out interrupt (WDTCSR)
+#define TRACE_STACK_LOW			0x04 // stack reached the guard bytes (unused bytes; see Stack.h)
+#define TRACE_TWI_START			0x10 // I2C start or re-start (address byte)
+#define TRACE_TWI_STOP			0x11 // I2C stop (number of bytes in last buffer)
+#define TRACE_TWI_ERROR			0x12 // I2C bus error or collision (TWSSRA)
+#define TRACE_TWI_TIMEOUT		0x13 // I2C time-out; slave module restart (device index)
+#define TRACE_TWI_RECOVERY		0x14 // I2C SDA held low after time-out; bus recovery (number of SCL clocks)
+#define TRACE_TWI_PEC_ERROR		0x15 // I2C write PEC mismatch (device index)
+#define TRACE_INT0				0x20 // INT0 (SPILOAD#) sequence step (TRACE_INT0_*)
+#define TRACE_WD_START			0x30 // BMC watchdog start (channel<<4 | control)
+#define TRACE_WD_TIMEOUT		0x31 // BMC watchdog time-out (channel<<4 | control)
+#define TRACE_WD_STOP			0x32 // BMC watchdog stop (channel)
+#define TRACE_WD_PRETIMEOUT		0x33 // BMC watchdog pre-timeout INT# asserted (channel)
+
+#define TRACE_INT0_CORST_ASSERT		0x01
+#define TRACE_INT0_BMC_RESET		0x02
+#define TRACE_INT0_HOST_FUP			0x03
+#define TRACE_INT0_FLASH_OFF		0x04
+#define TRACE_INT0_FLASH_ON			0x05
+#define TRACE_INT0_CORST_RELEASE	0x06
+#define TRACE_INT0_DONE				0x07
+
+// Trace codes 0x80..0xFF are binary log entries (see Log.h).
+
+// Trace view (see Trace_Read):
+// * byte 0: flags; bit 0: trace hold entries from before the last reset; bit 1: trace is frozen (after watchdog reset) until cleared.
+// * byte 1: number of valid entries.
+// * byte 2..3: reserved (0).
+// * byte 4..: entries of 4 bytes, oldest first: code, data, time (usec time base bits [23:8], 256 usec units; LSB first).
+#define TRACE_FLAG_PREV_BOOT	0x01
+#define TRACE_FLAG_FROZEN		0x02
+#define TRACE_VIEW_HEADER_SIZE	4
+#define TRACE_VIEW_ENTRY_SIZE	4
+#define TRACE_VIEW_SIZE			(TRACE_VIEW_HEADER_SIZE + TRACE_SIZE*TRACE_VIEW_ENTRY_SIZE)
+
+extern void Trace_Init (uint8_t ResetFlags /*MCUSR*/);
+extern void Trace_Add (uint8_t Code, uint8_t Data);
+extern void Trace_Clear (void);
+extern void Trace_Read (uint8_t Offset, uint8_t *pBuffer, uint8_t Size);
+
+#endif
+
+
@@ -24,12 +24,26 @@
 #include "I2C_Device_ADC.h"
 #include "I2C_Device_GPI.h"
 #include "I2C_Device_SRAM.h"
+#include "I2C_Device_Status.h"
+#include "I2C_Device_Temp.h"
+#include "I2C_Device_GPIO.h"
+#include "I2C_Device_Fan.h"
 #include "SoftUART.h"
+#include "Console.h"
 #include "SystemTick.h"
 #include "TimeStamp.h"
+#include "EEPROM_Queue.h"
+#include "EventLog.h"
+#include "Trace.h"
+#include "Log.h"
+#include "Config.h"
+#include "BMC_WD.h"
+#include "Boot.h"
+#include "I2C_Test.h"
+#include "Stack.h"
+#include "Profile.h"
+#include "PowerCycle.h"
 
-#define F_CPU 8000000UL  // 8 MHz
-#include <util/delay.h>
 
 /*
  * Note:
@@ -45,22 +59,57 @@
 /* offset 0x80 */ static const char string_date[16]        __attribute__((used)) __attribute__ ((section (".vectors"))) = __DATE__;
 /* offset 0x70 */ static const char string_header[16]      __attribute__((used)) __attribute__ ((section (".vectors"))) = "Nuvoton_RunBMC";
 
-#define I2C_Device_EEPROM_Index 0	// Set EEPROM emulated device to I2C address = I2C_Base_Addr + 0
-#define I2C_Device_ADC_Index    1	// Set ADC emulated device to I2C address = I2C_Base_Addr + 1
-#define I2C_Device_GPI_Index    2	// Set GPI emulated device to I2C address = I2C_Base_Addr + 2
-#define I2C_Device_SRAM_Index   3	// Set SRAM emulated device to I2C address = I2C_Base_Addr + 3
+// Default device layout (device index is the I2C address offset from I2C_Base_Addr); may be override by configuration record in EEPROM (see Config.h).
+static MODULE_CONFIG g_Config = 
+{
+	.Layout = 
+	{ 
+		CONFIG_DEV_EEPROM | CONFIG_DEV_ADC<<4,	// I2C_Base_Addr + 0: EEPROM; I2C_Base_Addr + 1: ADC
+		CONFIG_DEV_GPI | CONFIG_DEV_SRAM<<4,	// I2C_Base_Addr + 2: GPI;    I2C_Base_Addr + 3: SRAM
+		CONFIG_DEV_STATUS | CONFIG_DEV_TEMP<<4,	// I2C_Base_Addr + 4: module status (SMBus block read); I2C_Base_Addr + 5: temperature (LM75)
+#if (FAN_DEVICE == 1)
+		CONFIG_DEV_GPIO | CONFIG_DEV_FAN<<4,	// I2C_Base_Addr + 6: GPIO expander (PCA9555); I2C_Base_Addr + 7: fan (EMC2101)
+#else
+		CONFIG_DEV_GPIO,						// I2C_Base_Addr + 6: GPIO expander (PCA9555)
+#endif
+	},
+	.PEC = 0,
+	.TimeOut = I2C_TIME_OUT,
+};
+
+static volatile bool g_WDT_Event; // set by WDT_vect
+static volatile uint8_t g_WDT_WDTCSR;
 
+// Watchdog time-out interrupt report; WDT_vect only trace it, so TWI is not held off by printing.
+static void WDT_BackgroundTask (void)
+{
+	if (! g_WDT_Event)
+		return;
+	
+	g_WDT_Event = false;
+	printf_P (PSTR("> Watchdog Time-out interrupt \r\n"));
+	TimeStamp_Event (EVENT_HEARTBEAT, g_WDT_WDTCSR); // log the even and reset timestamp
+}
 
 int main(void)
 {
+	uint8_t l_MCUSR;
+	
 	CCP = 0xD8; // Configuration Change Protection Register (Timed Sequences)
 	CLKPR = 0; // Set Clock Pre-scale Register to 1.  Use internal 8MHz (CLKPR fuse settings) so CPU clock is 8MHz. 
 	
 	CCP = 0xD8; // Configuration Change Protection Register (Timed Sequences)
 	WDTCSR = (1<<WDE) | (1<<WDP3) |  (1<<WDP0) | (1<<WDIE); // Enable Watchdog Timer for 8 sec; first time-out issue interrupt and next time-out issue chip reset. 
 	
+#if (CONSOLE_USART == 1)
+	Console_Init ();
+#else
 	SoftUart_Init (pgm_read_byte(&UART_PIN));
+#endif
 	SystemTick_Init ();
+	Trace_Init (MCUSR);
+	EventLog_Init ();
+	EEPROM_Queue_Init ();
 	TimeStamp_Reset ();
 
 	// **********************************
@@ -70,22 +119,34 @@ int main(void)
 	printf_P (PSTR("> Build Date: %S; %S. \r\n"), &string_date[0], &string_time[0]);
 	
 	printf_P (PSTR("> MCUSR:0x%02X; WDTCSR:0x%02X;  \r\n"), MCUSR, WDTCSR);
-	EventType = MCUSR & 0x0F;
-	if (EventType & 0x01)
+	l_MCUSR = MCUSR;
+	if (l_MCUSR & (1<<PORF))
+	{
 		printf_P (PSTR("\t* Power-on Reset occurs \r\n"));
+		TimeStamp_Event (EVENT_MICRO_PORF, l_MCUSR);
+	}
 	else 
 	{
-		if (EventType & 0x02)
+		if (l_MCUSR & (1<<EXTRF))
+		{
 			printf_P (PSTR("\t* External Reset occurs \r\n"));
+			TimeStamp_Event (EVENT_MICRO_EXTRF, l_MCUSR);
+		}
 			
-		if (EventType & 0x04)
+		if (l_MCUSR & (1<<BORF))
+		{
 			printf_P (PSTR("\t* Brown-out Reset occurs \r\n"));
+			TimeStamp_Event (EVENT_MICRO_BORF, l_MCUSR);
+		}
 			
-		if (EventType & 0x08)
+		if (l_MCUSR & (1<<WDRF))
+		{
 			printf_P (PSTR("\t* Watchdog Reset occurs \r\n"));
+			TimeStamp_Event (EVENT_MICRO_WDRF, l_MCUSR);
+		}
 	}
-	TimeStamp_Reset ();
 	MCUSR = 0; // clear the value for the next reset cycle. 
+	Stack_Init ();
 	
 	//printf_P (PSTR("> SPH:0x%02X; SPL:0x%02X; SREG:0x%02X; \r\n"), SPH, SPL, SREG);
 	printf_P (PSTR("> CLKSR:0x%02X; CLKPR:0x%02X;  \r\n"), CLKSR, CLKPR);
@@ -95,11 +156,27 @@ int main(void)
 	//printf_P (PSTR("> GIMSK:0x%02X;  \r\n"), GIMSK);
 	//---------------------------------------------------------------------------------------------------------------
 	
-	I2C_Device_EEPROM_Init (I2C_Device_EEPROM_Index);
-	I2C_Device_ADC_Init (I2C_Device_ADC_Index);
-	I2C_Device_GPI_Init (I2C_Device_GPI_Index);
-	I2C_Device_SRAM_Init (I2C_Device_SRAM_Index);
-	I2C_Slave_Init (pgm_read_byte(&I2C_Base_Addr));
+	g_Config.BaseAddr = pgm_read_byte(&I2C_Base_Addr);
+	Config_Load (&g_Config);
+	
+	WD_Init (Config_Get_Index (&g_Config, CONFIG_DEV_EEPROM));
+	I2C_Device_EEPROM_Init (Config_Get_Index (&g_Config, CONFIG_DEV_EEPROM));
+	I2C_Device_ADC_Init (Config_Get_Index (&g_Config, CONFIG_DEV_ADC));
+	I2C_Device_GPI_Init (Config_Get_Index (&g_Config, CONFIG_DEV_GPI));
+	I2C_Device_SRAM_Init (Config_Get_Index (&g_Config, CONFIG_DEV_SRAM));
+	I2C_Device_Status_Init (Config_Get_Index (&g_Config, CONFIG_DEV_STATUS));
+	I2C_Device_Temp_Init (Config_Get_Index (&g_Config, CONFIG_DEV_TEMP));
+	I2C_Device_GPIO_Init (Config_Get_Index (&g_Config, CONFIG_DEV_GPIO));
+#if (FAN_DEVICE == 1)
+	I2C_Device_Fan_Init (Config_Get_Index (&g_Config, CONFIG_DEV_FAN));
+#endif
+	I2C_Slave_Init (g_Config.BaseAddr, Config_Get_Devices (&g_Config));
+	I2C_Slave_Set_TimeOut (g_Config.TimeOut);
+	I2C_Slave_Set_PEC (g_Config.PEC);
+#if (I2C_SELF_TEST == 1)
+	I2C_Test_Init (&g_Config);
+	I2C_Test_Run ();
+#endif
 	
 	// The falling edge of INT0 generates an interrupt request
 	SET_BIT_REG (MCUCR, ISC01);
@@ -114,6 +191,22 @@ int main(void)
 	while (1)
 	{
 		__asm__ __volatile__ ("wdr"); // reset (touch) ATtiny1634 Watchdog
+		EventLog_BackgroundTask ();
+		TimeStamp_BackgroundTask ();
+		WD_BackgroundTask ();
+		PowerCycle_BackgroundTask ();
+		WDT_BackgroundTask ();
+		Log_BackgroundTask ();
+		I2C_Device_Status_BackgroundTask ();
+		I2C_Device_Temp_BackgroundTask ();
+#if (FAN_DEVICE == 1)
+		I2C_Device_Fan_BackgroundTask ();
+#endif
+		Boot_BackgroundTask ();
+		Stack_BackgroundTask ();
+#if (CONSOLE_USART == 1)
+		Console_BackgroundTask ();
+#endif
 	}
 		
 		
@@ -122,100 +215,30 @@ int main(void)
 
 ISR(BADISR_vect, ISR_BLOCK)
 {
+	Trace_Add (TRACE_BADISR, 0);
 	printf_P (PSTR("> BADISR_vect: *** ERROR *** unexpected interrupt occurs; halting the CPU.\r\n"));
 	while (1); // waiting for Watchdog.
 }
 
 ISR(WDT_vect, ISR_BLOCK) 
 {
+	PROFILE_BEGIN (PROFILE_WDT);
 	//If WDE is set, WDIE is automatically cleared by hardware when a time-out occurs. Next time-out will reset. 
-	EventType |= EVENT_HEARTBEAT;
-	printf_P (PSTR("> Watchdog Time-out interrupt \r\n"));	
-	TimeStamp_Reset (); // log the even and reset timestamp
+	Trace_Add (TRACE_MICRO_WDT, WDTCSR);
+	g_WDT_WDTCSR = WDTCSR;
+	g_WDT_Event = true; // printed and logged from main loop (see WDT_BackgroundTask); if main loop is stuck only the trace is left
+	PROFILE_END (PROFILE_WDT);
 }
 
 ISR(INT0_vect, ISR_BLOCK) 
 {
 	//INTF0 is automatically cleared by hardware on Interrupt. 
 	
-	uint8_t l_PINC;
-	
 	// 13/05/2020: Moved core-reset to shorten the time between SPILOAD pulse detect and core reset issued. This to minimized BMC exec time before starting SPI power-cycle. 
 	// CORST_N (PA2)
 	CLEAR_BIT_REG (PORTA, PA2); // set low
 	SET_BIT_REG (DDRA, PA2); // set output
-	printf_P (PSTR("> Asserted BMC CORST# . \r\n"));
-	
-	// Measured: EXTEND_SPILOAD_N pulse: 10 usec generated by nSPILOAD (up to 2V), delay 100 usec 
-	_delay_us (100);   
-	l_PINC = PINC; // read EXTEND_SPILOAD_N (PC2) value. If value is low, this means the host pull HGPIO7 low.  
-	
-	if (IS_BIT_SET (l_PINC, PC2))
-	{
-		printf_P (PSTR("> BMC reset detected. \r\n"));	
-		EventType |= EVENT_BMC_RESET_DETECT;
-		// if FUP feature need to be disabled (not to enter FUP), wait for PINC.2 to goes high before continue. 
-	}
-	else
-	{
-		printf_P (PSTR("> Host force FUP detected. \r\n"));	
-		EventType |= EVENT_BMC_ENTER_FUP;
-	}
-	
-	TimeStamp_Reset (); // log the even and reset timestamp
-	
-	// FWSPI_PWR_EN (PC4)
-	printf_P (PSTR("> Turn-off flash power. \r\n"));	
-	SET_BIT_REG (DDRC, PC4); // set output
-	CLEAR_BIT_REG (PORTC, PC4); // set low   
-	
-	// Measured: SPI power-down slew rate time: 50 usec, use 5msec 
-	
-	printf_P (PSTR("> Wait 5 msec ... \r\n"));
-	_delay_us (5000);
-	
-	// FWSPI_PWR_EN (PC4)
-	printf_P (PSTR("> Turn-on flash power. \r\n"));
-	CLEAR_BIT_REG (DDRC, PC4); // set input (open-drain with external PU)
-	while (! IS_BIT_SET (PINC, PC4)); // wait for FWSPI_PWR_EN goes high. Can be use to extend the delay. 
-	
-	// Measured: SPI power-up slew rate time: 2.3 msec, use 5msec 
-	
-	printf_P (PSTR("> Wait 5 msec  ... \r\n"));
-	_delay_us (5000);
-	
-	// CORST_N (PA2) 
-	printf_P (PSTR("> Release CORST#. \r\n"));
-	CLEAR_BIT_REG (DDRA, PA2); // set input (open-drain with external PU)
-	while (! IS_BIT_SET (PINA, PA2)); // wait for CORST# to goes high. Can be use to extend the delay (maybe other source keep this signal low). 
-	
-	SET_BIT_REG (GIFR, INTF0); // 13/05/2020: Fixed double power-cycle issue on module power-up by clear INTF0 that may set duo to unexpected SPILOAD pulse occur before reset was released.   
-	
-	// Note: ~17 msec internal BMC reset delay before the second SPILOAD pulse and the code running.
-		
-	if (IS_BIT_SET (l_PINC, PC2))
-	{
-		// this valid only in BMC_RESET mode since in ENTER_FUP mode the EXTEND_SPILOAD_N pin keep pull low and can't detect the second pulse. 
-		
-		// There are two method to continue and exist:
-		// 1. Wait 20 msec to pass the ~17 msec internal BMC reset delay and mask the second SPILOAD_N pulse.
-		// 2. Wait for the second pulse on SPILOAD_N after release CORST#. 
-		// If some external signal keep CORST# low, we must use option (2) and wait until the external signal release CORST#; otherwise a nother reset cycle will be ocure (end-less loops of resets) 
-		 
-		// method 2
-		printf_P (PSTR("> Wait for the second pulse on SPILOAD# ... \r\n"));
-		while (! IS_BIT_SET (GIFR, INTF0));
-		
-		/*	
-		// method 1
-		printf_P (PSTR("> Wait 20 msec  ... \r\n"));
-		_delay_us (20000); // wait for end of 17 msec internal reset delay to mask the second SPILOAD pulse, use 20 msec.
-		SET_BIT_REG (GIFR, INTF0); //  Clear INTF0 bit caused by the second SPILOAD pulse.
-		*/
-	}
-	
-	SET_BIT_REG (GIFR, INTF0); //  Clear INTF0 bit caused by the second SPILOAD pulse.
-	printf_P (PSTR("> Done. \r\n"));
-	
-	WD_Stop();
+	PROFILE_BEGIN (PROFILE_INT0); // after CORST# assert, to keep its latency
+	PowerCycle_Start (); // the rest of the power-cycle is run from main loop (see PowerCycle.c)
+	PROFILE_END (PROFILE_INT0);
 }
@@ -0,0 +1,78 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+// Host test helpers: check counter, I2C master driving ISR(TWI_SLAVE_vect) through the stub registers (see stub/avr/io.h)
+// and EEPROM programming driving ISR(EE_READY_vect).
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <util/crc16.h>
+
+extern void TWI_SLAVE_vect (void);
+extern void EE_READY_vect (void);
+extern void eeprom_write_byte (uint8_t *Addr, uint8_t Data);
+
+static int g_Fails;
+
+#define CHECK(c)	do { if (!(c)) { printf ("FAIL %s:%d: %s\r\n", __FILE__, __LINE__, #c); g_Fails++; } } while (0)
+
+//--------------------------------------------------------------------------
+// Master helpers; return the slave response type of the address / data byte (I2C_ACK or I2C_NACK).
+static inline uint8_t Host_Start (uint8_t Addr7, bool Read)
+{
+	TWSSRA = (1<<TWASIF) | (1<<TWAS) | (Read ? (1<<TWDIR) : 0);
+	TWSD = (Addr7 << 1) | Read;
+	TWI_SLAVE_vect ();
+	return ((TWSCRB >> TWAA) & 1);
+}
+static inline uint8_t Host_Write (uint8_t Data)
+{
+	TWSSRA = (1<<TWDIF);
+	TWSD = Data;
+	TWI_SLAVE_vect ();
+	return ((TWSCRB >> TWAA) & 1);
+}
+static inline uint8_t Host_Read (bool PrevNack /*master NACK the previous byte*/)
+{
+	TWSSRA = (1<<TWDIF) | (1<<TWDIR) | (PrevNack ? (1<<TWRA) : 0);
+	TWI_SLAVE_vect ();
+	return (TWSD);
+}
+static inline void Host_Stop (void)
+{
+	TWSSRA = (1<<TWASIF);
+	TWI_SLAVE_vect ();
+}
+static inline uint8_t Host_PEC (uint8_t Crc, const uint8_t *pData, uint8_t Size)
+{
+	while (Size--)
+		Crc = _crc8_ccitt_update (Crc, *pData++);
+	return (Crc);
+}
+//--------------------------------------------------------------------------
+// Program up to Max pending EEPROM bytes (the EEPROM ready interrupt is called while it is enabled).
+static inline void Host_EEPROM_Program (int Max)
+{
+	int n = 0;
+	
+	while ((EECR & (1<<EERIE)) && n < Max)
+	{
+		EE_READY_vect ();
+		if (EECR & (1<<EEPE))
+		{
+			eeprom_write_byte ((uint8_t*)(uintptr_t)EEAR, EEDR);
+			EECR &= ~(1<<EEPE);
+			n++;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */
+
+/*
+************************************************************************
+ Host test: bootloader reset vector take over, image upload and verify (Boot.c is included; its functions are static)
+************************************************************************
+*/
+
+#include "Host_Test.h"
+#include "Boot.c"
+
+#define INIT_WORD		0x0048 // __init word address (vectors and the FW header at 0x70 precede it)
+#define BAD_IRQ_WORD	0x0060 // __bad_interrupt
+#define IMAGE_PAGES		8
+
+//--------------------------------------------------------------------------
+// Image like the avr-gcc crt of the ATtiny1634: 28 vectors of 4 bytes ('jmp k'), then code.
+static void Image_Build (uint8_t *pImage, uint16_t Init)
+{
+	uint16_t i;
+
+	for (i = 0; i < IMAGE_PAGES * SPM_PAGESIZE; i++)
+		pImage[i] = (uint8_t)(i * 13 + Init);
+	for (i = 0; i < 28; i++)
+	{
+		uint16_t Target = (i == 0) ? Init : BAD_IRQ_WORD;
+
+		pImage[i*4 + 0] = (uint8_t)BOOT_JMP;
+		pImage[i*4 + 1] = (uint8_t)(BOOT_JMP >> 8);
+		pImage[i*4 + 2] = (uint8_t)Target;
+		pImage[i*4 + 3] = (uint8_t)(Target >> 8);
+	}
+}
+//--------------------------------------------------------------------------
+// CRC-16 as computed by the host update tool (image as sent)
+static uint16_t Image_CRC (const uint8_t *pImage)
+{
+	uint16_t CRC = 0xFFFF;
+	uint16_t i;
+
+	for (i = 0; i < IMAGE_PAGES * SPM_PAGESIZE; i++)
+		CRC = _crc16_update (CRC, pImage[i]);
+	return (CRC);
+}
+//--------------------------------------------------------------------------
+static uint8_t Upload (const uint8_t *pImage, uint16_t CRC, uint16_t *pAppReset)
+{
+	uint8_t Buffer [BOOT_BUFFER_SIZE];
+	uint16_t Page = 0xFFFF;
+	uint16_t i;
+
+	for (i = 0; i < IMAGE_PAGES; i++)
+	{
+		Buffer[0] = BOOT_CMD_PAGE;
+		Buffer[1] = (uint8_t)i;
+		Buffer[2] = (uint8_t)(i >> 8);
+		memcpy (&Buffer[3], &pImage[i * SPM_PAGESIZE], SPM_PAGESIZE);
+		CHECK (Boot_Command (Buffer, BOOT_BUFFER_SIZE, pAppReset, &Page) == BOOT_STATUS_READY);
+		CHECK (Page == i);
+	}
+
+	Buffer[0] = BOOT_CMD_FINISH;
+	Buffer[1] = IMAGE_PAGES;
+	Buffer[2] = 0;
+	Buffer[3] = (uint8_t)CRC;
+	Buffer[4] = (uint8_t)(CRC >> 8);
+	return (Boot_Command (Buffer, 5, pAppReset, &Page));
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	uint8_t Image [IMAGE_PAGES * SPM_PAGESIZE];
+	uint8_t Buffer [BOOT_BUFFER_SIZE];
+	uint16_t Vector = Boot_Rjmp (0, (uint16_t)(uintptr_t)Boot_Vectors);
+	uint16_t AppReset;
+	uint16_t CRC;
+
+	memset (stub_flash, 0xFF, sizeof (stub_flash));
+	Image_Build (Image, INIT_WORD);
+	memcpy (stub_flash, Image, sizeof (Image));
+
+	// entry from the application: word 0 redirected, 'jmp' target word kept, record valid
+	AppReset = Boot_Take_Over (Buffer);
+	CHECK (AppReset == BOOT_JMP);
+	CHECK (pgm_read_word (0) == Vector);
+	CHECK (pgm_read_word (2) == INIT_WORD);
+	CHECK (memcmp (&stub_flash[4], &Image[4], sizeof (Image) - 4) == 0);
+	CHECK (pgm_read_word (BOOT_RECORD_RESET) == BOOT_JMP);
+	CHECK (pgm_read_word (BOOT_RECORD_VALID) == BOOT_VALID);
+	CHECK (Boot_App_Entry (pgm_read_word (BOOT_RECORD_RESET)) == INIT_WORD);
+
+	// entered again before the application run: the record is kept
+	CHECK (Boot_Take_Over (Buffer) == BOOT_JMP);
+	CHECK (pgm_read_word (0) == Vector);
+
+	// upload of a new image: invalidated by the first page, valid after finish
+	Image_Build (Image, INIT_WORD + 4);
+	CHECK (Upload (Image, Image_CRC (Image), &AppReset) == BOOT_STATUS_VALID);
+	CHECK (pgm_read_word (0) == Vector);
+	CHECK (memcmp (&stub_flash[2], &Image[2], sizeof (Image) - 2) == 0);
+	CHECK (pgm_read_word (BOOT_RECORD_VALID) == BOOT_VALID);
+	CHECK (pgm_read_word (BOOT_RECORD_PAGES) == IMAGE_PAGES);
+	CHECK (pgm_read_word (BOOT_RECORD_CRC) == Image_CRC (Image));
+	CHECK (Boot_App_Entry (pgm_read_word (BOOT_RECORD_RESET)) == INIT_WORD + 4);
+
+	// CRC mismatch (a page corrupted on the bus): not valid
+	Image_Build (Image, INIT_WORD);
+	CRC = Image_CRC (Image);
+	Image[0x80] ^= 1;
+	CHECK (Upload (Image, CRC, &AppReset) == (BOOT_STATUS_READY | BOOT_STATUS_ERROR));
+	Image[0x80] ^= 1;
+	CHECK (pgm_read_word (BOOT_RECORD_VALID) != BOOT_VALID);
+
+	// reset vector into the bootloader area, or not a jump: not valid
+	Image[2] = (uint8_t)(BOOT_START / 2);
+	Image[3] = (uint8_t)((BOOT_START / 2) >> 8);
+	CHECK (Upload (Image, Image_CRC (Image), &AppReset) == (BOOT_STATUS_READY | BOOT_STATUS_ERROR));
+	Image[0] = 0xFF;
+	Image[1] = 0xFF;
+	CHECK (Upload (Image, Image_CRC (Image), &AppReset) == (BOOT_STATUS_READY | BOOT_STATUS_ERROR));
+
+	// 2 bytes vectors ('rjmp'; e.g., -mshort-calls)
+	Image_Build (Image, INIT_WORD);
+	Image[0] = (uint8_t)(0xC000 | (INIT_WORD - 1));
+	Image[1] = (uint8_t)((0xC000 | (INIT_WORD - 1)) >> 8);
+	CHECK (Upload (Image, Image_CRC (Image), &AppReset) == BOOT_STATUS_VALID);
+	CHECK (Boot_App_Entry (pgm_read_word (BOOT_RECORD_RESET)) == INIT_WORD);
+
+	printf ("> Boot host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
@@ -0,0 +1,69 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: configuration record (EEPROM) and the I2C addresses claimed for the device layout
+************************************************************************
+*/
+
+#include <stddef.h>
+#include "Host_Test.h"
+#include "Config.h"
+#include "I2C_Slave.h"
+#include "EEPROM_Queue.h"
+#include "I2C_Device_SRAM.h"
+
+//--------------------------------------------------------------------------
+static void Store (MODULE_CONFIG *pConfig)
+{
+	uint8_t *pData = (uint8_t*)pConfig;
+	uint8_t i;
+	
+	pConfig->CRC = Host_PEC (0, pData, offsetof (MODULE_CONFIG, CRC));
+	for (i = 0; i < sizeof(MODULE_CONFIG); i++)
+		eeprom_write_byte ((uint8_t*)(uintptr_t)(CONFIG_EE_ADDR + i), pData[i]);
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	MODULE_CONFIG Config = {.BaseAddr = 0x74, .Layout = {CONFIG_DEV_EEPROM | CONFIG_DEV_SRAM<<4, CONFIG_DEV_GPI, 0, 0}, .TimeOut = 25};
+	MODULE_CONFIG Active;
+	
+	EEPROM_Queue_Init ();
+	
+	CHECK (Config_Get_Devices (&Config) == 4);
+	Store (&Config);
+	memset (&Active, 0, sizeof(Active));
+	CHECK (Config_Load (&Active) && Active.BaseAddr == 0x74);
+	
+	Config.Layout [2] = CONFIG_DEV_ADC;
+	CHECK (Config_Get_Devices (&Config) == 8);
+	Store (&Config);
+	CHECK (!Config_Load (&Active)); // base address is not aligned to 8 addresses
+	
+	Config.Layout [0] = CONFIG_DEV_EEPROM;
+	Config.Layout [1] = 0;
+	Config.Layout [2] = 0;
+	CHECK (Config_Get_Devices (&Config) == 1);
+	Config.Layout [0] = CONFIG_DEV_SRAM<<4;
+	CHECK (Config_Get_Devices (&Config) == 2);
+	
+	// only the claimed addresses are ACK
+	I2C_Device_SRAM_Init (1);
+	I2C_Slave_Init (0x74, 4);
+	CHECK (TWSAM == (3 << 1));
+	CHECK (Host_Start (0x75, true) == I2C_ACK);
+	Host_Stop ();
+	CHECK (Host_Start (0x70, true) == I2C_NACK);
+	Host_Stop ();
+	CHECK (Host_Start (0x79, true) == I2C_NACK);
+	Host_Stop ();
+	
+	printf ("> Config host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
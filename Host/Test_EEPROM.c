@@ -0,0 +1,197 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: emulated EEPROM batch write (keyed), single byte write authorization, WD registers window
+************************************************************************
+*/
+
+#include "Host_Test.h"
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "EEPROM_Queue.h"
+#include "BMC_WD.h"
+#include "I2C_Device_EEPROM.h"
+#include "Trace.h"
+#include "Log.h"
+
+#define EEPROM_ADDR		0x70
+#define STATUS_ADDR		0x8000 // batch write status (4 bytes; status at byte 3)
+
+//--------------------------------------------------------------------------
+// Return number of NACK bytes.
+static int Write (const uint8_t *pData, uint8_t Size)
+{
+	int Nacks = Host_Start (EEPROM_ADDR, false);
+	
+	while (Size--)
+		Nacks += Host_Write (*pData++);
+	Host_Stop ();
+	return (Nacks);
+}
+//--------------------------------------------------------------------------
+static void Read (uint16_t Addr, uint8_t *pBuffer, uint8_t Size)
+{
+	Host_Start (EEPROM_ADDR, false);
+	Host_Write ((uint8_t)(Addr >> 8));
+	Host_Write ((uint8_t)Addr);
+	Host_Start (EEPROM_ADDR, true);
+	while (Size--)
+		*pBuffer++ = Host_Read (false);
+	Host_Stop ();
+}
+//--------------------------------------------------------------------------
+static uint8_t Read_Status (void)
+{
+	uint8_t Status [4];
+	
+	Read (STATUS_ADDR, Status, sizeof(Status));
+	return (Status [3]);
+}
+//--------------------------------------------------------------------------
+// Batch write: 0x80 0x10 <Addr Hi> <Addr Lo> <Key> <Data 0> ... <Data n>; Key is CRC-8 of address and data (BadKey is XORed).
+static int Batch (uint16_t Addr, const uint8_t *pData, uint8_t Size, uint8_t BadKey)
+{
+	uint8_t Buffer [5 + 32] = {0x80, 0x10, (uint8_t)(Addr >> 8), (uint8_t)Addr};
+	
+	memcpy (&Buffer[5], pData, Size);
+	Buffer [4] = Host_PEC (Host_PEC (0, &Buffer[2], 2), pData, Size) ^ BadKey;
+	return (Write (Buffer, 5 + Size));
+}
+//--------------------------------------------------------------------------
+// Legacy single byte write: authorize the address and data with control writes, then write the byte.
+static int Single (uint16_t Addr, uint8_t Data)
+{
+	const uint8_t Auth [3][3] = {{0x80, 0, (uint8_t)(Addr >> 8)}, {0x80, 1, (uint8_t)Addr}, {0x80, 2, Data}};
+	const uint8_t Byte [3] = {(uint8_t)(Addr >> 8), (uint8_t)Addr, Data};
+	uint8_t i;
+	
+	for (i = 0; i < 3; i++)
+		Write (Auth[i], 3);
+	return (Write (Byte, 3));
+}
+//--------------------------------------------------------------------------
+// return true if the trace ring hold an entry with Code
+static bool Trace_Has (uint8_t Code)
+{
+	uint8_t View [TRACE_VIEW_SIZE];
+	uint8_t i;
+	
+	Trace_Read (0, View, sizeof(View));
+	for (i = 0; i < View[1]; i++)
+	{
+		if (View [TRACE_VIEW_HEADER_SIZE + i*TRACE_VIEW_ENTRY_SIZE] == Code)
+			return (true);
+	}
+	return (false);
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	uint8_t Data [20], Buffer [16];
+	uint8_t i;
+	
+	Trace_Init (0);
+	EEPROM_Queue_Init ();
+	WD_Init (0);
+	I2C_Device_EEPROM_Init (0);
+	I2C_Slave_Init (0x70, 1);
+	
+	// batch write is read back (pending bytes) before and after it is programmed
+	for (i = 0; i < 16; i++)
+		Data [i] = 0xA0 + i;
+	CHECK (Batch (0x40, Data, 16, 0) == 0);
+	CHECK (Read_Status () == 0x10);
+	Read (0x40, Buffer, 16);
+	CHECK (Buffer[0] == 0xA0 && Buffer[15] == 0xAF);
+	Host_EEPROM_Program (1000);
+	Read (0x40, Buffer, 16);
+	CHECK (Buffer[0] == 0xA0 && Buffer[15] == 0xAF);
+	
+	// wrong key: nothing is written
+	Data [0] = 0x11;
+	Batch (0x40, Data, 4, 1);
+	CHECK (Read_Status () == 0x80);
+	Host_EEPROM_Program (1000);
+	Read (0x40, Buffer, 4);
+	CHECK (Buffer[0] == 0xA0);
+	CHECK (! Trace_Has (0x80 | LOG_ID_EEPROM<<4 | LOG_EEPROM_BATCH_KEY)); // log trace entries are disabled after reset
+	Log_BackgroundTask (); // printed
+	g_Log_Mask = 1<<LOG_ID_EEPROM;
+	Batch (0x40, Data, 4, 1);
+	CHECK (Trace_Has (0x80 | LOG_ID_EEPROM<<4 | LOG_EEPROM_BATCH_KEY));
+	g_Log_Mask = 0;
+	Log_BackgroundTask ();
+	
+	// too long (17 bytes) and out of range
+	memset (Data, 0, sizeof(Data));
+	CHECK (Batch (0x40, Data, 17, 0) == 1);
+	CHECK (Read_Status () == 0x80);
+	Batch (0x30, Data, 4, 0);
+	CHECK (Read_Status () == 0x80);
+	
+	// all or nothing: a batch running past 0x7F writes none of its bytes
+	for (i = 0; i < 16; i++)
+		Data [i] = 0x30 + i;
+	Batch (0x78, Data, 16, 0);
+	CHECK (Read_Status () == 0x80);
+	CHECK (EEPROM_Queue_Pending () == 0);
+	Read (0x78, Buffer, 8);
+	CHECK (Buffer[0] != 0x30 && Buffer[7] != 0x37);
+	
+	// all or nothing: WD channel 1 pre-timeout, then the read-only key; the pre-timeout is not written
+	Read (0x3115, Buffer, 2);
+	Data [0] = Buffer[0] ^ 0xFF; Data [1] = Buffer[1] ^ 0xFF; Data [2] = 0;
+	Batch (0x3115, Data, 3, 0);
+	CHECK (Read_Status () == 0x80);
+	Read (0x3115, Data + 8, 2);
+	CHECK (Data[8] == Buffer[0] && Data[9] == Buffer[1]);
+	
+	// WD channel 1 time-out through batch write of the WD registers window
+	Data [0] = 0x10; Data [1] = 0x27; Data [2] = 0; Data [3] = 0;
+	Batch (0x3111, Data, 4, 0);
+	CHECK (Read_Status () == 0x04);
+	
+	// legacy single byte write
+	CHECK (Single (0x50, 0x77) == 0);
+	Host_EEPROM_Program (1000);
+	Read (0x50, Buffer, 1);
+	CHECK (Buffer[0] == 0x77);
+	
+	// queue full: single byte write is NACK
+	for (i = 0; i < 16; i++)
+		Data [i] = i;
+	Batch (0x40, Data, 16, 0);
+	Batch (0x50, Data, 16, 0);
+	CHECK (Single (0x60, 0x99) == 1);
+	Host_EEPROM_Program (1000);
+	
+	// read-only WD register: NACK
+	CHECK (Single (0x311F, 1) == 1);
+	
+#if (EEPROM_MIRROR == 1)
+	// a byte is programming (EEPE set): the window and the check do not wait for it (RAM mirror)
+	for (i = 0; i < 4; i++)
+		Data [i] = 0xC0 + i;
+	CHECK (Batch (0x44, Data, 4, 0) == 0);
+	SET_BIT_REG (EECR, EEPE);
+	Read (0x42, Buffer, 8);
+	CHECK (Buffer[2] == 0xC0 && Buffer[5] == 0xC3 && Buffer[6] == 0x08);
+	CHECK (EEPROM_Queue_Check () == EEPROM_CHECK_BUSY);
+	CLEAR_BIT_REG (EECR, EEPE);
+	Host_EEPROM_Program (1000);
+#endif
+	
+	// consistency check of the programmed content
+	CHECK (EEPROM_Queue_Check () == EEPROM_CHECK_OK);
+	eeprom_write_byte ((uint8_t*)0x41, EEPROM_Queue_Read (0x41) ^ 0x01); // not through the queue
+	CHECK (EEPROM_Queue_Check () == EEPROM_CHECK_MISMATCH);
+	
+	printf ("> EEPROM host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
@@ -0,0 +1,134 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: event log records (pending and programmed), decoded view, recovery after reset and clear
+************************************************************************
+*/
+
+#include "Host_Test.h"
+#include "EEPROM_Queue.h"
+#include "EventLog.h"
+
+#define ENTRY_SIZE		EVENTLOG_DECODED_ENTRY_SIZE
+#define LOG_SIZE		(EVENTLOG_DECODED_ENTRIES * ENTRY_SIZE)
+
+static uint8_t g_Entry [ENTRY_SIZE];
+
+//--------------------------------------------------------------------------
+static uint8_t *Entry (uint8_t Index)
+{
+	EventLog_Read_Decoded (Index * ENTRY_SIZE, g_Entry, ENTRY_SIZE);
+	return (g_Entry);
+}
+//--------------------------------------------------------------------------
+static uint32_t Entry_Time (const uint8_t *pEntry)
+{
+	uint32_t Time;
+	
+	memcpy (&Time, &pEntry[4], sizeof(Time));
+	return (Time);
+}
+//--------------------------------------------------------------------------
+// stored time: exact up to 1023 msec, then rounded down by less than 0.2% (see EventLog.c record format)
+static bool Time_Match (const uint8_t *pEntry, uint32_t Time)
+{
+	uint32_t Stored = Entry_Time (pEntry);
+	
+	return ( (Stored <= Time) && (Time - Stored <= Time / 512) && ((Time > 1023) || (Stored == Time)) );
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	uint8_t Log [LOG_SIZE], Copy [LOG_SIZE];
+	uint8_t *pEntry;
+	int i, Count;
+	
+	EEPROM_Queue_Init ();
+	EventLog_Init ();
+	
+	// pending records are decoded before they are programmed
+	EventLog_Add (1, 0, EVENTLOG_NO_PAYLOAD);
+	EventLog_Add (2, 1234, 0x85);
+	EventLog_Add (3, 4000000000u, 0x12);
+	pEntry = Entry (0);
+	CHECK (pEntry[0] == 3 && pEntry[2] == 0x12 && Time_Match (pEntry, 4000000000u));
+	pEntry = Entry (1);
+	CHECK (pEntry[0] == 2 && pEntry[1] == EVENTLOG_DECODED_FLAG_PAYLOAD && pEntry[2] == 0x85 && Time_Match (pEntry, 1234));
+	pEntry = Entry (2);
+	CHECK (pEntry[0] == 1 && pEntry[1] == 0 && Time_Match (pEntry, 0));
+	CHECK (Entry (3)[0] == 0xFF);
+	Host_EEPROM_Program (100000);
+	
+	// ring wraparound; newest first
+	for (i = 0; i < 60; i++)
+	{
+		EventLog_Add (i % 30, i * 1000, i);
+		Host_EEPROM_Program (100000);
+		EventLog_BackgroundTask (); // flash spill archive (EVENTLOG_FLASH_PAGES > 0)
+	}
+	EventLog_Read_Decoded (0, Log, LOG_SIZE - 1);
+	for (i = 0, Count = 0; i < EVENTLOG_DECODED_ENTRIES; i++)
+	{
+		if (Log[i * ENTRY_SIZE] == 0xFF)
+			continue;
+		Count++;
+		CHECK (Log[i * ENTRY_SIZE] == (59 - i) % 30 && Time_Match (&Log[i * ENTRY_SIZE], (59 - i) * 1000));
+	}
+	CHECK (Count >= 20);
+	
+	// decoded from EEPROM after reset; read at any offset
+	EventLog_Init ();
+	EventLog_Read_Decoded (0, Copy, LOG_SIZE - 1);
+	CHECK (memcmp (Log, Copy, LOG_SIZE - 1) == 0);
+	EventLog_Read_Decoded (12, Copy, 16);
+	CHECK (memcmp (Copy, &Log[12], 16) == 0);
+	
+	// reset in the middle of a record: body and new end marker are programmed, the header is not
+	EventLog_Add (7, 300000000u, 0x44);
+	Host_EEPROM_Program (4);
+	EventLog_Init ();
+	Host_EEPROM_Program (100000);
+	EventLog_Read_Decoded (0, Copy, LOG_SIZE - 1);
+	CHECK (memcmp (Log, Copy, (Count - 2) * ENTRY_SIZE) == 0); // the orphan bytes overwrite the oldest records
+	EventLog_Add (8, 5, EVENTLOG_NO_PAYLOAD);
+	Host_EEPROM_Program (100000);
+	pEntry = Entry (0);
+	CHECK (pEntry[0] == 8 && Time_Match (pEntry, 5));
+	CHECK (Entry (1)[0] == 59 % 30);
+	EventLog_Init ();
+	CHECK (Entry (0)[0] == 8);
+	CHECK (Entry (1)[0] == 59 % 30);
+	
+	// time encoding boundaries (1 byte up to 127 msec, then 2 bytes)
+	{
+		static const uint32_t Times [] = {127, 128, 511, 512, 1023, 1024, 1025, 60000, 86400000, 0xFFFFFFFF};
+		
+		for (i = 0; i < (int)(sizeof(Times) / sizeof(Times[0])); i++)
+		{
+			EventLog_Add (10, Times[i], 0x80 | i);
+			Host_EEPROM_Program (100000);
+			pEntry = Entry (0);
+			CHECK (pEntry[0] == 10 && pEntry[2] == (0x80 | i) && Time_Match (pEntry, Times[i]));
+		}
+	}
+	
+	// clear
+	CHECK (EventLog_Clear ());
+	CHECK (Entry (0)[0] == 0xFF);
+	EventLog_Add (9, 77, EVENTLOG_NO_PAYLOAD);
+	CHECK (Entry (0)[0] == 9);
+	CHECK (Entry (1)[0] == 0xFF);
+	Host_EEPROM_Program (100000);
+	EventLog_Init ();
+	CHECK (Entry (0)[0] == 9);
+	CHECK (Entry (1)[0] == 0xFF);
+	
+	printf ("> EventLog host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
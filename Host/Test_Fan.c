@@ -0,0 +1,177 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: fan device (FAN_DEVICE == 1) PWM, tach and the pins shared with the GPIO expander
+************************************************************************
+ 
+ Timer1 (1 usec per count) is advanced by the test; overflow, compare and tach pin change interrupts are called directly.
+*/
+
+#include "Host_Test.h"
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "SystemTick.h"
+#include "I2C_Device_Fan.h"
+#include "I2C_Device_GPIO.h"
+
+#define FAN_ADDR	0x70
+#define GPIO_ADDR	0x71
+
+extern void TIMER1_OVF_vect (void);
+extern void TIMER1_COMPA_vect (void);
+extern void PCINT2_vect (void);
+
+static uint32_t g_Time; // usec
+
+//--------------------------------------------------------------------------
+static void Advance (uint32_t usec)
+{
+	uint32_t Next = g_Time + usec;
+	
+	if ((Next >> 16) != (g_Time >> 16))
+	{
+		TCNT1 = 0;
+		TIMER1_OVF_vect ();
+		TIFR = 0;
+	}
+	g_Time = Next;
+	TCNT1 = (uint16_t)g_Time;
+}
+//--------------------------------------------------------------------------
+// run the main loop for msec with a tach falling edge every Period usec.
+static void Run (uint32_t msec, uint32_t Period)
+{
+	uint32_t End = g_Time + msec * 1000;
+	uint32_t Edge = g_Time + Period;
+	uint32_t Step;
+	
+	while (g_Time < End)
+	{
+		Step = Edge - g_Time;
+		if (Step > End - g_Time)
+			Step = End - g_Time;
+		if (Step > 1000)
+			Step = 1000;
+		Advance (Step);
+		if (g_Time == Edge)
+		{
+			PINC = 0;
+			PCINT2_vect ();
+			PINC = 1;
+			PCINT2_vect ();
+			Edge += Period;
+		}
+		I2C_Device_Fan_BackgroundTask ();
+	}
+}
+//--------------------------------------------------------------------------
+static void Write (uint8_t Addr7, const uint8_t *pData, uint8_t Size)
+{
+	Host_Start (Addr7, false);
+	while (Size--)
+		Host_Write (*pData++);
+	Host_Stop ();
+}
+//--------------------------------------------------------------------------
+static uint8_t Read (uint8_t Addr7, uint8_t Reg, uint8_t *pBuffer, uint8_t Size)
+{
+	uint8_t i;
+	
+	Host_Start (Addr7, false);
+	Host_Write (Reg);
+	Host_Start (Addr7, true);
+	for (i = 0; i < Size; i++)
+		pBuffer [i] = Host_Read (false);
+	Host_Stop ();
+	return (pBuffer [0]);
+}
+//--------------------------------------------------------------------------
+static void Set (uint8_t Setting)
+{
+	const uint8_t Data [2] = {FAN_REG_SETTING, Setting};
+	
+	Write (FAN_ADDR, Data, sizeof(Data));
+}
+//--------------------------------------------------------------------------
+static uint16_t Tach (void)
+{
+	uint8_t Buffer [2];
+	
+	Read (FAN_ADDR, FAN_REG_TACH_LSB, Buffer, 2);
+	return (Buffer[0] | Buffer[1] << 8);
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	const uint8_t Out0 [] = {GPIO_REG_OUTPUT0, 0x00, 0xFF}, Config0 [] = {GPIO_REG_CONFIG0, 0x00, 0xFF};
+	const uint8_t Pointer [] = {FAN_REG_TACH_LSB, 5};
+	uint8_t Buffer [3];
+	uint16_t Compare;
+	
+	SystemTick_Init ();
+	TIFR = 0;
+	I2C_Device_Fan_Init (0);
+	I2C_Device_GPIO_Init (1);
+	I2C_Slave_Init (FAN_ADDR, 2);
+	
+	// full speed until the host take control
+	CHECK (IS_BIT_SET (DDRB, PB3) && IS_BIT_SET (PORTB, PB3) && IS_BIT_CLEARED (TIMSK, OCIE1A));
+	CHECK (Read (FAN_ADDR, FAN_REG_PRODUCT_ID, Buffer, 3) == 0x16 && Buffer[1] == 0x5D && Buffer[2] == 0x01);
+	CHECK (Read (FAN_ADDR, FAN_REG_SETTING, Buffer, 1) == FAN_SETTING_MAX);
+	
+	// tach
+	CHECK (Tach () == 0xFFFF);
+	Run (2100, 10000);
+	CHECK (Tach () == 1800);
+	Run (2100, 5000);
+	CHECK (Tach () == 900);
+	Run (2000, 3000000);
+	CHECK (Tach () == 0xFFFF);
+	
+	// PWM edges
+	Set (16);
+	CHECK (IS_BIT_SET (TIMSK, OCIE1A) && TCCR1A == (1<<COM1A0));
+	CHECK (Read (FAN_ADDR, FAN_REG_SETTING, Buffer, 1) == 16);
+	Compare = OCR1A;
+	PINB |= 1<<PB3;
+	TIMER1_COMPA_vect ();
+	CHECK ((uint16_t)(OCR1A - Compare) == 16 * FAN_PWM_STEP);
+	Compare = OCR1A;
+	PINB &= ~(1<<PB3);
+	TIMER1_COMPA_vect ();
+	CHECK ((uint16_t)(OCR1A - Compare) == (FAN_SETTING_MAX - 16) * FAN_PWM_STEP);
+	
+	// late compare interrupt (more than the high time): next edge is scheduled from the current count, not a Timer1 period later
+	Set (1);
+	Compare = OCR1A;
+	TCNT1 = Compare + 200;
+	PINB |= 1<<PB3;
+	TIMER1_COMPA_vect ();
+	CHECK ((int16_t)(OCR1A - TCNT1) > 0 && (int16_t)(OCR1A - TCNT1) <= 16);
+	TCNT1 = (uint16_t)g_Time;
+	
+	Set (0);
+	CHECK (IS_BIT_CLEARED (TIMSK, OCIE1A) && TCCR1A == 0 && IS_BIT_CLEARED (PORTB, PB3));
+	Set (200);
+	CHECK (Read (FAN_ADDR, FAN_REG_SETTING, Buffer, 1) == FAN_SETTING_MAX && IS_BIT_SET (PORTB, PB3));
+	Write (FAN_ADDR, Pointer, sizeof(Pointer)); // read-only register
+	CHECK (Read (FAN_ADDR, FAN_REG_SETTING, Buffer, 1) == FAN_SETTING_MAX);
+	CHECK (Read (FAN_ADDR, 0x10, Buffer, 1) == 0);
+	
+	// GPIO expander does not change the PWM (PB3) and tach (PC0) pins
+	Write (GPIO_ADDR, Out0, sizeof(Out0));
+	Write (GPIO_ADDR, Config0, sizeof(Config0));
+	CHECK (IS_BIT_SET (DDRB, PB3) && IS_BIT_SET (PORTB, PB3));
+	CHECK (IS_BIT_CLEARED (DDRC, PC0));
+	CHECK (DDRA == 0xF8 && (PORTA & 0xF8) == 0);
+	CHECK ((Read (GPIO_ADDR, GPIO_REG_INPUT0, Buffer, 1) & 0xC0) == 0);
+	
+	printf ("> Fan host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
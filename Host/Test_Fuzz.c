@@ -0,0 +1,218 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: I2C fuzzing of all emulated devices
+************************************************************************
+
+ Two drivers of the same transaction engine (simulated master; see I2C_Slave.h):
+ * I2C_Test_Fuzz (see I2C_Test.h) with writes to all devices (I2C_TEST_FUZZ_ALL == 1), including EEPROM programming, WD 
+   registers, GPIO and boot request; the register stubs take the side effects.
+ * LLVMFuzzerTestOneInput: bus events decoded from the input bytes (see Fuzz_Event). Built with libFuzzer by 'make fuzz' 
+   (clang; HOST_LIBFUZZER); otherwise main replay the files given in the command line or run random inputs.
+ The engine state is checked after each event (abort on failure, so libFuzzer keep the input).
+*/
+
+#include <stdlib.h>
+#include "Host_Test.h"
+#include "Config.h"
+#include "I2C_Slave.h"
+#include "I2C_Test.h"
+#include "EEPROM_Queue.h"
+#include "Trace.h"
+#include "EventLog.h"
+#include "BMC_WD.h"
+#include "I2C_Device_EEPROM.h"
+#include "I2C_Device_GPI.h"
+#include "I2C_Device_SRAM.h"
+#include "I2C_Device_Status.h"
+#include "I2C_Device_Temp.h"
+#include "I2C_Device_GPIO.h"
+#include "I2C_Device_Fan.h"
+
+#define FUZZ_RUNS		50		// I2C_Test_Fuzz seeds
+#define FUZZ_EVENTS		20000	// I2C_Test_Fuzz events per seed
+#define FUZZ_INPUTS		2000	// random inputs (without libFuzzer)
+#define FUZZ_INPUT_SIZE	256		// max random input size
+
+// ADC is not included; conversion (ADSC) is not emulated by the register stubs.
+static MODULE_CONFIG g_Config = 
+{
+	.BaseAddr = 0x70, 
+	.Layout = 
+	{
+		CONFIG_DEV_EEPROM, 
+		CONFIG_DEV_GPI | CONFIG_DEV_SRAM<<4, 
+		CONFIG_DEV_STATUS | CONFIG_DEV_TEMP<<4, 
+#if (FAN_DEVICE == 1)
+		CONFIG_DEV_GPIO | CONFIG_DEV_FAN<<4,
+#else
+		CONFIG_DEV_GPIO,
+#endif
+	},
+};
+static bool g_Init;
+
+//--------------------------------------------------------------------------
+static void Fuzz_Init (void)
+{
+	uint16_t i;
+	
+	if (g_Init)
+		return;
+	g_Init = true;
+	
+	for (i = 0; i < sizeof(stub_flash); i++)
+		stub_flash [i] = (uint8_t)(i*7 + 3);
+	PINA = 0x28;
+	PINB = 0x08;
+	PINC = 0x01;
+	
+	Trace_Init (0);
+	EEPROM_Queue_Init ();
+	EventLog_Init ();
+	WD_Init (Config_Get_Index (&g_Config, CONFIG_DEV_EEPROM));
+	I2C_Device_EEPROM_Init (Config_Get_Index (&g_Config, CONFIG_DEV_EEPROM));
+	I2C_Device_GPI_Init (Config_Get_Index (&g_Config, CONFIG_DEV_GPI));
+	I2C_Device_SRAM_Init (Config_Get_Index (&g_Config, CONFIG_DEV_SRAM));
+	I2C_Device_Status_Init (Config_Get_Index (&g_Config, CONFIG_DEV_STATUS));
+	I2C_Device_Temp_Init (Config_Get_Index (&g_Config, CONFIG_DEV_TEMP));
+	I2C_Device_GPIO_Init (Config_Get_Index (&g_Config, CONFIG_DEV_GPIO));
+#if (FAN_DEVICE == 1)
+	I2C_Device_Fan_Init (Config_Get_Index (&g_Config, CONFIG_DEV_FAN));
+#endif
+	I2C_Slave_Init (g_Config.BaseAddr, Config_Get_Devices (&g_Config));
+	I2C_Slave_Set_TimeOut (25);
+	I2C_Test_Init (&g_Config);
+}
+//--------------------------------------------------------------------------
+// Input: sequence of events; event type in bits 7..5 of the first byte, some events use the next byte.
+// * 0: start / re-start; next byte: bit 7 set: any address (bits 6..0), otherwise emulated device (bits 3..1); bit 0: read.
+// * 1, 2: data write (next byte); ignored without open write transaction.
+// * 3: data read; bit 0: master NACK the previous byte; ignored without open read transaction.
+// * 4: stop; 5: bus error; 6: time-out (next byte: elapsed msec).
+// * 7: PEC enable mask (next byte) between transactions, and program up to bits 4..0 pending EEPROM bytes.
+int LLVMFuzzerTestOneInput (const uint8_t *pData, size_t Size)
+{
+	const uint8_t *pEnd = pData + Size;
+	uint8_t Addr = 0; // address byte of the open transaction; 0: none
+	uint8_t Event, Next;
+	
+	Fuzz_Init ();
+	I2C_Sim_Begin ();
+	
+	while (pData < pEnd)
+	{
+		Event = *pData++;
+		Next = (pData < pEnd) ? *pData : 0;
+		
+		switch (Event >> 5)
+		{
+			case 0:
+				pData++;
+				Addr = (Next & 0x80) ? (Next & 0x7F) : (g_Config.BaseAddr + ((Next >> 1) & (I2C_DEVICES-1)));
+				Addr = Addr<<1 | (Next & I2C_RD);
+				if (I2C_Sim_Start (Addr) == I2C_NACK)
+					Addr = 0;
+				break;
+				
+			case 1:
+			case 2:
+				pData++;
+				if ( (Addr != 0) && !(Addr & I2C_RD) )
+					I2C_Sim_Write (Next);
+				break;
+				
+			case 3:
+				if (Addr & I2C_RD)
+					I2C_Sim_Read (Event & 1);
+				break;
+				
+			case 4:
+				I2C_Sim_Stop ();
+				Addr = 0;
+				break;
+				
+			case 5:
+				I2C_Sim_Error ();
+				Addr = 0;
+				break;
+				
+			case 6:
+				pData++;
+				if (I2C_Sim_TimeOut (Next))
+					Addr = 0;
+				break;
+				
+			default:
+				pData++;
+				if (Addr == 0)
+					I2C_Slave_Set_PEC (Next);
+				Host_EEPROM_Program (Event & 0x1F);
+				break;
+		}
+		
+		CHECK (I2C_Sim_Check ());
+		if (g_Fails)
+		{
+			printf ("FAIL: engine state; event 0x%02X, address byte 0x%02X\r\n", Event, Addr);
+			abort ();
+		}
+	}
+	
+	I2C_Sim_Stop ();
+	I2C_Sim_End ();
+	I2C_Slave_Set_PEC (0);
+	return (0);
+}
+//--------------------------------------------------------------------------
+#ifndef HOST_LIBFUZZER
+int main (int argc, char *argv[])
+{
+	static uint8_t Input [FUZZ_INPUT_SIZE];
+	uint16_t Random = 0xACE1;
+	size_t Size;
+	int i;
+	
+	Fuzz_Init ();
+	
+	if (argc > 1)
+	{ // replay (e.g., libFuzzer crash file)
+		for (i = 1; i < argc; i++)
+		{
+			FILE *pFile = fopen (argv[i], "rb");
+			
+			CHECK (pFile != NULL);
+			if (pFile == NULL)
+				continue;
+			Size = fread (Input, 1, sizeof(Input), pFile);
+			fclose (pFile);
+			LLVMFuzzerTestOneInput (Input, Size);
+		}
+		return (g_Fails);
+	}
+	
+	for (i = 1; i <= FUZZ_RUNS; i++)
+		g_Fails += I2C_Test_Fuzz ((uint16_t)(i * 0x9E37u), FUZZ_EVENTS);
+	
+	for (i = 0; i < FUZZ_INPUTS; i++)
+	{
+		for (Size = 0; Size < sizeof(Input); Size++)
+		{ // xorshift (7, 9, 8)
+			Random ^= Random << 7;
+			Random ^= Random >> 9;
+			Random ^= Random << 8;
+			Input [Size] = (uint8_t)Random;
+		}
+		LLVMFuzzerTestOneInput (Input, 1 + Random % sizeof(Input));
+	}
+	
+	printf ("> Fuzz host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
+#endif
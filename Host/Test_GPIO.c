@@ -0,0 +1,93 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: emulated GPIO expander (PCA9555) registers and pins
+************************************************************************
+*/
+
+#include "Host_Test.h"
+#include "I2C_Slave.h"
+#include "I2C_Device_GPIO.h"
+
+#define GPIO_ADDR	0x20
+#define GPIO_DDRB	(DDRB & ~(1<<PB2)) // INT# (PB2) is owned by the I2C slave module
+
+//--------------------------------------------------------------------------
+static void Write (const uint8_t *pData, uint8_t Size)
+{
+	Host_Start (GPIO_ADDR, false);
+	while (Size--)
+		Host_Write (*pData++);
+	Host_Stop ();
+}
+//--------------------------------------------------------------------------
+static void Read (uint8_t Cmd, uint8_t *pBuffer, uint8_t Size)
+{
+	Host_Start (GPIO_ADDR, false);
+	Host_Write (Cmd);
+	Host_Start (GPIO_ADDR, true);
+	while (Size--)
+		*pBuffer++ = Host_Read (false);
+	Host_Stop ();
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	const uint8_t Out0 [] = {GPIO_REG_OUTPUT0, 0xA5, 0xFE}, Config0 [] = {GPIO_REG_CONFIG0, 0x00, 0xFE};
+	const uint8_t Release1 [] = {GPIO_REG_OUTPUT1, 0xFF}, Config1 [] = {GPIO_REG_CONFIG1, 0xFB, 0xF8};
+	const uint8_t Assert1 [] = {GPIO_REG_OUTPUT1, 0xFB}, Polarity [] = {GPIO_REG_POLARITY0, 0xFF, 0x00, 0x0F, 0x00};
+	const uint8_t HighCmd [] = {0x80 | GPIO_REG_OUTPUT0, 0x3C};
+	uint8_t Buffer [4];
+	
+	I2C_Device_GPIO_Init (0);
+	I2C_Slave_Init (GPIO_ADDR, 1);
+	CHECK (DDRA == 0 && GPIO_DDRB == 0 && DDRC == 0);
+	Read (GPIO_REG_CONFIG0, Buffer, 4);
+	CHECK (Buffer[0] == 0xFF && Buffer[1] == 0xFF && Buffer[2] == 0xFF);
+	
+	// output value is set while the pins are inputs; port 1 P1.0 (CORST#) is asserted
+	Write (Out0, sizeof(Out0));
+	CHECK (DDRA == 0);
+	Write (Config0, sizeof(Config0));
+	CHECK (DDRA == (0xF8 | 0x04) && (PORTA & 0xF8) == ((0xA5 & 0x1F) << 3));
+	CHECK (GPIO_DDRB == 0x09 && (PORTB & 0x09) == 0x01);
+	CHECK (DDRC == 0x01 && (PORTC & 0x01) == 0x01);
+	
+	// input registers; continues read toggle between the pair
+	PINA = 0x28;
+	PINB = 0x08;
+	PINC = 0x10;
+	Read (GPIO_REG_INPUT0, Buffer, 3);
+	CHECK (Buffer[0] == ((0x28 >> 3) | 0x40) && Buffer[1] == 0x04 && Buffer[2] == Buffer[0]);
+	
+	// port 1 open-drain release and assert
+	Write (Release1, sizeof(Release1));
+	CHECK (DDRA == 0xF8);
+	Write (Config1, sizeof(Config1));
+	CHECK (DDRC == 0x00 && DDRA == 0x38 && GPIO_DDRB == 0);
+	Write (Assert1, sizeof(Assert1));
+	CHECK (DDRC == 0x10 && (PORTC & 0x10) == 0);
+	
+	// continues write overwrite the pair; polarity inversion of the input register
+	Write (Polarity, sizeof(Polarity));
+	Read (GPIO_REG_POLARITY0, Buffer, 2);
+	CHECK (Buffer[0] == 0x0F && Buffer[1] == 0x00);
+	Read (GPIO_REG_INPUT0, Buffer, 1);
+	CHECK (Buffer[0] == (uint8_t)(((0x28 >> 3) | 0x40) ^ 0x0F));
+	
+	// command byte bits 7..3 are ignored; the next byte is data (the other register of the pair is not changed)
+	Write (HighCmd, sizeof(HighCmd));
+	Read (GPIO_REG_OUTPUT0, Buffer, 2);
+	CHECK (Buffer[0] == 0x3C && Buffer[1] == Assert1[1]);
+	Read (0x80 | GPIO_REG_OUTPUT0, Buffer, 1);
+	CHECK (Buffer[0] == 0x3C);
+	
+	printf ("> GPIO host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
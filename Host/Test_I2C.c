@@ -0,0 +1,60 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: I2C conformance self-test (I2C_Test.c) with and without bus time-out
+************************************************************************
+*/
+
+#include "Host_Test.h"
+#include "Config.h"
+#include "I2C_Slave.h"
+#include "I2C_Test.h"
+#include "EEPROM_Queue.h"
+#include "Trace.h"
+#include "I2C_Device_EEPROM.h"
+#include "I2C_Device_GPI.h"
+#include "I2C_Device_SRAM.h"
+#include "I2C_Device_Temp.h"
+#include "I2C_Device_GPIO.h"
+
+static MODULE_CONFIG g_Config = 
+{
+	.BaseAddr = 0x70, 
+	.Layout = {CONFIG_DEV_EEPROM, CONFIG_DEV_GPI | CONFIG_DEV_SRAM<<4, CONFIG_DEV_TEMP<<4, CONFIG_DEV_GPIO},
+};
+
+//--------------------------------------------------------------------------
+int main (void)
+{
+	uint16_t i;
+	
+	for (i = 0; i < sizeof(stub_flash); i++)
+		stub_flash [i] = (uint8_t)(i*7 + 3);
+	PINA = 0x28;
+	PINB = 0x08;
+	PINC = 0x01;
+	
+	Trace_Init (0);
+	EEPROM_Queue_Init ();
+	I2C_Device_EEPROM_Init (0);
+	I2C_Device_GPI_Init (2);
+	I2C_Device_SRAM_Init (3);
+	I2C_Device_Temp_Init (5);
+	I2C_Device_GPIO_Init (6);
+	I2C_Slave_Init (g_Config.BaseAddr, Config_Get_Devices (&g_Config));
+	I2C_Test_Init (&g_Config);
+	
+	I2C_Slave_Set_TimeOut (25);
+	g_Fails += I2C_Test_Run ();
+	I2C_Slave_Set_TimeOut (0);
+	g_Fails += I2C_Test_Run ();
+	
+	printf ("> I2C host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
@@ -0,0 +1,115 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: SPILOAD# power-cycle sequence run from main loop (INT0_vect only assert CORST# and call PowerCycle_Start)
+************************************************************************
+
+ Timer1 (1 usec per count) is advanced by the test; the write-one-to-clear of INTF0 is emulated by clearing GIFR.
+*/
+
+#include "Host_Test.h"
+#include "CoreRegisters.h"
+#include "SystemTick.h"
+#include "PowerCycle.h"
+
+extern void TIMER1_OVF_vect (void);
+
+static uint32_t g_Time; // usec
+
+//--------------------------------------------------------------------------
+static void Advance (uint32_t usec)
+{
+	uint32_t Next = g_Time + usec;
+
+	if ((Next >> 16) != (g_Time >> 16))
+	{
+		TCNT1 = 0;
+		TIMER1_OVF_vect ();
+		TIFR = 0;
+	}
+	g_Time = Next;
+	TCNT1 = (uint16_t)g_Time;
+}
+//--------------------------------------------------------------------------
+// run the main loop for usec (100 usec per round)
+static void Run (uint32_t usec)
+{
+	uint32_t i;
+
+	for (i = 0; i < usec; i += 100)
+	{
+		Advance (100);
+		PowerCycle_BackgroundTask ();
+	}
+}
+//--------------------------------------------------------------------------
+// SPILOAD# pulse; EXTEND_SPILOAD_N high for BMC reset, low for host force FUP. Return with CORST# released and high.
+static void Pulse (bool BMC_Reset)
+{
+	PINC = BMC_Reset ? (1<<PC2) : 0;
+	PINA = 0;
+	CLEAR_BIT_REG (GIMSK, INT0);
+	SET_BIT_REG (DDRA, PA2); // INT0_vect
+	PowerCycle_Start ();
+	CHECK (! IS_BIT_SET (GIMSK, INT0));
+
+	PowerCycle_BackgroundTask ();
+	CHECK (! IS_BIT_SET (DDRC, PC4)); // before the sample delay
+	Run (POWER_CYCLE_SAMPLE_DELAY);
+	CHECK (IS_BIT_SET (DDRC, PC4) && ! IS_BIT_SET (PORTC, PC4)); // flash off
+
+	Run (POWER_CYCLE_FLASH_OFF - 200);
+	CHECK (IS_BIT_SET (DDRC, PC4));
+	Run (200);
+	CHECK (! IS_BIT_SET (DDRC, PC4)); // flash on
+
+	Run (POWER_CYCLE_FLASH_ON * 2); // FWSPI_PWR_EN held low: delay extended
+	CHECK (IS_BIT_SET (DDRA, PA2));
+	SET_BIT_REG (PINC, PC4);
+	Run (POWER_CYCLE_FLASH_ON - 100); // one round to see FWSPI_PWR_EN high
+	CHECK (IS_BIT_SET (DDRA, PA2));
+	Run (200);
+	CHECK (! IS_BIT_SET (DDRA, PA2)); // CORST# released
+
+	Run (1000); // CORST# held low
+	CHECK (! IS_BIT_SET (GIMSK, INT0));
+	GIFR = 0;
+	SET_BIT_REG (PINA, PA2);
+	PowerCycle_BackgroundTask ();
+	CHECK (IS_BIT_SET (GIFR, INTF0)); // SPILOAD# pulse before the release is cleared
+	GIFR = 0;
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	SystemTick_Init ();
+	TIFR = 0;
+
+	// BMC reset: done on the second SPILOAD# pulse
+	Pulse (true);
+	Run (20000);
+	CHECK (! IS_BIT_SET (GIMSK, INT0));
+	SET_BIT_REG (GIFR, INTF0);
+	PowerCycle_BackgroundTask ();
+	CHECK (IS_BIT_SET (GIMSK, INT0));
+
+	// BMC reset without the second pulse: INT0 is unmasked after the time-out
+	Pulse (true);
+	Run (POWER_CYCLE_PULSE_TIMEOUT * 1000UL - 1000);
+	CHECK (! IS_BIT_SET (GIMSK, INT0));
+	Run (1000);
+	CHECK (IS_BIT_SET (GIMSK, INT0));
+
+	// host force FUP: done on CORST# release (the second pulse can't be detected)
+	Pulse (false);
+	CHECK (IS_BIT_SET (GIMSK, INT0));
+
+	printf ("> PowerCycle host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
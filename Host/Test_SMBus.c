@@ -0,0 +1,159 @@
+/*
+ * Nuvoton RunBMC Module Project
+ *
+ * Created: 1/28/2019 6:43:01 PM
+ * Author : lior.albaz@Nuvoton.com
+ */ 
+
+/*
+************************************************************************
+ Host test: SMBus alert (INT# pin, host notify / ARA) and PEC
+************************************************************************
+*/
+
+#include "Host_Test.h"
+#include "CoreRegisters.h"
+#include "I2C_Slave.h"
+#include "EEPROM_Queue.h"
+#include "BMC_WD.h"
+#include "I2C_Device_EEPROM.h"
+#include "I2C_Device_SRAM.h"
+#include "I2C_Device_GPIO.h"
+
+#define ARA_ADDR	0x0C
+#define IS_INT_ASSERTED()	IS_BIT_CLEARED (PORTB, PB2)
+
+//--------------------------------------------------------------------------
+static void Test_Alert (void)
+{
+	uint8_t Addr;
+	
+	I2C_Slave_Init (0x70, 8);
+	CHECK (!IS_INT_ASSERTED () && IS_BIT_CLEARED (TWSCRA, TWPME));
+	I2C_Slave_Alert (2, true);
+	I2C_Slave_Alert (4, true);
+	CHECK (IS_INT_ASSERTED () && IS_BIT_SET (TWSCRA, TWPME));
+	
+	CHECK (Host_Start (0x50, true) == I2C_NACK); // not our address
+	Host_Stop ();
+	
+	// ARA: lowest address first; INT# is released after the last one
+	CHECK (Host_Start (ARA_ADDR, true) == I2C_ACK);
+	Addr = Host_Read (false);
+	Host_Stop ();
+	CHECK (Addr == (0x72 << 1) && IS_INT_ASSERTED ());
+	CHECK (Host_Start (ARA_ADDR, true) == I2C_ACK);
+	Addr = Host_Read (false);
+	Host_Stop ();
+	CHECK (Addr == (0x74 << 1) && !IS_INT_ASSERTED ());
+	CHECK (Host_Start (ARA_ADDR, true) == I2C_NACK);
+	Host_Stop ();
+	
+	// reported alert is masked until the source is released
+	I2C_Slave_Alert (2, true);
+	CHECK (!IS_INT_ASSERTED ());
+	I2C_Slave_Alert (2, false);
+	I2C_Slave_Alert (2, true);
+	CHECK (IS_INT_ASSERTED ());
+	I2C_Slave_Alert (2, false);
+}
+//--------------------------------------------------------------------------
+// Return NACK mask; bit per data byte, bit Size is the PEC byte.
+static uint32_t Write_PEC (uint8_t Addr7, const uint8_t *pData, uint8_t Size, uint8_t BadPEC)
+{
+	uint8_t AddrByte = Addr7 << 1;
+	uint8_t PEC = Host_PEC (Host_PEC (0, &AddrByte, 1), pData, Size);
+	uint32_t Mask = 0;
+	uint8_t i;
+	
+	Host_Start (Addr7, false);
+	for (i = 0; i < Size; i++)
+		Mask |= (uint32_t)Host_Write (pData[i]) << i;
+	Mask |= (uint32_t)Host_Write (PEC ^ BadPEC) << Size;
+	Host_Stop ();
+	return (Mask);
+}
+//--------------------------------------------------------------------------
+static void Read (uint8_t Addr7, uint16_t Addr, uint8_t *pBuffer, uint8_t Size)
+{
+	Host_Start (Addr7, false);
+	Host_Write ((uint8_t)(Addr >> 8));
+	Host_Write ((uint8_t)Addr);
+	Host_Start (Addr7, true);
+	while (Size--)
+		*pBuffer++ = Host_Read (false);
+	Host_Stop ();
+}
+//--------------------------------------------------------------------------
+static void Test_PEC (void)
+{
+	const uint8_t Good [4] = {0, 0x10, 0xAA, 0xBB}, Bad [4] = {0, 0x10, 0x11, 0x22};
+	const uint8_t Auth [3][3] = {{0x80, 0, 0}, {0x80, 1, 0x50}, {0x80, 2, 0x77}}, Byte [3] = {0, 0x50, 0x77};
+	const uint8_t Out [3] = {GPIO_REG_OUTPUT0, 0x5A, 0xA5};
+	uint8_t Long [30] = {0, 0x20};
+	uint8_t Match [5] = {0, 0x30, 0x11, 0, 0x55};
+	uint8_t AddrByte = 0x71 << 1;
+	uint8_t Buffer [3];
+	uint8_t i;
+	
+	I2C_Device_EEPROM_Init (0);
+	I2C_Device_SRAM_Init (1);
+	I2C_Device_GPIO_Init (2);
+	I2C_Slave_Init (0x70, 4);
+	I2C_Slave_Set_PEC (0x07);
+	
+	// SRAM: the PEC byte is not written; write with bad PEC is dropped
+	CHECK (Write_PEC (0x71, Good, 4, 0) == 0);
+	Read (0x71, 0x0010, Buffer, 3);
+	CHECK (Buffer[0] == 0xAA && Buffer[1] == 0xBB && Buffer[2] == 0);
+	Write_PEC (0x71, Bad, 4, 1);
+	Read (0x71, 0x0010, Buffer, 2);
+	CHECK (Buffer[0] == 0xAA && Buffer[1] == 0xBB);
+	CHECK (I2C_Slave_Get_PEC_Error_Count () == 1);
+	
+	// a data byte that match the running CRC is not the PEC: nothing is written when the last byte fail the check
+	Match [3] = Host_PEC (Host_PEC (0, &AddrByte, 1), Match, 3);
+	Write_PEC (0x71, Match, 5, 1);
+	Read (0x71, 0x0030, Buffer, 3);
+	CHECK (Buffer[0] == 0 && Buffer[1] == 0 && Buffer[2] == 0);
+	CHECK (I2C_Slave_Get_PEC_Error_Count () == 2);
+	CHECK (Write_PEC (0x71, Match, 5, 0) == 0);
+	Read (0x71, 0x0030, Buffer, 3);
+	CHECK (Buffer[0] == 0x11 && Buffer[1] == Match[3] && Buffer[2] == 0x55);
+	
+	// GPIO: register pair with bad PEC is dropped
+	Write_PEC (0x72, Out, 3, 1);
+	Host_Start (0x72, false);
+	Host_Write (GPIO_REG_OUTPUT0);
+	Host_Start (0x72, true);
+	Buffer[0] = Host_Read (true);
+	Buffer[1] = Host_Read (false);
+	Host_Stop ();
+	CHECK (Buffer[0] != 0x5A && Buffer[1] != 0xA5);
+	
+	// EEPROM: a not authorized single byte write is dropped (device NACK is not reported; data is passed on stop)
+	CHECK (Write_PEC (0x70, Byte, 3, 0) == 0);
+	Read (0x70, 0x0050, Buffer, 1);
+	CHECK (Buffer[0] != 0x77);
+	for (i = 0; i < 3; i++)
+		CHECK (Write_PEC (0x70, Auth[i], 3, 0) == 0);
+	CHECK (Write_PEC (0x70, Byte, 3, 0) == 0);
+	Read (0x70, 0x0050, Buffer, 1);
+	CHECK (Buffer[0] == 0x77);
+	
+	// longer than the PEC stage
+	CHECK (Write_PEC (0x71, Long, sizeof(Long), 0) & (1ul << I2C_PEC_STAGE));
+	I2C_Slave_Set_PEC (0);
+}
+//--------------------------------------------------------------------------
+int main (void)
+{
+	EEPROM_Queue_Init ();
+	WD_Init (0);
+	
+	Test_Alert ();
+	Test_PEC ();
+	
+	printf ("> SMBus host test: %d checks failed\r\n", g_Fails);
+	return (g_Fails);
+}
@@ -0,0 +1,6 @@
+/* Host stub */
+#pragma once
+#include <stdint.h>
+void boot_page_erase(uint16_t); void boot_page_fill(uint16_t, uint16_t); void boot_page_write(uint16_t);
+#define boot_spm_busy() 0
+#define boot_spm_busy_wait() do{}while(0)
@@ -0,0 +1,4 @@
+/* Host stub */
+#pragma once
+#define _NOP() ((void)0)
+#define _MemoryBarrier() ((void)0)
@@ -0,0 +1,40 @@
+/* Host stub */
+#pragma once
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR_ALIASOF(v)
+#define ISR(v, ...) void v(void); void v(void)
+#define EMPTY_INTERRUPT(v) void v(void){}
+#define ISR_ALIAS(v,t) void v(void)
+#define reti()
+#define sei() ((void)0)
+#define cli() ((void)0)
+void INT0_vect(void);
+void PCINT0_vect(void);
+void PCINT1_vect(void);
+void PCINT2_vect(void);
+void WDT_vect(void);
+void TIMER1_CAPT_vect(void);
+void TIMER1_COMPA_vect(void);
+void TIMER1_COMPB_vect(void);
+void TIMER1_OVF_vect(void);
+void TIMER0_COMPA_vect(void);
+void TIMER0_COMPB_vect(void);
+void TIMER0_OVF_vect(void);
+void ANA_COMP_vect(void);
+void ADC_vect(void);
+void USART0_START_vect(void);
+void USART0_RX_vect(void);
+void USART0_UDRE_vect(void);
+void USART0_TX_vect(void);
+void USART1_START_vect(void);
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+void USART1_TX_vect(void);
+void USI_START_vect(void);
+void USI_OVF_vect(void);
+void TWI_SLAVE_vect(void);
+void EE_READY_vect(void);
+void QTRIP_vect(void);
+void BADISR_vect(void);
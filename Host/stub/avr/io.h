@@ -0,0 +1,358 @@
+/* Host stub: ATtiny1634 registers are plain variables (see stub.c). */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+extern volatile uint8_t PORTA;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t PORTC;
+extern volatile uint8_t DDRA;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t DDRC;
+extern volatile uint8_t PINA;
+extern volatile uint8_t PINB;
+extern volatile uint8_t PINC;
+extern volatile uint8_t PUEA;
+extern volatile uint8_t PUEB;
+extern volatile uint8_t PUEC;
+extern volatile uint8_t MCUCR;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t GIMSK;
+extern volatile uint8_t GIFR;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+extern volatile uint8_t CCP;
+extern volatile uint8_t CLKPR;
+extern volatile uint8_t CLKSR;
+extern volatile uint8_t WDTCSR;
+extern volatile uint8_t OSCCAL0;
+extern volatile uint8_t OSCTCAL0A;
+extern volatile uint8_t OSCTCAL0B;
+extern volatile uint8_t OSCCAL1;
+extern volatile uint8_t PRR;
+extern volatile uint8_t TWSCRA;
+extern volatile uint8_t TWSCRB;
+extern volatile uint8_t TWSSRA;
+extern volatile uint8_t TWSA;
+extern volatile uint8_t TWSAM;
+extern volatile uint8_t TWSD;
+extern volatile uint8_t GTCCR;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t OCR0B;
+extern volatile uint8_t TIMSK;
+extern volatile uint8_t TIFR;
+extern volatile uint8_t TCCR0A;
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TCCR1C;
+extern volatile uint8_t TCNT1L;
+extern volatile uint8_t TCNT1H;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t ADCSRB;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t ADCH;
+extern volatile uint8_t ADCL;
+extern volatile uint8_t DIDR0;
+extern volatile uint8_t DIDR1;
+extern volatile uint8_t DIDR2;
+extern volatile uint8_t EEARL;
+extern volatile uint8_t EEAR;
+extern volatile uint8_t *stub_EEDR (void);
+#define EEDR (*stub_EEDR ()) // EEPROM read (EERE) load the data register on access
+extern volatile uint8_t EECR;
+extern volatile uint8_t SPMCSR;
+extern volatile uint8_t USICR;
+extern volatile uint8_t USISR;
+extern volatile uint8_t USIDR;
+extern volatile uint8_t USIBR;
+extern volatile uint8_t UCSR0A;
+extern volatile uint8_t UCSR0B;
+extern volatile uint8_t UCSR0C;
+extern volatile uint8_t UCSR0D;
+extern volatile uint8_t UDR0;
+extern volatile uint8_t UBRR0L;
+extern volatile uint8_t UBRR0H;
+extern volatile uint8_t UCSR1A;
+extern volatile uint8_t UCSR1B;
+extern volatile uint8_t UCSR1C;
+extern volatile uint8_t UCSR1D;
+extern volatile uint8_t UDR1;
+extern volatile uint8_t SREG;
+extern volatile uint8_t SPH;
+extern volatile uint8_t SPL;
+extern volatile uint8_t GPIOR0;
+extern volatile uint8_t GPIOR1;
+extern volatile uint8_t GPIOR2;
+extern volatile uint8_t ACSRA;
+extern volatile uint8_t ACSRB;
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t OCR1A;
+extern volatile uint16_t OCR1B;
+extern volatile uint16_t ICR1;
+extern volatile uint16_t ADC;
+extern volatile uint16_t UBRR0;
+extern volatile uint16_t UBRR1;
+extern volatile uint16_t SP;
+#define WDIF 7
+#define WDIE 6
+#define WDP3 5
+#define WDE 3
+#define WDP2 2
+#define WDP1 1
+#define WDP0 0
+#define ISC01 1
+#define ISC00 0
+#define INT0 6
+#define INTF0 6
+#define PCIE0 3
+#define PCIE1 4
+#define PCIE2 5
+#define PCINT12 0
+#define PCIF0 3
+#define PCIF1 4
+#define PCIF2 5
+#define PRTWI 6
+#define PRTIM1 5
+#define PRTIM0 4
+#define PRUSI 3
+#define PRUSART1 2
+#define PRUSART0 1
+#define PRADC 0
+#define TWSHE 7
+#define TWDIE 5
+#define TWASIE 4
+#define TWEN 3
+#define TWSIE 2
+#define TWPME 1
+#define TWSME 0
+#define TWHNM 2
+#define TWAA 2
+#define TWCMD1 1
+#define TWCMD0 0
+#define TWDIF 7
+#define TWASIF 6
+#define TWCH 5
+#define TWRA 4
+#define TWC 3
+#define TWBE 2
+#define TWDIR 1
+#define TWAS 0
+#define TOIE1 7
+#define OCIE1A 6
+#define OCIE1B 5
+#define ICIE1 3
+#define OCIE0B 2
+#define TOIE0 1
+#define OCIE0A 0
+#define TOV1 7
+#define OCF1A 6
+#define OCF1B 5
+#define ICF1 3
+#define OCF0B 2
+#define TOV0 1
+#define OCF0A 0
+#define TSM 7
+#define PSR10 0
+#define COM1A1 7
+#define COM1A0 6
+#define COM1B1 5
+#define COM1B0 4
+#define WGM11 1
+#define WGM10 0
+#define ICNC1 7
+#define ICES1 6
+#define WGM13 4
+#define WGM12 3
+#define CS12 2
+#define CS11 1
+#define CS10 0
+#define FOC1A 7
+#define FOC1B 6
+#define COM0A1 7
+#define COM0A0 6
+#define COM0B1 5
+#define COM0B0 4
+#define WGM01 1
+#define WGM00 0
+#define WGM02 3
+#define CS02 2
+#define CS01 1
+#define CS00 0
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define ADLAR 3
+#define REFS1 7
+#define REFS0 6
+#define REFEN 5
+#define ADC0EN 4
+#define MUX3 3
+#define MUX2 2
+#define MUX1 1
+#define MUX0 0
+#define EEPM1 5
+#define EEPM0 4
+#define EERIE 3
+#define EEMPE 2
+#define EEPE 1
+#define EERE 0
+#define RSIG 5
+#define CTPB 4
+#define RFLB 3
+#define PGWRT 2
+#define PGERS 1
+#define SPMEN 0
+#define USISIE 7
+#define USIOIE 6
+#define USIWM1 5
+#define USIWM0 4
+#define USICS1 3
+#define USICS0 2
+#define USICLK 1
+#define USITC 0
+#define USISIF 7
+#define USIOIF 6
+#define USIPF 5
+#define USIDC 4
+#define USICNT3 3
+#define USICNT2 2
+#define USICNT1 1
+#define USICNT0 0
+#define RXC0 7
+#define TXC0 6
+#define UDRE0 5
+#define FE0 4
+#define DOR0 3
+#define UPE0 2
+#define U2X0 1
+#define MPCM0 0
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UCSZ02 2
+#define UCSZ01 2
+#define UCSZ00 1
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define PA0 0
+#define PINA0 0
+#define DDA0 0
+#define PORTA0 0
+#define PA1 1
+#define PINA1 1
+#define DDA1 1
+#define PORTA1 1
+#define PA2 2
+#define PINA2 2
+#define DDA2 2
+#define PORTA2 2
+#define PA3 3
+#define PINA3 3
+#define DDA3 3
+#define PORTA3 3
+#define PA4 4
+#define PINA4 4
+#define DDA4 4
+#define PORTA4 4
+#define PA5 5
+#define PINA5 5
+#define DDA5 5
+#define PORTA5 5
+#define PA6 6
+#define PINA6 6
+#define DDA6 6
+#define PORTA6 6
+#define PA7 7
+#define PINA7 7
+#define DDA7 7
+#define PORTA7 7
+#define PB0 0
+#define PINB0 0
+#define DDB0 0
+#define PORTB0 0
+#define PB1 1
+#define PINB1 1
+#define DDB1 1
+#define PORTB1 1
+#define PB2 2
+#define PINB2 2
+#define DDB2 2
+#define PORTB2 2
+#define PB3 3
+#define PINB3 3
+#define DDB3 3
+#define PORTB3 3
+#define PB4 4
+#define PINB4 4
+#define DDB4 4
+#define PORTB4 4
+#define PB5 5
+#define PINB5 5
+#define DDB5 5
+#define PORTB5 5
+#define PB6 6
+#define PINB6 6
+#define DDB6 6
+#define PORTB6 6
+#define PB7 7
+#define PINB7 7
+#define DDB7 7
+#define PORTB7 7
+#define PC0 0
+#define PINC0 0
+#define DDC0 0
+#define PORTC0 0
+#define PC1 1
+#define PINC1 1
+#define DDC1 1
+#define PORTC1 1
+#define PC2 2
+#define PINC2 2
+#define DDC2 2
+#define PORTC2 2
+#define PC3 3
+#define PINC3 3
+#define DDC3 3
+#define PORTC3 3
+#define PC4 4
+#define PINC4 4
+#define DDC4 4
+#define PORTC4 4
+#define PC5 5
+#define PINC5 5
+#define DDC5 5
+#define PORTC5 5
+#define PC6 6
+#define PINC6 6
+#define DDC6 6
+#define PORTC6 6
+#define PC7 7
+#define PINC7 7
+#define DDC7 7
+#define PORTC7 7
+extern unsigned char __heap_start; /* painted stack area from __heap_start to RAMEND (see stub.c) */
+extern uint8_t stub_flash [0x4000]; /* flash window (pgm_read_* of addresses below 0x4000) */
+extern uint8_t stub_data [0x500];   /* data space window of the emulated EEPROM (0x1000..0x14FF) */
+#define STUB_STACK_SIZE 192
+#define RAMEND ((uintptr_t)&__heap_start + STUB_STACK_SIZE - 1)
+#define RAMSTART 0x0100
+#define E2END 0xFF
+#define FLASHEND 0x3FFF
+#define SPM_PAGESIZE 32
+#define _BV(b) (1<<(b))
+#define bit_is_set(r,b) ((r)&_BV(b))
+#define bit_is_clear(r,b) (!((r)&_BV(b)))
+#define loop_until_bit_is_set(r,b) do{}while(bit_is_clear(r,b))
+#define loop_until_bit_is_clear(r,b) do{}while(bit_is_set(r,b))
+#define SREG_I 7
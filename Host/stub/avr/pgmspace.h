@@ -0,0 +1,23 @@
+/* Host stub: flash addresses (below 0x4000) read stub_flash; PROGMEM data is in RAM. */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+extern uint8_t stub_flash [0x4000];
+static inline uint8_t stub_pgm(const void *p){ return (uintptr_t)p < 0x4000 ? stub_flash[(uintptr_t)p] : *(const uint8_t*)p; }
+static inline void *stub_memcpy_P(void *d, const void *s, size_t n){ for(size_t i=0;i<n;i++) ((uint8_t*)d)[i]=stub_pgm((const uint8_t*)s+i); return d; }
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(p) stub_pgm((const void*)(uintptr_t)(p))
+#define pgm_read_word(p) ((uint16_t)(stub_pgm((const void*)(uintptr_t)(p)) | stub_pgm((const uint8_t*)(uintptr_t)(p)+1)<<8))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+#define memcpy_P stub_memcpy_P
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define printf_P printf
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define puts_P puts
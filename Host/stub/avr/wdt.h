@@ -0,0 +1,6 @@
+/* Host stub */
+#pragma once
+#define wdt_reset() ((void)0)
+void wdt_enable(unsigned char); void wdt_disable(void);
+#define WDTO_15MS 0
+#define WDTO_8S 9
@@ -0,0 +1,10 @@
+/* Host stub: avr-libc stream setup */
+#include_next <stdio.h>
+#ifndef FDEV_SETUP_STREAM
+#define FDEV_SETUP_STREAM(p,g,f) {0}
+#define _FDEV_SETUP_WRITE 2
+#define _FDEV_SETUP_READ 1
+#define _FDEV_SETUP_RW 3
+#define _FDEV_EOF (-2)
+#define fdev_setup_stream(s,p,g,f) ((void)0)
+#endif
@@ -0,0 +1,183 @@
+/*
+ * Host stub: ATtiny1634 registers, EEPROM, flash and libc/libgcc helpers used by the firmware sources.
+ * Registers are plain variables; a test drive the interrupt vectors (e.g., TWI_SLAVE_vect, EE_READY_vect) directly.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+
+volatile uint8_t PORTA;
+volatile uint8_t PORTB;
+volatile uint8_t PORTC;
+volatile uint8_t DDRA;
+volatile uint8_t DDRB;
+volatile uint8_t DDRC;
+volatile uint8_t PINA;
+volatile uint8_t PINB;
+volatile uint8_t PINC;
+volatile uint8_t PUEA;
+volatile uint8_t PUEB;
+volatile uint8_t PUEC;
+volatile uint8_t MCUCR;
+volatile uint8_t MCUSR;
+volatile uint8_t GIMSK;
+volatile uint8_t GIFR;
+volatile uint8_t PCMSK0;
+volatile uint8_t PCMSK1;
+volatile uint8_t PCMSK2;
+volatile uint8_t CCP;
+volatile uint8_t CLKPR;
+volatile uint8_t CLKSR;
+volatile uint8_t WDTCSR;
+volatile uint8_t OSCCAL0;
+volatile uint8_t OSCTCAL0A;
+volatile uint8_t OSCTCAL0B;
+volatile uint8_t OSCCAL1;
+volatile uint8_t PRR;
+volatile uint8_t TWSCRA;
+volatile uint8_t TWSCRB;
+volatile uint8_t TWSSRA;
+volatile uint8_t TWSA;
+volatile uint8_t TWSAM;
+volatile uint8_t TWSD;
+volatile uint8_t GTCCR;
+volatile uint8_t TCNT0;
+volatile uint8_t OCR0A;
+volatile uint8_t OCR0B;
+volatile uint8_t TIMSK;
+volatile uint8_t TIFR;
+volatile uint8_t TCCR0A;
+volatile uint8_t TCCR0B;
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint8_t TCCR1C;
+volatile uint8_t TCNT1L;
+volatile uint8_t TCNT1H;
+volatile uint8_t ADCSRA;
+volatile uint8_t ADCSRB;
+volatile uint8_t ADMUX;
+volatile uint8_t ADCH;
+volatile uint8_t ADCL;
+volatile uint8_t DIDR0;
+volatile uint8_t DIDR1;
+volatile uint8_t DIDR2;
+volatile uint8_t EEARL;
+volatile uint8_t EEAR;
+volatile uint8_t EECR;
+volatile uint8_t SPMCSR;
+volatile uint8_t USICR;
+volatile uint8_t USISR;
+volatile uint8_t USIDR;
+volatile uint8_t USIBR;
+volatile uint8_t UCSR0A;
+volatile uint8_t UCSR0B;
+volatile uint8_t UCSR0C;
+volatile uint8_t UCSR0D;
+volatile uint8_t UDR0;
+volatile uint8_t UBRR0L;
+volatile uint8_t UBRR0H;
+volatile uint8_t UCSR1A;
+volatile uint8_t UCSR1B;
+volatile uint8_t UCSR1C;
+volatile uint8_t UCSR1D;
+volatile uint8_t UDR1;
+volatile uint8_t SREG;
+volatile uint8_t SPH;
+volatile uint8_t SPL;
+volatile uint8_t GPIOR0;
+volatile uint8_t GPIOR1;
+volatile uint8_t GPIOR2;
+volatile uint8_t ACSRA;
+volatile uint8_t ACSRB;
+volatile uint16_t TCNT1;
+volatile uint16_t OCR1A;
+volatile uint16_t OCR1B;
+volatile uint16_t ICR1;
+volatile uint16_t ADC;
+volatile uint16_t UBRR0;
+volatile uint16_t UBRR1;
+volatile uint16_t SP;
+
+uint8_t stub_flash [0x4000];
+uint8_t stub_data [0x500];
+
+/* stack area painted like the firmware start-up code (Stack.c); RAMEND is its last byte */
+uint8_t stub_stack [STUB_STACK_SIZE] __asm__ ("__heap_start");
+__attribute__ ((constructor)) static void stub_stack_paint (void)
+{
+	memset (stub_stack, 0xC5, sizeof (stub_stack));
+}
+
+/* EEPROM (256 bytes) */
+static uint8_t ee [256];
+static volatile uint8_t stub_eedr;
+volatile uint8_t *stub_EEDR (void)
+{
+	if (EECR & (1<<EERE))
+	{
+		EECR &= ~(1<<EERE);
+		stub_eedr = ee [EEAR];
+	}
+	return (&stub_eedr);
+}
+uint8_t *stub_ee (void) { return (ee); }
+uint8_t eeprom_read_byte (const uint8_t *a) { return (ee [(size_t)a & 0xFF]); }
+uint16_t eeprom_read_word (const uint16_t *a) { return (ee [(size_t)a & 0xFF] | ee [((size_t)a + 1) & 0xFF] << 8); }
+uint32_t eeprom_read_dword (const uint32_t *a) { return (eeprom_read_word ((const uint16_t *)a) | (uint32_t)eeprom_read_word ((const uint16_t *)((size_t)a + 2)) << 16); }
+void eeprom_read_block (void *d, const void *s, size_t n) { for (size_t i = 0; i < n; i++) ((uint8_t *)d)[i] = ee [((size_t)s + i) & 0xFF]; }
+void eeprom_write_byte (uint8_t *a, uint8_t v) { ee [(size_t)a & 0xFF] = v; }
+void eeprom_update_byte (uint8_t *a, uint8_t v) { ee [(size_t)a & 0xFF] = v; }
+void eeprom_write_word (uint16_t *a, uint16_t v) { eeprom_write_byte ((uint8_t *)a, (uint8_t)v); eeprom_write_byte ((uint8_t *)((size_t)a + 1), v >> 8); }
+void eeprom_update_word (uint16_t *a, uint16_t v) { eeprom_write_word (a, v); }
+void eeprom_write_dword (uint32_t *a, uint32_t v) { eeprom_write_word ((uint16_t *)a, (uint16_t)v); eeprom_write_word ((uint16_t *)((size_t)a + 2), v >> 16); }
+void eeprom_write_block (const void *s, void *d, size_t n) { for (size_t i = 0; i < n; i++) ee [((size_t)d + i) & 0xFF] = ((const uint8_t *)s)[i]; }
+void eeprom_update_block (const void *s, void *d, size_t n) { eeprom_write_block (s, d, n); }
+
+/* flash self-programming of stub_flash (SPM_PAGESIZE pages); addresses out of it (host data of PROGMEM arrays) are ignored */
+static uint8_t stub_page [SPM_PAGESIZE] = { [0 ... SPM_PAGESIZE-1] = 0xFF };
+void boot_page_erase (uint16_t a) { if (a < sizeof (stub_flash)) memset (&stub_flash [a & ~(SPM_PAGESIZE-1)], 0xFF, SPM_PAGESIZE); }
+void boot_page_fill (uint16_t a, uint16_t w) { stub_page [a & (SPM_PAGESIZE-2)] = (uint8_t)w; stub_page [(a & (SPM_PAGESIZE-2)) + 1] = w >> 8; }
+void boot_page_write (uint16_t a) { if (a < sizeof (stub_flash)) memcpy (&stub_flash [a & ~(SPM_PAGESIZE-1)], stub_page, SPM_PAGESIZE); memset (stub_page, 0xFF, SPM_PAGESIZE); }
+
+void _delay_us (double d) { (void)d; }
+void _delay_ms (double d) { (void)d; }
+void wdt_enable (unsigned char x) { (void)x; }
+void wdt_disable (void) { }
+
+/* util/crc16.h (same polynomials as avr-libc) */
+uint16_t _crc16_update (uint16_t c, uint8_t d)
+{
+	c ^= d;
+	for (int i = 0; i < 8; i++)
+		c = (c & 1) ? (c >> 1) ^ 0xA001 : (c >> 1);
+	return (c);
+}
+uint16_t _crc_xmodem_update (uint16_t c, uint8_t d)
+{
+	c ^= (uint16_t)d << 8;
+	for (int i = 0; i < 8; i++)
+		c = (c & 0x8000) ? (uint16_t)(c << 1) ^ 0x1021 : (uint16_t)(c << 1);
+	return (c);
+}
+uint16_t _crc_ccitt_update (uint16_t c, uint8_t d)
+{
+	c ^= d;
+	for (int i = 0; i < 8; i++)
+		c = (c & 1) ? (c >> 1) ^ 0x8408 : (c >> 1);
+	return (c);
+}
+uint8_t _crc8_ccitt_update (uint8_t c, uint8_t d)
+{
+	c ^= d;
+	for (int i = 0; i < 8; i++)
+		c = (c & 0x80) ? (uint8_t)((c << 1) ^ 0x07) : (uint8_t)(c << 1);
+	return (c);
+}
+uint8_t _crc_ibutton_update (uint8_t c, uint8_t d)
+{
+	c ^= d;
+	for (int i = 0; i < 8; i++)
+		c = (c & 1) ? (c >> 1) ^ 0x8C : (c >> 1);
+	return (c);
+}
@@ -0,0 +1,9 @@
+/* Host stub */
+#pragma once
+#include <avr/interrupt.h>
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define NONATOMIC_RESTORESTATE
+#define NONATOMIC_FORCEOFF
+#define ATOMIC_BLOCK(t) for (int _atomic_once = 1; _atomic_once; _atomic_once = 0)
+#define NONATOMIC_BLOCK(t) for (int _natomic_once = 1; _natomic_once; _natomic_once = 0)
@@ -0,0 +1,4 @@
+/* Host stub */
+#pragma once
+#include <stdint.h>
+uint16_t _crc16_update(uint16_t, uint8_t); uint16_t _crc_ccitt_update(uint16_t, uint8_t); uint16_t _crc_xmodem_update(uint16_t, uint8_t); uint8_t _crc8_ccitt_update(uint8_t, uint8_t); uint8_t _crc_ibutton_update(uint8_t, uint8_t);
@@ -0,0 +1,3 @@
+/* Host stub */
+#pragma once
+void _delay_us(double); void _delay_ms(double);